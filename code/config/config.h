@@ -2,4 +2,148 @@
  * @Author       : mark
  * @Date         : 2020-06-28
  * @copyleft Apache 2.0
- */ 
+ */
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <cstdint>
+#include <vector>
+
+enum class SessionMode {
+    REDIS,    // 随机 token 存在 Redis 中，每次校验回源 Redis（经进程内缓存）
+    SIGNED    // HMAC 签名 token，本地校验，Redis 只保存吊销记录
+};
+
+enum class SessionBackend {
+    REDIS,    // 会话存放在 Redis，多进程共享
+    MEMORY    // 会话存放在本进程内存，适合单机部署和压测
+};
+
+enum class MetaBackend {
+    MYSQL,    // 用户和上传记录存放在 MySQL
+    SQLITE    // 内嵌 SQLite 数据库文件，不依赖外部数据库
+};
+
+enum class ReplicaPolicy {
+    ROUND_ROBIN,        // 依次轮转
+    LEAST_OUTSTANDING   // 正在执行的连接最少的从库（固定在线程里闲着的不算）
+};
+
+enum class FsyncPolicy {
+    NONE,       // 只 rename，不等落盘，掉电可能丢最近的上传
+    PER_FILE,   // 每个文件 fdatasync，rename 后再 fsync 所在目录
+    GROUP       // 写盘线程一批文件合起来 syncfs，排队的上传越多摊得越薄
+};
+
+/* MySQL 从库地址，账号和库名与主库相同 */
+struct SqlReplicaAddr {
+    std::string host;
+    int port;
+};
+
+/* 运行参数，默认值写在这里，main() 中可以在 WebServer 构造前覆盖 */
+struct Config {
+    /* Redis 连接池 */
+    static inline std::string redisHost = "127.0.0.1";
+    static inline int redisPort = 6379;
+    static inline int redisPoolSize = 16;           // 全进程共享的连接数上限
+    static inline int redisWaitTimeoutMs = 100;     // 连接池耗尽时最长等待时间
+    static inline int redisConnectTimeoutMs = 200;
+    static inline int redisSocketTimeoutMs = 200;
+    static inline int redisConnLifetimeMs = 0;      // 0 表示连接不因存活时间而重建
+    static inline int redisConnIdleTimeMs = 60000;  // 空闲超过该时间的连接在借出前重连
+
+    /* MySQL 连接池，最小连接数由 WebServer 构造参数 connPoolNum 指定 */
+    static inline int sqlPoolMaxSize = 32;          // 高峰期最多扩到的连接数
+    static inline int sqlAcquireTimeoutMs = 500;    // 借连接的最长等待时间，超时返回 nullptr
+    static inline int sqlValidateIdleMs = 30000;    // 空闲超过该时间的连接借出前先 ping
+    static inline int sqlIdleTimeoutMs = 60000;     // 超过最小连接数的部分空闲这么久就关闭
+    static inline int sqlConnectTimeoutSec = 3;
+    static inline int sqlReadTimeoutSec = 10;
+    static inline int sqlWriteTimeoutSec = 10;
+    static inline int sqlCloseWaitMs = 5000;        // 关闭连接池时等借出的连接归还的最长时间
+    // 每个线程固定占用一条连接，热路径不再经过连接池的锁；线程数要小于 sqlPoolMaxSize
+    static inline bool sqlThreadAffine = false;
+    // 数据库 I/O 线程数即同时在途的查询数，排队超过 dbQueueMax 时退回工作线程同步执行
+    static inline int dbIoThreads = 16;
+    // 只读从库，为空时读写都走主库；例如 {{"127.0.0.1", 3307}}
+    static inline std::vector<SqlReplicaAddr> sqlReplicas = {};
+    static inline ReplicaPolicy sqlReplicaPolicy = ReplicaPolicy::LEAST_OUTSTANDING;
+    static inline int sqlReadYourWritesMs = 2000;   // 用户写入后这段时间内他的读走主库，应大于从库的复制延迟
+    static inline size_t dbQueueMax = 4096;
+
+    /* 元数据存储后端，SQLITE 模式下不初始化 MySQL 连接池 */
+    static inline MetaBackend metaBackend = MetaBackend::MYSQL;
+    static inline std::string sqlitePath = "./data/meta.db";
+    static inline std::string sqliteSynchronous = "NORMAL";  // WAL 下 NORMAL 只在检查点 fsync，要求掉电不丢提交时改为 FULL
+    static inline int sqliteBusyTimeoutMs = 5000;
+    static inline int sqliteWriteBatchMax = 256;   // 一个事务最多合并的写操作数
+
+    /* 用户名布隆过滤器和用户缓存；多个进程共用一个用户表时关掉过滤器，别的进程注册的用户不在本进程的过滤器里 */
+    static inline bool userBloomEnabled = true;
+    static inline uint64_t userBloomBits = 1 << 23;  // 1MB，约 100 万用户时误判率 1% 左右
+    static inline int userBloomHashes = 7;
+    static inline int userCacheCapacity = 65536;     // username -> (id, 密码哈希)，所有分片合计
+    static inline int userCacheTtlMs = 300000;
+
+    /* 上传内容按 SHA-256 存放在 uploadRoot/blobs 下，不放在 resources 里，必须经 /download 鉴权后下载 */
+    static inline std::string uploadRoot = "./data/uploads";
+    static inline int blobReclaimIntervalMs = 10000;   // 没有删除通知时也定期检查一次引用归零的内容
+    static inline int blobReclaimBatch = 256;
+    /* 删掉的文件先 rename 进 uploadRoot/trash，由回收线程限速释放，删除请求不等磁盘 */
+    static inline int fileReclaimBatch = 64;                                // 每轮最多处理的文件数
+    static inline long long fileReclaimBytesPerSec = 256LL * 1024 * 1024;   // 释放速度上限，0 不限速
+    static inline long long fileReclaimTruncateStep = 64LL * 1024 * 1024;   // 大文件每次截掉这么多，再小的直接 unlink
+    static inline int fileReclaimMaxRetries = 8;                            // 超过后留在回收目录里，下次启动再试
+    static inline int deleteBatchMax = 1000;                                // 批量删除一次最多的文件数
+    /* 请求大小和用户配额，超出的在请求头到齐后立即拒绝，不读请求体 */
+    static inline size_t maxHeaderBytes = 64 * 1024;              // 请求行加请求头，超出回 431
+    static inline long long maxBodyBytes = 1024 * 1024;           // 上传以外的请求体，超出回 413
+    static inline long long maxUploadBytes = 64LL << 30;          // 一次上传（multipart、PUT、续传会话），超出回 413
+    static inline long long uploadChunkMaxBytes = 64LL << 20;     // 续传分片整个读进内存，单独限制
+    static inline long long userQuotaBytes = 100LL << 30;         // 每个用户的上传总量，超出回 507；0 不限
+    /* 大文件不经过内存：超过这个大小的 multipart 上传边收边写，下载用 sendfile 而不是 mmap */
+    static inline long long uploadStreamMinBytes = 8LL << 20;
+    static inline long long sendfileMinBytes = 256LL << 10;
+    /* GET /export 打包下载：边读边发，每个连接只占一块发送缓冲区 */
+    static inline size_t exportChunkBytes = 64 * 1024;
+    static inline int exportMaxFiles = 10000;   // 一次最多打包的文件数，中央目录信息要在内存里放到发完
+
+    /* 上传写盘线程：临时文件 -> 按策略落盘 -> rename -> 上传记录，工作线程提交后立即返回 */
+    static inline FsyncPolicy uploadFsync = FsyncPolicy::GROUP;
+    static inline int diskWriterThreads = 1;
+    static inline size_t diskWriterQueueMax = 256;   // 排队的上传内容都在内存里，满了回 503
+    static inline int diskWriterBatchMax = 64;       // 一次落盘最多合并的文件数
+
+    /* 断点续传会话：状态和 .part 数据文件放在这里，必须和 uploadRoot 在同一个文件系统上（完成时硬链接进 blob 存储） */
+    static inline std::string uploadStateDir = "./data/uploads/sessions";
+    static inline int uploadSessionTtlSec = 86400;   // 这么久没有新分片的会话连同数据一起清掉
+    static inline bool uploadChunkFsync = true;      // 分片落盘后再推进偏移，掉电重启后偏移不会超过实际数据
+
+    /* 按用户缓存的文件列表 JSON，总字节上限 */
+    static inline size_t fileListCacheBytes = 32 * 1024 * 1024;
+    /* /showlist 分页：不带 limit 时的默认页大小和允许的最大页大小，只有默认大小的第一页进缓存 */
+    static inline int fileListPageSize = 100;
+    static inline int fileListPageMax = 1000;
+
+    /* GET /files/search：按用户的文件名索引，所有用户合计的文件数上限，超出按 LRU 淘汰整个用户 */
+    static inline size_t searchIndexMaxFiles = 1000000;
+    static inline int searchResultDefault = 20;    // 不带 limit 时返回的条数
+    static inline int searchResultMax = 200;
+
+    /* 进程内会话缓存 token -> userID */
+    static inline int sessionCacheCapacity = 65536;    // 所有分片合计的条目上限
+    static inline int sessionCachePositiveTtlMs = 30000; // 有效 token 的缓存时间，不会超过 Redis 中的剩余寿命
+    static inline int sessionCacheNegativeTtlMs = 2000;  // 无效 token 的缓存时间
+
+    /* 会话模式 */
+    static inline SessionMode sessionMode = SessionMode::REDIS;
+    static inline SessionBackend sessionBackend = SessionBackend::REDIS;
+    static inline int sessionTTL = 3600;                  // 会话有效期（秒），活跃用户滑动续期
+    static inline int sessionRefreshIntervalMs = 5000;    // 后台批量续期的间隔
+    static inline int sessionRefreshBatch = 512;          // 单个 pipeline 中 EXPIRE 的最大条数
+    static inline std::string sessionSecret = "";   // SIGNED 模式的 HMAC 密钥，为空时启动时随机生成（重启后旧 token 失效）
+};
+
+#endif //CONFIG_H
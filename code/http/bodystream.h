@@ -0,0 +1,28 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-17 16:40:12
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-17 16:40:12
+ * @Description: 边生成边发送的响应体，HttpConn 每次只向它要一块
+ */
+#ifndef BODY_STREAM_H
+#define BODY_STREAM_H
+
+#include <cstddef>
+
+/*
+ * 响应体太大、不适合先在内存或磁盘上拼好时（如打包下载），由实现类按需生成：
+ * HttpConn 发完上一块才调用 Next 取下一块，每个连接同一时刻只占一块的内存。
+ */
+class BodyStream {
+public:
+    virtual ~BodyStream() = default;
+
+    // 整个响应体的字节数，写进 Content-Length
+    virtual long long Length() const = 0;
+    // 生成下一块，data 指向实现类内部的缓冲区，下次调用前有效；len 为 0 表示已经生成完。
+    // 返回 false 表示出错（如文件被改动），响应体无法补齐，连接只能关闭
+    virtual bool Next(const char*& data, size_t& len) = 0;
+};
+
+#endif //BODY_STREAM_H
@@ -8,6 +8,7 @@ using namespace std;
 
 const char* HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
+std::function<void(HttpConn*)> HttpConn::asyncDone;
 bool HttpConn::isET;
 
 // 构造函数，初始化成员变量
@@ -15,8 +16,7 @@ HttpConn::HttpConn() {
     fd_ = -1;
     addr_ = { 0 };
     isClose_ = true;
-    redis_ = std::make_shared<sw::redis::Redis>("tcp://127.0.0.1:6379");
-    authService_ = std::make_unique<AuthService>(redis_);
+    authService_ = std::make_unique<AuthService>(); // Redis 连接统一从 RedisPool 借用
 };
 
 // 析构函数，关闭连接
@@ -26,18 +26,30 @@ HttpConn::~HttpConn() {
 
 
 void HttpConn::init(int fd, const sockaddr_in& addr) {
+    // 和异步回调互斥：之前在途的回调全部作废，也不会在重置状态的同时构造响应
+    std::unique_lock<std::mutex> locker = gate_.Advance();
     userCount++; // 增加当前用户连接数
     addr_ = addr; // 传入的客户端地址保存在成员变量
     fd_ = fd; // 存储传入的文件描述符（socket）
     writeBuff_.RetrieveAll();
     readBuff_.RetrieveAll(); // 清空读写缓冲区
     isClose_ = false; // 设置关闭连接标志
+    asyncSubmit_ = nullptr;
+    asyncThen_ = nullptr;
+    put_.reset();
+    stream_.reset();
+    sendLeft_ = 0;
+    request_.Init(); // 上一个连接可能停在半个请求上，解析状态和登录身份都不能留给新连接
     LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
 }
 
 void HttpConn::Close() {
-    // 关闭连接
+    // 关闭连接；持锁到 fd 关掉为止，之后到达的数据库回调直接丢弃
+    std::unique_lock<std::mutex> locker = gate_.Advance();
     response_.UnmapFile(); // 停止映射
+    put_.reset(); // 没收完的 PUT 请求体连同临时文件一起丢掉
+    stream_.reset(); // 没发完的打包下载关掉正在读的文件
+    sendLeft_ = 0;
     if(isClose_ == false){
         isClose_ = true; // 设置关闭标志
         userCount--; // 用户连接数-1
@@ -65,6 +77,9 @@ int HttpConn::GetPort() const {
 
 
 ssize_t HttpConn::read(int* saveErrno) {
+    if (put_) {
+        return put_->form ? ReadForm_(saveErrno) : SpliceBody_(saveErrno);
+    }
     ssize_t len = 0;
     ssize_t totalLen = 0;
 
@@ -94,6 +109,22 @@ ssize_t HttpConn::write(int* saveErrno) {
     // ET模式，循环写入，直到数据发送完毕或错误
     // LT模式，一次写入
     do {
+        if(iov_[0].iov_len == 0 && iov_[1].iov_len == 0 && sendLeft_ > 0) {
+            // 一次最多 1GB，ET 模式下循环发完，LT 模式下由 EPOLLOUT 接着发
+            size_t want = std::min<size_t>(sendLeft_, 1 << 30);
+            len = sendfile(fd_, response_.FileFd(), &sendOffset_, want);
+            if(len < 0) {
+                *saveErrno = errno;
+                break;
+            }
+            if(len == 0) {
+                // 文件在发送途中变短了，长度已经写进响应头，只能断开
+                *saveErrno = EIO;
+                return -1;
+            }
+            sendLeft_ -= len;
+            continue;
+        }
         len = writev(fd_, iov_, iovCnt_); // 一次性写入多个缓冲区,iov_[0]存储HTTP头部,iov_[1]存储文件数据
         if(len <= 0) {
             *saveErrno = errno;
@@ -115,12 +146,21 @@ ssize_t HttpConn::write(int* saveErrno) {
             iov_[0].iov_len -= len; 
             writeBuff_.Retrieve(len); // 从写缓冲区移除已发送的数据
         }
+        if(stream_ && iov_[1].iov_len == 0 && !NextChunk_()) {
+            // 长度已经写进响应头，少发的部分没法补，只能断开让客户端知道下载不完整
+            *saveErrno = EIO;
+            return -1;
+        }
     } while(isET || ToWriteBytes() > 10240);
     return len;
 }
 
 
 HttpConn::PROCESS_STATE HttpConn::process() {
+    if (put_) {
+        // PUT 请求体还在往文件里写，read() 已经把这次到达的数据 splice 进去了
+        return ContinuePut_();
+    }
     int fd = GetFd(); // 获取客户端socket，fd
     isJsonResponse = false;
     // request_.Init(); // HTTP请求初始化
@@ -131,8 +171,22 @@ HttpConn::PROCESS_STATE HttpConn::process() {
     }
     // 解析HTTP请求
     HttpRequest::PARSE_STATE result = request_.parse(readBuff_, fd);
+    if(result == HttpRequest::PARSE_STATE::HEADERS_DONE) {
+        if(!AdmitBody_()) {
+            // 请求体不读了，响应之后连接关闭
+            FinishResponse_();
+            return FINISH;
+        }
+        result = request_.parse(readBuff_, fd);
+    }
 
     if(result == HttpRequest::PARSE_STATE::AGAIN) {
+        if((request_.state_ == HttpRequest::REQUEST_LINE || request_.state_ == HttpRequest::HEADERS)
+           && readBuff_.ReadableBytes() > Config::maxHeaderBytes) {
+            RejectBody_("请求头过大", 431);
+            FinishResponse_();
+            return FINISH;
+        }
         // 数据不够，继续监听 EPOLLIN
         return AGAIN;
     }
@@ -141,23 +195,186 @@ HttpConn::PROCESS_STATE HttpConn::process() {
         return FINISH;
     }
     RouteRequest();  // 新增函数：分发逻辑处理
+    if (put_) {
+        return ContinuePut_();
+    }
+    if(asyncSubmit_ && SubmitAsync_()) {
+        // 查询交给 DB 线程（上传交给写盘线程），完成后由回调构造响应并通知事件循环
+        return PENDING;
+    }
+    FinishResponse_();
+    return FINISH;
+}
+
+bool HttpConn::AdmitBody_() {
+    std::string method = request_.method();
+    const std::string& path = request_.path();
+    auto& header = request_.header();
+
+    long long length = 0;
+    auto it = header.find("Content-Length");
+    if (it != header.end()) {
+        try { length = std::stoll(it->second); } catch (...) { length = -1; }
+        if (length < 0) return RejectBody_("Content-Length 无效", 400);
+    }
+    bool resumable = path == "/uploads" || path.find("/uploads/") == 0;
+    bool upload = (method == "PUT" && path.find("/files/") == 0)
+               || (method == "PATCH" && resumable)
+               || (method == "POST" && !resumable && path.find("/upload") == 0);
+    long long limit = !upload ? Config::maxBodyBytes
+                    : method == "PATCH" ? Config::uploadChunkMaxBytes : Config::maxUploadBytes;
+    if (length > limit) {
+        return RejectBody_("请求体过大，上限 " + std::to_string(limit) + " 字节", 413);
+    }
+
+    // 会新占存储的请求：直接上传按 Content-Length（multipart 还含分隔行，略大于文件本身），建续传会话按 Upload-Length
+    long long declared = 0;
+    if (method == "POST" && path == "/uploads") {
+        it = header.find("Upload-Length");
+        if (it != header.end()) {
+            try { declared = std::stoll(it->second); } catch (...) {}
+        }
+        if (declared > Config::maxUploadBytes) {
+            return RejectBody_("文件过大，上限 " + std::to_string(Config::maxUploadBytes) + " 字节", 413);
+        }
+    } else if (upload && method != "PATCH") {
+        declared = length;
+    }
+    if (upload || declared > 0) {
+        if (!ExtractLoginFromCookie()) return RejectBody_("请先登录后再上传文件", 403);
+        if (declared > 0 && !UserQuota::Instance()->Allow(request_.GetUserID(), declared)) {
+            return RejectBody_("存储配额不足", 507);
+        }
+    }
+
+    it = header.find("Expect");
+    if (it != header.end() && strcasecmp(it->second.c_str(), "100-continue") != 0) {
+        return RejectBody_("不支持的 Expect", 417);
+    }
+    // PUT 的请求体由 HandlePutFile 准备好文件之后再要
+    if (!request_.IsStreamBody() && static_cast<long long>(readBuff_.ReadableBytes()) < length) {
+        ContinueIfExpected_();
+    }
+    return true;
+}
+
+bool HttpConn::RejectBody_(const std::string& message, int code) {
+    response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, code);
+    response_.SetJsonError(message, code);
+    isJsonResponse = true;
+    return false;
+}
+
+void HttpConn::ContinueIfExpected_() {
+    if (request_.header().count("Expect") == 0) return;
+    static const char CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+    // 只有二十几个字节，刚建立的连接发送缓冲区是空的；万一没发出去，客户端等一会儿也会直接发请求体
+    send(fd_, CONTINUE, sizeof(CONTINUE) - 1, MSG_NOSIGNAL);
+}
+
+void HttpConn::AsyncDb_(std::function<void()> work, std::function<void()> then) {
+    // 只记录下来，等 process 中路由全部结束后再提交，避免回调和当前线程同时改连接状态
+    asyncThen_ = std::move(then);
+    asyncSubmit_ = [work](std::function<void()> done) {
+        if (DbExecutor::Instance()->Submit(work, std::move(done))) return true;
+        work();  // 执行器未启动或队列已满，退回同步执行
+        return false;
+    };
+}
+
+void HttpConn::AsyncDisk_(std::shared_ptr<const UploadedFile> file, int userId,
+                          std::shared_ptr<DiskWriteResult> result, std::function<void()> then) {
+    asyncThen_ = std::move(then);
+    asyncSubmit_ = [file, userId, result](std::function<void()> done) {
+        // 完成通知借用 DB 执行器的 eventfd，它没启动时只能同步写
+        bool async = DbExecutor::Instance()->IsRunning() && DiskWriter::Instance()->IsRunning();
+        if (async && DiskWriter::Instance()->Submit(file, userId, result, std::move(done))) return true;
+        if (async) {
+            result->busy = true;  // 队列满说明磁盘跟不上，不在工作线程上硬写，让客户端稍后重试
+        } else {
+            DiskWriter::WriteNow(*file, userId, *result);
+        }
+        return false;
+    };
+}
+
+bool HttpConn::SubmitAsync_() {
+    std::function<bool(std::function<void()>)> submit = std::move(asyncSubmit_);
+    std::function<void()> then = std::move(asyncThen_);
+    asyncSubmit_ = nullptr;
+    asyncThen_ = nullptr;
+
+    uint64_t ticket = gate_.Ticket();
+    bool ok = submit([this, ticket, then]() {
+        // 超时关闭可能同时在主线程进行，核对代数、构造响应和注册写事件都在闸门的锁里
+        bool current = gate_.RunIf(ticket, [this, &then]() {
+            if (then) { then(); }
+            FinishResponse_();
+            if (asyncDone) { asyncDone(this); }
+        });
+        if (!current) {
+            LOG_DEBUG("drop async completion of closed client");
+        }
+    });
+    if (!ok && then) {
+        then();
+    }
+    return ok;
+}
+
+void HttpConn::FinishResponse_() {
     // 构造http响应
     response_.MakeResponse(writeBuff_,isJsonResponse);
     /* 响应头 */
     iov_[0].iov_base = const_cast<char*>(writeBuff_.Peek()); 
     iov_[0].iov_len = writeBuff_.ReadableBytes(); // 响应头和长度
     iovCnt_ = 1; // 默认只有响应头
+    iov_[1].iov_base = nullptr;
+    iov_[1].iov_len = 0;
 
+    sendLeft_ = 0;
     /* 文件 */
-    if(response_.FileLen() > 0  && response_.File()) {
+    if(response_.FileFd() >= 0) {
+        sendOffset_ = 0;
+        sendLeft_ = response_.FileLen();
+    }
+    else if(response_.FileLen() > 0  && response_.File()) {
         iov_[1].iov_base = response_.File();
         iov_[1].iov_len = response_.FileLen();
         iovCnt_ = 2; // 如果有文件，则同时发送响应头和文件
     }
-    LOG_INFO("filesize:%d, %d  to %d", response_.FileLen() , iovCnt_, ToWriteBytes());
+    /* JSON 响应体，同样不拷进 writeBuff_ */
+    else if(isJsonResponse && response_.BodyLen() > 0) {
+        iov_[1].iov_base = const_cast<char*>(response_.Body());
+        iov_[1].iov_len = response_.BodyLen();
+        iovCnt_ = 2;
+    }
+    /* 流式响应体，先取第一块，其余在 write 中发完一块取一块 */
+    else if(!isJsonResponse) {
+        stream_ = response_.TakeStream();
+        if(stream_ && !NextChunk_()) {
+            stream_.reset();
+            iovCnt_ = 1;   // 第一块就出错，只发头部，客户端按 Content-Length 会发现内容不完整
+        }
+    }
+    LOG_INFO("filesize:%zu, %d  to %zu", response_.FileLen() , iovCnt_, ToWriteBytes());
     //  当前请求处理完后，准备下一次请求，清空状态
     request_.Init();
-    return FINISH;
+}
+
+bool HttpConn::NextChunk_() {
+    const char* data = nullptr;
+    size_t len = 0;
+    if(!stream_->Next(data, len)) {
+        LOG_WARN("Client[%d] stream body failed", fd_);
+        stream_.reset();
+        return false;
+    }
+    iov_[1].iov_base = const_cast<char*>(data);
+    iov_[1].iov_len = len;
+    iovCnt_ = 2;
+    if(len == 0) { stream_.reset(); } // 已经生成完
+    return true;
 }
 
 void HttpConn::RouteRequest() {
@@ -165,20 +382,54 @@ void HttpConn::RouteRequest() {
     const auto& path = request_.path();
     cout<<"method:"<<method.c_str()<<endl;
     cout<<"path:"<<path.c_str()<<endl;
+    if (path == "/uploads" || path.find("/uploads/") == 0) {
+        // 断点续传接口，POST/HEAD/PATCH/DELETE 都在这里分发
+        response_.Init(srcDir, request_.path(), request_.body(), request_.header(), request_.IsKeepAlive(), 200);
+        isJsonResponse = true;
+        if (method == "HEAD") { response_.OmitBody(); }
+        if (!ExtractLoginFromCookie()) {
+            response_.SetJsonError("请先登录后再上传文件", 403);
+            return;
+        }
+        HandleResumable();
+        return;
+    }
     if (method == "GET") {
         if (path.find("/showlist") != std::string::npos) {
             if (!ExtractLoginFromCookie()) {
                 response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 403);
-                response_.SetJsonResponse("请先登录后再查看文件列表", 403);
+                response_.SetJsonError("请先登录后再查看文件列表", 403);
                 isJsonResponse = true;
                 return;
             }
-        
-            std::string jsonStr = GetSQLFileListJson(); // 已登录，安全查询
-            response_.SetJsonResponse(jsonStr, 200);    // 返回 JSON 列表
+            HandleFileList();
             isJsonResponse = true;
+        } else if (path == "/files/search") {
+            if (!ExtractLoginFromCookie()) {
+                response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 403);
+                response_.SetJsonError("请先登录后再搜索文件", 403);
+                isJsonResponse = true;
+                return;
+            }
+            HandleSearch();
             isJsonResponse = true;
-        }else if (path.find("/logout") != std::string::npos) {
+        } else if (path.find("/download/") == 0) {
+            if (!ExtractLoginFromCookie()) {
+                response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 403);
+                response_.SetJsonError("请先登录后再下载文件", 403);
+                isJsonResponse = true;
+                return;
+            }
+            HandleDownload();           // 回调里按查询结果决定返回文件还是 JSON 错误
+        } else if (path == "/export") {
+            if (!ExtractLoginFromCookie()) {
+                response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 403);
+                response_.SetJsonError("请先登录后再下载文件", 403);
+                isJsonResponse = true;
+                return;
+            }
+            HandleExport();             // 回调里决定返回 zip 流还是 JSON 错误
+        } else if (path.find("/logout") != std::string::npos) {
             HandleLogout();             // 登出入口
             isJsonResponse = false;
         } 
@@ -189,12 +440,21 @@ void HttpConn::RouteRequest() {
         if (path.find("/login") == 0 || path.find("/register") == 0) {
             HandleUserAuth();  // 设置 path_ 和 code_
             isJsonResponse = false;
+        } else if (path == "/delete/batch") {
+            if (!ExtractLoginFromCookie()) {
+                response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 403);
+                response_.SetJsonError("请先登录后再删除文件", 403);
+                isJsonResponse = true;
+                return;
+            }
+            HandleBatchDelete();
+            isJsonResponse = true;
         } else if (path.find("/upload") == 0) {
 
             if (!ExtractLoginFromCookie()) {
                 // 未登录，直接返回 403 Forbidden
                 response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 403);
-                response_.SetJsonResponse("请先登录后再上传文件",403);
+                response_.SetJsonError("请先登录后再上传文件", 403);
 
                 isJsonResponse = true;
                 return;
@@ -202,7 +462,15 @@ void HttpConn::RouteRequest() {
             HandleUpload();  // 处理上传
             isJsonResponse = true;
         }
-    } else if (method == "DELETE" && path.find("/delete") == 0) {
+    } else if (method == "PUT" && path.find("/files/") == 0) {
+        HandlePutFile();  // 请求头已经到齐，请求体随后直接写进文件
+    } else if (method == "DELETE" && path.find("/delete/") == 0) {
+        if (!ExtractLoginFromCookie()) {
+            response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 403);
+            response_.SetJsonError("请先登录后再删除文件", 403);
+            isJsonResponse = true;
+            return;
+        }
         HandleDelete();  // 设置删除路径
         isJsonResponse = true;
     } else {
@@ -215,22 +483,51 @@ void HttpConn::HandleUserAuth() {
     std::cout << "开始处理验证和注册任务...." << std::endl;
 
     bool isLogin = (request_.path().find("/login") != std::string::npos);
-    const std::string& username = request_.GetPost("username");
-    const std::string& password = request_.GetPost("password");
+    std::string username = request_.GetPost("username");
+    std::string password = request_.GetPost("password");
 
     std::cout << "username: " << username << std::endl;
-    std::cout << "password: " << password << std::endl;
 
-    int userID;
-    std::string token;
-    bool success = false;
+    // 数据库部分在 DB 线程执行；bcrypt 是纯计算，留在工作线程
+    struct AuthResult {
+        bool success = false;
+        int userID = 0;
+        std::string hash;
+    };
+    auto result = std::make_shared<AuthResult>();
+    AuthService* auth = authService_.get();
 
+    UserDirectory* dir = UserDirectory::Instance();
     if (isLogin) {
-        success = authService_->Login(username, password, token, userID);
+        if (!dir->MayExist(username) || dir->Get(username, result->hash, result->userID)) {
+            // 过滤器判定用户不存在，或者缓存里有密码哈希，都不用去 DB 线程
+            std::string token;
+            bool success = !result->hash.empty() && auth->FinishLogin(password, result->hash, result->userID, token);
+            ReplyUserAuth_(true, success, result->userID, token);
+            return;
+        }
+        AsyncDb_([username, result]() {
+            result->success = UserService::GetUserPasswordHash(username, result->hash, result->userID);
+        }, [this, auth, password, result]() {
+            std::string token;
+            bool success = result->success && auth->FinishLogin(password, result->hash, result->userID, token);
+            ReplyUserAuth_(true, success, result->userID, token);
+        });
     } else {
-        success = authService_->Register(username, password, userID);
+        if (dir->Get(username, result->hash, result->userID)) {
+            ReplyUserAuth_(false, false, 0, "");  // 缓存里有，用户名已被占用，省掉一次 bcrypt
+            return;
+        }
+        std::string hash = AuthService::HashPassword(password);
+        AsyncDb_([auth, username, hash, result]() {
+            result->success = auth->RegisterHashed(username, hash, result->userID);
+        }, [this, result]() {
+            ReplyUserAuth_(false, result->success, result->userID, "");
+        });
     }
+}
 
+void HttpConn::ReplyUserAuth_(bool isLogin, bool success, int userID, const std::string& token) {
     if (success) {
         if (isLogin) {
             // 登录成功 → 欢迎页面
@@ -240,7 +537,7 @@ void HttpConn::HandleUserAuth() {
             request_.path() = "/login.html";
         }
         response_.Init(srcDir, request_.path(), request_.body(), request_.header(), request_.IsKeepAlive(), 200);
-        ForceLoginUser(userID);
+        ForceLoginUser(userID, token); // 登录时复用 Login 已创建的会话，注册时新建
     } else {
         request_.path() = "/error.html";
         response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 400);
@@ -249,60 +546,690 @@ void HttpConn::HandleUserAuth() {
 
 void HttpConn::HandleUpload() {
     cout<<"开始处理上传"<<endl;
-    if (request_.GetUserID() <= 0) {
-        response_.SetJsonResponse(R"({"error":"未登录，禁止上传"})", 403);
+    int userId = request_.GetUserID();
+    if (userId <= 0) {
+        response_.SetJsonError("未登录，禁止上传", 403);
+        return;
+    }
+
+    if (request_.IsStreamBody()) {
+        // 大文件表单：不攒请求体，边收边解析边写文件，收齐后入库。响应之后连接关闭：出错时请求体可能还没读完
+        response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 200);
+        long long length = std::stoll(request_.header()["Content-Length"]);   // IsLargeForm_ 已校验过
+        auto put = std::make_unique<PutUpload>();
+        put->form = std::make_unique<MultipartReader>(request_.header()["Content-Type"]);
+        if (!put->form->Valid()) {
+            response_.SetJsonError("上传数据解析失败", 400);
+            return;
+        }
+        put->writer = std::make_unique<BlobWriter>();
+        if (!put->writer->Open()) {
+            response_.SetJsonError("保存失败", 500);
+            return;
+        }
+        PutUpload* p = put.get();
+        put->form->onData = [p](const char* data, size_t len) {
+            if (p->writer->Write(data, len)) return true;
+            p->error = errno ? errno : EIO;
+            return false;
+        };
+        put->userId = userId;
+        // 和请求头一起读进来的那部分请求体由 ContinuePut_ 先解析掉
+        put->remaining = length - std::min<long long>(length, readBuff_.ReadableBytes());
+        put_ = std::move(put);
+        if (readBuff_.ReadableBytes() == 0) { ContinueIfExpected_(); }
         return;
     }
 
-    UploadedFile file;
-    if (request_.ParseMultipartFormData(request_.header()["Content-Type"], request_.body(), file)) {
-        if (UploadService::SaveUploadedFile(file, request_.GetUserID())) {
-            response_.SetJsonResponse(R"({"status":"success"})", 200);
+    auto file = std::make_shared<UploadedFile>();
+    if (!request_.ParseMultipartFormData(request_.header()["Content-Type"], request_.body(), *file)) {
+        response_.SetJsonError("上传数据解析失败", 400);
+        return;
+    }
+    auto result = std::make_shared<DiskWriteResult>();
+    AsyncDisk_(file, userId, result, [this, result]() {
+        if (result->ok) {
+            // durable 告诉客户端响应前是否已经落盘，NONE 策略下为 false
+            JsonWriter writer(response_.JsonBody(200));
+            writer.BeginObject()
+                  .Key("status").String("success")
+                  .Key("sha256").String(result->hash)
+                  .Key("durable").Bool(result->durable)
+                  .EndObject();
+        } else if (result->busy) {
+            response_.SetJsonError("服务器繁忙，请稍后重试", 503);
+            response_.AddHeader("Retry-After", "1");
         } else {
-            response_.SetJsonResponse(R"({"error":"保存失败"})", 500);
+            response_.SetJsonError("保存失败", 500);
         }
+    });
+}
+
+// 断点续传的结果映射成 HTTP 状态码，tus 客户端按状态码决定是否重查偏移
+static void ReplyResumableError(HttpResponse& response, ResumableUpload::Result r) {
+    switch (r) {
+    case ResumableUpload::NOT_FOUND: response.SetJsonError("上传会话不存在", 404); break;
+    case ResumableUpload::CONFLICT:  response.SetJsonError("Upload-Offset 与服务端不一致", 409); break;
+    case ResumableUpload::TOO_LARGE: response.SetJsonError("超出声明的上传长度", 413); break;
+    default:                         response.SetJsonError("保存失败", 500); break;
+    }
+}
+
+void HttpConn::HandleResumable() {
+    std::string method = request_.method();
+    std::string id = request_.path().substr(std::min(request_.path().size(), strlen("/uploads/")));
+    int userId = request_.GetUserID();
+    auto& header = request_.header();
+    auto headerValue = [&header](const char* key) {
+        auto it = header.find(key);
+        return it == header.end() ? std::string() : it->second;
+    };
+    response_.AddHeader("Tus-Resumable", "1.0.0");
+
+    if (method == "POST" && id.empty()) {
+        long long length = -1;
+        try { length = std::stoll(headerValue("Upload-Length")); } catch (...) {}
+        std::string filename, contentType;
+        if (length < 0 || !ResumableUpload::ParseMetadata(headerValue("Upload-Metadata"), filename, contentType)) {
+            response_.SetJsonError("缺少 Upload-Length 或 Upload-Metadata 中的 filename", 400);
+            return;
+        }
+        std::string newId;
+        ResumableUpload::Result r = ResumableUpload::Instance()->Create(userId, length, filename, contentType, newId);
+        if (r != ResumableUpload::OK) {
+            ReplyResumableError(response_, r);
+            return;
+        }
+        std::string location = "/uploads/" + newId;
+        JsonWriter writer(response_.JsonBody(201));
+        writer.BeginObject().Key("id").String(newId).Key("location").String(location).EndObject();
+        response_.AddHeader("Location", location);
+        response_.AddHeader("Upload-Offset", "0");
+        return;
+    }
+    if (id.empty()) {
+        response_.SetJsonError("缺少上传会话 id", 400);
+        return;
+    }
+
+    if (method == "HEAD") {
+        UploadSession s;
+        ResumableUpload::Result r = ResumableUpload::Instance()->Query(id, userId, s);
+        if (r != ResumableUpload::OK) {
+            ReplyResumableError(response_, r);
+            return;
+        }
+        response_.SetJsonResponse("", 204);
+        response_.AddHeader("Upload-Offset", std::to_string(s.offset));
+        response_.AddHeader("Upload-Length", std::to_string(s.length));
+        response_.AddHeader("Cache-Control", "no-store");
+    } else if (method == "PATCH") {
+        if (headerValue("Content-Type") != "application/offset+octet-stream") {
+            response_.SetJsonError("Content-Type 必须是 application/offset+octet-stream", 415);
+            return;
+        }
+        long long offset = -1;
+        try { offset = std::stoll(headerValue("Upload-Offset")); } catch (...) {}
+        if (offset < 0) {
+            response_.SetJsonError("缺少 Upload-Offset", 400);
+            return;
+        }
+        // 分片从请求里移出来交给 DB 线程写盘，不再复制一份
+        auto chunk = std::make_shared<std::string>(std::move(request_.body()));
+        struct PatchResult {
+            ResumableUpload::Result r = ResumableUpload::FAILED;
+            UploadSession s;
+            bool completed = false;
+        };
+        auto result = std::make_shared<PatchResult>();
+        AsyncDb_([id, userId, offset, chunk, result]() {
+            result->r = ResumableUpload::Instance()->Append(id, userId, offset, chunk->data(), chunk->size(),
+                                                            result->s, result->completed);
+        }, [this, result]() {
+            if (result->r == ResumableUpload::CONFLICT) {
+                response_.AddHeader("Upload-Offset", std::to_string(result->s.offset));  // 客户端据此直接续传
+            }
+            if (result->r != ResumableUpload::OK) {
+                ReplyResumableError(response_, result->r);
+                return;
+            }
+            response_.SetJsonResponse("", 204);
+            response_.AddHeader("Upload-Offset", std::to_string(result->s.offset));
+        });
+    } else if (method == "DELETE") {
+        ResumableUpload::Result r = ResumableUpload::Instance()->Abort(id, userId);
+        if (r != ResumableUpload::OK) {
+            ReplyResumableError(response_, r);
+            return;
+        }
+        response_.SetJsonResponse("", 204);
     } else {
-        response_.SetJsonResponse(R"({"error":"上传数据解析失败"})", 400);
+        response_.SetJsonError("不支持的请求方法", 400);
     }
 }
 
+HttpConn::PutUpload::~PutUpload() {
+    if (pipe[0] >= 0) { close(pipe[0]); }
+    if (pipe[1] >= 0) { close(pipe[1]); }
+}
+
+void HttpConn::HandlePutFile() {
+    // 响应之后连接关闭：被拒绝时请求体还留在 socket 里
+    response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 201);
+    isJsonResponse = true;
+    if (!ExtractLoginFromCookie()) {
+        response_.SetJsonError("请先登录后再上传文件", 403);
+        return;
+    }
+    std::string filename = HttpRequest::UrlDecode(request_.path().substr(strlen("/files/")));
+    if (filename.empty() || filename.find('/') != std::string::npos) {
+        response_.SetJsonError("文件名无效", 400);
+        return;
+    }
+    auto& header = request_.header();
+    long long length = -1;
+    auto it = header.find("Content-Length");
+    if (it != header.end()) {
+        try { length = std::stoll(it->second); } catch (...) {}
+    }
+    if (length < 0) {
+        response_.SetJsonError("需要 Content-Length", 411);
+        return;
+    }
+
+    auto put = std::make_unique<PutUpload>();
+    put->writer = std::make_unique<BlobWriter>();
+    if (!put->writer->Open() || pipe2(put->pipe, O_CLOEXEC) != 0) {
+        response_.SetJsonError("保存失败", 500);
+        return;
+    }
+    fcntl(put->pipe[1], F_SETPIPE_SZ, 1 << 20);   // 管道大一些，每次 splice 搬得多一些，失败就用默认的 64K
+    // 先按 Content-Length 占好空间，磁盘不够时在读请求体之前就拒绝
+    if (!put->writer->Reserve(length)) {
+        if (errno == ENOSPC) {
+            response_.SetJsonError("存储空间不足", 507);
+        } else {
+            response_.SetJsonError("保存失败", 500);
+        }
+        return;
+    }
+    it = header.find("Content-Type");
+    put->contentType = it == header.end() ? "application/octet-stream" : it->second;
+    put->filename = filename;
+    put->userId = request_.GetUserID();
+    put->remaining = length;
+    put_ = std::move(put);
+    if (readBuff_.ReadableBytes() == 0) { ContinueIfExpected_(); }
+}
+
+ssize_t HttpConn::SpliceBody_(int* saveErrno) {
+    PutUpload& put = *put_;
+    ssize_t totalLen = 0;
+    while (put.remaining > 0 && put.error == 0) {
+        size_t want = static_cast<size_t>(std::min<long long>(put.remaining, 1 << 20));
+        ssize_t len = splice(fd_, nullptr, put.pipe[1], nullptr, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (len < 0) {
+            *saveErrno = errno;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        if (len == 0) break;  // 对端关闭连接
+        if (!put.writer->SpliceFrom(put.pipe[0], len)) {
+            put.error = errno ? errno : EIO;  // 交给 process() 回错误响应
+        }
+        put.remaining -= len;
+        totalLen += len;
+        if (!isET) break;  // LT 模式一次事件搬一轮
+    }
+    return totalLen;
+}
+
+ssize_t HttpConn::ReadForm_(int* saveErrno) {
+    PutUpload& put = *put_;
+    ssize_t totalLen = 0;
+    // 每轮最多读 256K 就交给解析器，readBuff_ 不会随请求体增长
+    while (put.remaining > 0 && put.error == 0) {
+        size_t want = static_cast<size_t>(std::min<long long>(put.remaining, 256 * 1024));
+        readBuff_.EnsureWriteable(want);
+        ssize_t len = ::read(fd_, readBuff_.BeginWrite(), want);
+        if (len < 0) {
+            *saveErrno = errno;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        if (len == 0) break;  // 对端关闭连接
+        readBuff_.HasWritten(len);
+        put.remaining -= len;
+        totalLen += len;
+        FeedForm_();
+        if (!isET) break;  // LT 模式一次事件读一轮
+    }
+    return totalLen;
+}
+
+void HttpConn::FeedForm_() {
+    PutUpload& put = *put_;
+    if (put.error != 0) return;
+    put.formState = put.form->Feed(readBuff_);
+    if (put.formState == MultipartReader::ERROR && put.error == 0) {
+        put.error = EBADMSG;  // 表单格式错误；写文件失败时 onData 已经记下了 errno
+    }
+}
+
+HttpConn::PROCESS_STATE HttpConn::ContinuePut_() {
+    PutUpload& put = *put_;
+    if (put.form) {
+        if (readBuff_.ReadableBytes() > 0) { FeedForm_(); }
+        if (put.error == 0 && put.remaining == 0
+            && (put.formState != MultipartReader::DONE || !put.form->HasFile())) {
+            put.error = EBADMSG;  // 请求体收齐了，表单却没结束或没有文件
+        }
+    }
+    // 和请求头一起读进 readBuff_ 的那部分请求体先写掉
+    else if (put.remaining > 0 && readBuff_.ReadableBytes() > 0 && put.error == 0) {
+        size_t len = static_cast<size_t>(std::min<long long>(put.remaining, readBuff_.ReadableBytes()));
+        if (!put.writer->Write(readBuff_.Peek(), len)) {
+            put.error = errno ? errno : EIO;
+        }
+        readBuff_.Retrieve(len);
+        put.remaining -= len;
+    }
+    if (put.error == EBADMSG) {
+        response_.SetJsonError("上传数据解析失败", 400);
+        put_.reset();
+        FinishResponse_();
+        return FINISH;
+    }
+    if (put.error != 0) {
+        response_.SetJsonError(put.error == ENOSPC ? "存储空间不足" : "保存失败", put.error == ENOSPC ? 507 : 500);
+        put_.reset();
+        FinishResponse_();
+        return FINISH;
+    }
+    if (put.remaining > 0) {
+        return AGAIN;
+    }
+
+    // 请求体收齐，摘要和入库放到 DB 线程
+    std::shared_ptr<BlobWriter> writer(std::move(put.writer));
+    std::string filename = put.form ? put.form->Filename() : put.filename;
+    std::string contentType = put.form ? put.form->ContentType() : put.contentType;
+    int userId = put.userId;
+    int code = put.form ? 200 : 201;   // 表单上传和小文件的 POST /upload 一样回 200
+    put_.reset();
+    auto ok = std::make_shared<bool>(false);
+    AsyncDb_([writer, filename, contentType, userId, ok]() {
+        *ok = UploadService::CommitBlob(*writer, filename, contentType, userId);
+    }, [this, ok, code]() {
+        if (*ok) {
+            response_.SetJsonStatus("success", code);
+        } else {
+            response_.SetJsonError("保存失败", 500);
+        }
+    });
+    if (SubmitAsync_()) {
+        return PENDING;
+    }
+    FinishResponse_();
+    return FINISH;
+}
+
 void HttpConn::HandleDelete() {
-    std::string filename = request_.path().substr(strlen("/delete/"));
-    bool ok = UploadService::DeleteFile(filename, request_.GetUserID());
+    std::string filename = HttpRequest::UrlDecode(request_.path().substr(strlen("/delete/")));  // 前端用 encodeURIComponent 编码
+    int userId = request_.GetUserID();
+    auto ok = std::make_shared<bool>(false);
 
-    if (ok) {
-        response_.Init(srcDir, request_.path(), request_.body(), request_.header(), request_.IsKeepAlive(), 200);
-    } else {
-        response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 400);
+    AsyncDb_([filename, userId, ok]() {
+        *ok = UploadService::DeleteFile(filename, userId);
+    }, [this, ok]() {
+        if (*ok) {
+            response_.Init(srcDir, request_.path(), request_.body(), request_.header(), request_.IsKeepAlive(), 200);
+            response_.SetJsonStatus("success", 200);
+        } else {
+            response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 400);
+            response_.SetJsonError("删除失败", 400);
+        }
+    });
+}
+
+void HttpConn::HandleBatchDelete() {
+    // 请求体 {"files": ["a.txt", "b.png", ...]}，一次 DB 往返删完，文件由后台回收
+    response_.Init(srcDir, request_.path(), request_.body(), request_.header(), request_.IsKeepAlive(), 200);
+    nlohmann::json body = nlohmann::json::parse(request_.body(), nullptr, false);
+    if (body.is_discarded() || !body.is_object() || !body.contains("files") || !body["files"].is_array()) {
+        response_.SetJsonError("请求体应为 {\"files\": [...]}", 400);
+        return;
+    }
+    auto names = std::make_shared<std::vector<std::string>>();
+    std::unordered_set<std::string> seen;
+    for (const auto& item : body["files"]) {
+        if (!item.is_string()) {
+            response_.SetJsonError("文件名必须是字符串", 400);
+            return;
+        }
+        if (seen.insert(item.get<std::string>()).second) { names->push_back(item.get<std::string>()); }
+    }
+    if (names->empty()) {
+        response_.SetJsonError("文件列表为空", 400);
+        return;
+    }
+    if (names->size() > static_cast<size_t>(Config::deleteBatchMax)) {
+        response_.SetJsonError("一次最多删除 " + std::to_string(Config::deleteBatchMax) + " 个文件", 413);
+        return;
     }
+
+    int userId = request_.GetUserID();
+    auto deleted = std::make_shared<std::vector<std::string>>();
+    auto ok = std::make_shared<bool>(false);
+    AsyncDb_([names, userId, deleted, ok]() {
+        *ok = UploadService::DeleteFiles(*names, userId, *deleted);
+    }, [this, names, deleted, ok]() {
+        if (!*ok) {
+            response_.SetJsonError("删除失败", 500);
+            return;
+        }
+        std::unordered_set<std::string> done(deleted->begin(), deleted->end());
+        JsonWriter writer(response_.JsonBody(200));
+        writer.BeginObject().Key("status").String("success").Key("deleted").BeginArray();
+        for (const std::string& name : *deleted) { writer.String(name); }
+        writer.EndArray().Key("notFound").BeginArray();
+        for (const std::string& name : *names) {
+            if (!done.count(name)) { writer.String(name); }
+        }
+        writer.EndArray().EndObject();
+    });
 }
 
-string HttpConn::GetSQLFileListJson() {
-    cout<<"数据库中读取文件信息"<<endl;
-    nlohmann::json jsonResponse;
+void HttpConn::HandleDownload() {
+    int userId = request_.GetUserID();
+    std::string filename = HttpRequest::UrlDecode(request_.path().substr(strlen("/download/")));
+    auto info = std::make_shared<UploadedFileInfo>();
+    auto found = std::make_shared<bool>(false);
+
+    AsyncDb_([userId, filename, info, found]() {
+        *found = UploadService::GetFile(userId, filename, *info);
+    }, [this, filename, info, found]() {
+        ReplyDownload_(*found, filename, *info);
+    });
+}
+
+// RFC 5987 的 filename*，非 ASCII 文件名按 UTF-8 百分号编码
+static std::string EncodeDispositionName(const std::string& name) {
+    static const char HEX[] = "0123456789ABCDEF";
+    std::string out;
+    for (unsigned char c : name) {
+        if (isalnum(c) || strchr("!#$&+-.^_`|~", c)) {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += HEX[c >> 4];
+            out += HEX[c & 0xf];
+        }
+    }
+    return out;
+}
 
-    int currentUserId = request_.GetUserID();
-    if (currentUserId <= 0) {
-        std::cout << "未登录用户尝试获取文件列表" << std::endl;
-        return R"({"error": "未登录"})";  // 保险：不应该到这一步
+void HttpConn::ReplyDownload_(bool found, const std::string& filename, const UploadedFileInfo& info) {
+    if (!found) {
+        response_.Init(srcDir, request_.path(), request_.body(), request_.header(), request_.IsKeepAlive(), 404);
+        response_.SetJsonError("文件不存在", 404);
+        isJsonResponse = true;
+        return;
+    }
+    // blob 不在静态资源目录下，file_path 本身就是相对工作目录的完整路径
+    std::string path = info.file_path;
+    response_.Init("", path, request_.body(), request_.header(), request_.IsKeepAlive(), 200);
+    response_.SetContentType(info.file_type.empty() ? "application/octet-stream" : info.file_type);
+    response_.AddHeader("Content-Disposition", "attachment; filename*=UTF-8''" + EncodeDispositionName(filename));
+    if (!info.content_hash.empty()) {
+        // 内容不变则摘要不变，可以直接作为强 ETag
+        response_.AddHeader("ETag", "\"" + info.content_hash + "\"");
     }
+    isJsonResponse = false;
+}
 
-    // 只查询当前用户的文件
-    std::vector<UploadedFileInfo> fileInfos = UploadService::QueryAllFiles(currentUserId);
+void HttpConn::HandleExport() {
+    // ?files=a,b 只打包这几个（缺一个就 404），不带则打包当前用户的全部文件
+    int userId = request_.GetUserID();
+    auto wanted = std::make_shared<std::vector<std::string>>();
+    std::string files = request_.GetQuery("files");
+    std::unordered_set<std::string> seen;
+    size_t start = 0;
+    while (start <= files.size() && !files.empty()) {
+        size_t comma = files.find(',', start);
+        if (comma == std::string::npos) comma = files.size();
+        std::string name = files.substr(start, comma - start);
+        if (!name.empty() && seen.insert(name).second) { wanted->push_back(name); }
+        start = comma + 1;
+    }
+    if (wanted->size() > static_cast<size_t>(Config::exportMaxFiles)) {
+        response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 413);
+        response_.SetJsonError("一次最多打包 " + std::to_string(Config::exportMaxFiles) + " 个文件", 413);
+        isJsonResponse = true;
+        return;
+    }
 
-    // 将每个文件信息转换为 JSON 格式
-    for (const auto& file : fileInfos) {
-        nlohmann::json fileJson;
-        fileJson["filename"] = file.original_filename;
-        fileJson["upload_time"] = file.upload_time;
-        fileJson["user_id"] = file.uploader_id;
-        fileJson["size"] = file.file_size;
-        jsonResponse.push_back(fileJson);
+    auto zip = std::make_shared<ZipStream>(Config::exportChunkBytes);
+    auto notFound = std::make_shared<std::vector<std::string>>();
+    auto code = std::make_shared<int>(200);
+    AsyncDb_([userId, wanted, zip, notFound, code]() {
+        std::vector<UploadedFileInfo> rows;
+        if (!UploadService::QueryAllFiles(userId, rows)) {
+            *code = 500;
+            return;
+        }
+        // 按上传时间倒序，同名文件只取最新的一份，和下载接口一致
+        std::unordered_map<std::string, const UploadedFileInfo*> latest;
+        for (const UploadedFileInfo& row : rows) {
+            latest.emplace(row.original_filename, &row);
+        }
+        std::vector<const UploadedFileInfo*> picked;
+        if (wanted->empty()) {
+            for (const UploadedFileInfo& row : rows) {
+                if (latest[row.original_filename] == &row) { picked.push_back(&row); }
+            }
+        } else {
+            for (const std::string& name : *wanted) {
+                auto it = latest.find(name);
+                if (it == latest.end()) {
+                    notFound->push_back(name);
+                } else {
+                    picked.push_back(it->second);
+                }
+            }
+        }
+        if (picked.size() > static_cast<size_t>(Config::exportMaxFiles)) {
+            *code = 413;
+            return;
+        }
+        // 只在这里 stat，一个字节都不读；内容在发送时才读
+        for (const UploadedFileInfo* row : picked) {
+            std::string entry = row->original_filename;
+            std::replace(entry.begin(), entry.end(), '\\', '_');
+            std::replace(entry.begin(), entry.end(), '/', '_');   // 解压时不会跑出目标目录
+            if (zip->AddFile(entry, row->file_path)) continue;
+            if (wanted->empty()) {
+                LOG_WARN("export: %s missing on disk, skipped", row->file_path.c_str());
+            } else {
+                notFound->push_back(row->original_filename);
+            }
+        }
+        if (!notFound->empty()) { *code = 404; }
+    }, [this, zip, notFound, code]() {
+        if (*code == 200) {
+            response_.Init("", request_.path(), request_.body(), request_.header(), request_.IsKeepAlive(), 200);
+            response_.SetStream(zip, 200);
+            response_.SetContentType("application/zip");
+            response_.AddHeader("Content-Disposition", "attachment; filename=\"export.zip\"");
+            isJsonResponse = false;
+            return;
+        }
+        response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, *code);
+        isJsonResponse = true;
+        if (*code == 404) {
+            JsonWriter writer(response_.JsonBody(404));
+            writer.BeginObject().Key("error").String("文件不存在").Key("notFound").BeginArray();
+            for (const std::string& name : *notFound) { writer.String(name); }
+            writer.EndArray().EndObject();
+        } else if (*code == 413) {
+            response_.SetJsonError("一次最多打包 " + std::to_string(Config::exportMaxFiles) + " 个文件", 413);
+        } else {
+            response_.SetJsonError("查询失败", 500);
+        }
+    });
+}
+
+void HttpConn::HandleFileList() {
+    int userId = request_.GetUserID();
+    response_.Init(srcDir, request_.path(), request_.body(), request_.header(), request_.IsKeepAlive(), 200);
+
+    int limit = Config::fileListPageSize;
+    std::string limitStr = request_.GetQuery("limit");
+    if (!limitStr.empty()) {
+        limit = std::max(1, std::min(atoi(limitStr.c_str()), Config::fileListPageMax));
     }
+    std::string after = request_.GetQuery("after");
 
-    std::string jsonStr = jsonResponse.dump();
-    cout<<jsonStr<<endl;
-    return jsonStr; 
+    FileListEntry cached;
+    if (after.empty() && limit == Config::fileListPageSize
+        && FileListCache::Instance()->Get(userId, cached)) {
+        // 默认第一页命中缓存，不用进 DB 线程，发送时也不复制
+        ReplyFileList_(cached, limit, after);
+        return;
+    }
+    auto list = std::make_shared<FileListEntry>();
+    AsyncDb_([userId, limit, after, list]() {
+        *list = LoadFileList(userId, limit, after);
+    }, [this, list, limit, after]() {
+        ReplyFileList_(*list, limit, after);
+    });
+}
+
+void HttpConn::HandleSearch() {
+    int userId = request_.GetUserID();
+    response_.Init(srcDir, request_.path(), request_.body(), request_.header(), request_.IsKeepAlive(), 200);
+
+    std::string query = request_.GetQuery("q");
+    if (query.empty()) {
+        response_.SetJsonError("缺少查询参数 q", 400);
+        return;
+    }
+    int limit = Config::searchResultDefault;
+    std::string limitStr = request_.GetQuery("limit");
+    if (!limitStr.empty()) {
+        limit = std::max(1, std::min(atoi(limitStr.c_str()), Config::searchResultMax));
+    }
+
+    auto hits = std::make_shared<std::vector<FileSearchHit>>();
+    if (FileSearchIndex::Instance()->TrySearch(userId, query, limit, *hits)) {
+        // 索引已在内存里，不用进 DB 线程
+        ReplySearch_(*hits);
+        return;
+    }
+    // 该用户第一次搜索，到 DB 线程读一遍上传记录建索引
+    auto ok = std::make_shared<bool>(false);
+    AsyncDb_([userId, query, limit, hits, ok]() {
+        *ok = FileSearchIndex::Instance()->Search(userId, query, limit, *hits);
+    }, [this, hits, ok]() {
+        if (*ok) {
+            ReplySearch_(*hits);
+        } else {
+            response_.SetJsonError("搜索失败", 500);
+        }
+    });
+}
+
+void HttpConn::ReplySearch_(const std::vector<FileSearchHit>& hits) {
+    // 和 /showlist 一样是数组，match 标明前缀匹配还是子串匹配，前缀匹配的排在前面
+    JsonWriter writer(response_.JsonBody(200));
+    writer.BeginArray();
+    for (const FileSearchHit& hit : hits) {
+        writer.BeginObject()
+              .Key("filename").String(hit.filename)
+              .Key("upload_time").String(hit.uploadTime)
+              .Key("size").Int(hit.size)
+              .Key("match").String(hit.prefix ? "prefix" : "substring")
+              .EndObject();
+    }
+    writer.EndArray();
+    response_.AddHeader("Cache-Control", "private, no-cache");
+}
+
+FileListEntry HttpConn::LoadFileList(int userId, int limit, const std::string& after) {
+    if (after.empty() && limit == Config::fileListPageSize) {
+        // 默认第一页只在上传/删除时变化，进缓存
+        return FileListCache::Instance()->GetOrLoad(userId, [userId, limit](std::string& json, std::string& next) {
+            Buffer buff(4096);
+            if (!GetSQLFileListJson(userId, limit, "", buff, next)) return false;
+            json = buff.RetrieveAllToStr();
+            return true;
+        });
+    }
+    // 翻页请求不进缓存
+    FileListEntry list;
+    Buffer buff(4096);
+    if (GetSQLFileListJson(userId, limit, after, buff, list.nextCursor)) {
+        list.etag = FileListCache::MakeETag(buff.Peek(), buff.ReadableBytes());
+        list.json = std::make_shared<const std::string>(buff.RetrieveAllToStr());
+    } else {
+        list.nextCursor.clear();
+    }
+    return list;
+}
+
+void HttpConn::ReplyFileList_(const FileListEntry& list, int limit, const std::string& after) {
+    if (!list.json) {
+        std::string t;
+        int id;
+        if (!after.empty() && !UploadService::ParseCursor(after, t, id)) {
+            response_.SetJsonError("after 参数无效", 400);
+        } else {
+            response_.SetJsonError("查询文件列表失败", 500);
+        }
+        return;
+    }
+
+    response_.SetJsonBody(list.json, 200);
+    response_.AddHeader("ETag", list.etag);
+    response_.AddHeader("Cache-Control", "private, no-cache"); // 浏览器每次都带 If-None-Match 来确认
+    if (!list.nextCursor.empty()) {
+        // 响应体保持数组格式，下一页位置放在头部
+        response_.AddHeader("X-Next-Cursor", list.nextCursor);
+        response_.AddHeader("Link", "</showlist?limit=" + std::to_string(limit) + "&after=" + list.nextCursor + ">; rel=\"next\"");
+    }
+    auto it = request_.header().find("If-None-Match");
+    if (it != request_.header().end() && it->second == list.etag) {
+        response_.SetJsonResponse("", 304);
+    }
+}
+
+bool HttpConn::GetSQLFileListJson(int userId, int limit, const std::string& after,
+                                  Buffer& out, std::string& nextCursor) {
+    cout<<"数据库中读取文件信息"<<endl;
+    // 多取一行判断是否还有下一页；每行取出来直接编码进 out，不构建 JSON 树也不攒 vector
+    int count = 0;
+    bool more = false;
+    std::string lastCursor;
+    JsonWriter writer(out);
+    writer.BeginArray();
+    bool ok = UploadService::ForEachFile(userId, limit + 1, after, [&](const UploadedFileInfo& file) {
+        if (count == limit) {
+            more = true;
+            return;
+        }
+        writer.BeginObject()
+              .Key("filename").String(file.original_filename)
+              .Key("upload_time").String(file.upload_time)
+              .Key("user_id").Int(file.uploader_id)
+              .Key("size").Int(file.file_size)
+              .EndObject();
+        lastCursor = UploadService::MakeCursor(file);
+        count++;
+    });
+    if (!ok) return false;
+    writer.EndArray();
+    nextCursor = more ? lastCursor : "";
+    return true;
 }
 
 bool HttpConn::ExtractLoginFromCookie() {
@@ -328,6 +1255,7 @@ bool HttpConn::ExtractLoginFromCookie() {
     int userID = 0;
     if (authService_ && authService_->VerifyToken(token, userID)) {
         request_.SetUserID(userID);
+        RedisSessionManager::Instance()->RefreshSessionTTL(token); // 活跃用户滑动续期，后台合并批量执行
         std::cout << "登录验证成功，userID = " << userID << std::endl;
         return true;
     }
@@ -356,7 +1284,7 @@ string HttpConn::ParseTokenFromCookie(const std::string& cookieStr) {
 void HttpConn::HandleLogout() {
     std::string cookie = request_.header()["Cookie"];
     std::string token = ParseTokenFromCookie(cookie);
-    RedisSessionManager().DeleteSession(token);
+    RedisSessionManager::Instance()->DeleteSession(token);
     request_.path_ = "/login.html";
     response_.Init(srcDir, request_.path(), request_.body(), request_.header(), false, 200);
     response_.AddHeader("Set-Cookie", "token=; Max-Age=0; Path=/; HttpOnly");
@@ -375,14 +1303,15 @@ bool HttpConn::IsStaticResource(const std::string& path) {
     return false;
 }
 
-void HttpConn::ForceLoginUser(int userID) {
+void HttpConn::ForceLoginUser(int userID, const std::string& loginToken) {
     cout<<"设置token"<<endl;
     // 清除旧 cookie
     response_.AddHeader("Set-Cookie", "token=; Path=/; Max-Age=0; HttpOnly");
 
     // 设置新 cookie
-    std::string token = RedisSessionManager().CreateSession(userID, 3600);
+    std::string token = loginToken.empty() ? RedisSessionManager::Instance()->CreateSession(userID) : loginToken;
     cout<<"token:"<<token<<endl;
+    if (token.empty()) return;  // 会话没建成（存储出错或随机数不可用），不下发空 token
     response_.AddHeader("Set-Cookie", "token=" + token + "; Path=/; HttpOnly");
 
     request_.SetUserID(userID);
@@ -9,29 +9,45 @@
 
 #include <sys/types.h>
 #include <sys/uio.h>     // readv/writev
+#include <sys/sendfile.h>
+#include <fcntl.h>       // splice
 #include <arpa/inet.h>   // sockaddr_in
 #include <stdlib.h>      // atoi()
+#include <strings.h>     // strcasecmp
 #include <errno.h>     
 #include <fstream> 
+#include <algorithm>
 
 #include "../log/log.h"
 #include "../pool/sqlconnRAII.h"
+#include "../config/config.h"
 #include "../buffer/buffer.h"
 #include "../processing/UserService.h"
+#include "../processing/UserDirectory.h"
 #include "../processing/AuthService.h"
 #include "../processing/uploaded_file.h"
 #include "../processing/uploadservice.h"
+#include "../processing/FileListCache.h"
+#include "../processing/ResumableUpload.h"
+#include "../processing/DiskWriter.h"
+#include "../processing/ZipStream.h"
+#include "../processing/UserQuota.h"
+#include "../processing/FileSearchIndex.h"
+#include "../pool/dbexecutor.h"
+#include "../pool/completiongate.h"
 
 #include "../processing/RedisSessionManager .h"
 #include "httprequest.h"
 #include "httpresponse.h"
+#include "multipartreader.h"
 
 class HttpConn {
 public:
     enum  PROCESS_STATE {
     AGAIN,   // 数据还不够
     FINISH,  // 处理完成，准备写响应
-    ERROR    // 请求格式错误
+    ERROR,   // 请求格式错误
+    PENDING  // 等待数据库完成，回调里构造响应并调用 asyncDone
     };
     HttpConn();
 
@@ -52,8 +68,17 @@ public:
     void HandleUserAuth();
     void HandleUpload();
     void HandleDelete();
-    void ForceLoginUser(int userID);
-    string GetSQLFileListJson();
+    void HandleBatchDelete();
+    void HandleExport();
+    void ForceLoginUser(int userID, const std::string& token = "");
+    void HandleFileList();
+    void HandleSearch();
+    void HandleDownload();
+    void HandleResumable();
+    void HandlePutFile();
+    static FileListEntry LoadFileList(int userId, int limit, const std::string& after);
+    static bool GetSQLFileListJson(int userId, int limit, const std::string& after,
+                                   Buffer& out, std::string& nextCursor);
     bool ExtractLoginFromCookie();
     string ParseTokenFromCookie(const std::string& cookieStr);
     bool IsStaticResource(const std::string& path);
@@ -64,8 +89,9 @@ public:
     
     PROCESS_STATE process();
 
-    int ToWriteBytes() { 
-        return iov_[0].iov_len + iov_[1].iov_len; 
+    size_t ToWriteBytes() { 
+        // 流式响应体还没生成完时不能算发送结束
+        return iov_[0].iov_len + iov_[1].iov_len + sendLeft_ + (stream_ ? 1 : 0); 
     }
 
     bool IsKeepAlive() const {
@@ -75,6 +101,7 @@ public:
     static bool isET;
     static const char* srcDir;
     static std::atomic<int> userCount;
+    static std::function<void(HttpConn*)> asyncDone;  // 异步响应准备好后由 WebServer 注册写事件
     
 private:
    
@@ -92,7 +119,54 @@ private:
     HttpRequest request_;
     HttpResponse response_;
 
-    std::shared_ptr<sw::redis::Redis> redis_;
+    void FinishResponse_();
+    // 请求头到齐后按长度、登录和配额决定收不收请求体；拒绝时已设置好响应并返回 false
+    bool AdmitBody_();
+    bool RejectBody_(const std::string& message, int code);
+    void ContinueIfExpected_();   // 客户端带了 Expect: 100-continue 时通知它开始发请求体
+    bool NextChunk_();   // iov_[1] 发完后向 stream_ 要下一块，出错返回 false
+    void AsyncDb_(std::function<void()> work, std::function<void()> then);
+    void AsyncDisk_(std::shared_ptr<const UploadedFile> file, int userId,
+                    std::shared_ptr<DiskWriteResult> result, std::function<void()> then);
+    bool SubmitAsync_();
+    void ReplyUserAuth_(bool isLogin, bool success, int userID, const std::string& token);
+    void ReplyFileList_(const FileListEntry& list, int limit, const std::string& after);
+    void ReplySearch_(const std::vector<FileSearchHit>& hits);
+    void ReplyDownload_(bool found, const std::string& filename, const UploadedFileInfo& info);
+
+    /*
+     * PUT /files/{name} 的请求体：socket -> 管道 -> 文件，数据不经过用户态。
+     * POST /upload 的大表单也走这里：请求体分段读进 readBuff_，由 form 解析出文件内容写进 writer。
+     */
+    struct PutUpload {
+        std::unique_ptr<BlobWriter> writer;
+        std::unique_ptr<MultipartReader> form;
+        MultipartReader::Result formState = MultipartReader::NEED_MORE;
+        long long remaining = 0;   // 还没收到的请求体字节数
+        int pipe[2] = {-1, -1};
+        std::string filename;
+        std::string contentType;
+        int userId = 0;
+        int error = 0;             // 写文件失败时的 errno
+        ~PutUpload();
+    };
+    ssize_t SpliceBody_(int* saveErrno);
+    ssize_t ReadForm_(int* saveErrno);
+    void FeedForm_();
+    PROCESS_STATE ContinuePut_();
+    std::unique_ptr<PutUpload> put_;   // 非空时 read() 不再读进 readBuff_
+
+    std::shared_ptr<BodyStream> stream_;   // 非空时 iov_[1] 是它生成的当前一块，发完再取下一块
+
+    /* 大文件下载：响应头经 iov_[0] 发完后，文件内容从 response_.FileFd() sendfile */
+    off_t sendOffset_ = 0;
+    size_t sendLeft_ = 0;
+
+    // 把本次请求交给 DB 线程或写盘线程；返回 false 表示已在当前线程执行完（或被拒绝），done 不会被调用
+    std::function<bool(std::function<void()> done)> asyncSubmit_;
+    std::function<void()> asyncThen_;   // 完成后回到工作线程执行的部分
+    CompletionGate gate_;               // 每次 init/Close 换代，过期的回调据此丢弃
+
     std::unique_ptr<AuthService> authService_;
 };
 
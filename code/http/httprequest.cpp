@@ -4,6 +4,7 @@
  * @copyleft Apache 2.0
  */ 
 #include "httprequest.h"
+#include "../config/config.h"
 using namespace std;
 
 const unordered_set<string> HttpRequest::DEFAULT_HTML{
@@ -19,6 +20,9 @@ void HttpRequest::Init() {
     state_ = REQUEST_LINE; // 初始化状态机状态为请求行
     header_.clear(); // 清空请求头
     post_.clear(); // 清空请求体
+    query_.clear();
+    streamBody_ = false;
+    userID_ = -1; // 登录身份只对本次请求有效，连接复用时不能沿用上一个请求的
     LOG_INFO("http请求初始化成功");
 }
 
@@ -32,7 +36,10 @@ bool HttpRequest::IsKeepAlive() const {
 
 HttpRequest::PARSE_STATE HttpRequest::parse(Buffer& buff, int& fd) {
     const char CRLF[] = "\r\n";
-    if (buff.ReadableBytes() <= 0) {
+    if (state_ == FINISH) {
+        return PARSE_STATE::FINISH;  // 请求体留在连接上的请求，请求头到齐就结束了
+    }
+    if (buff.ReadableBytes() <= 0 && state_ != BODY) {
         return PARSE_STATE::AGAIN;
     }
 
@@ -55,6 +62,15 @@ HttpRequest::PARSE_STATE HttpRequest::parse(Buffer& buff, int& fd) {
                     if (line.empty()) {
                         state_ = BODY;
                     }
+                    if (state_ == BODY && ((method_ == "PUT" && path_.find("/files/") == 0) || IsLargeForm_())) {
+                        // 原始请求体可能有几个 GB，不进 body_
+                        streamBody_ = true;
+                        state_ = FINISH;
+                    }
+                    if (state_ != HEADERS) {
+                        // 先让调用方按请求头决定收不收请求体，被拒绝的请求一个字节都不多读
+                        return PARSE_STATE::HEADERS_DONE;
+                    }
                     break;
                 default:
                     break;
@@ -90,6 +106,18 @@ HttpRequest::PARSE_STATE HttpRequest::parse(Buffer& buff, int& fd) {
     return state_ == FINISH ? PARSE_STATE::FINISH : PARSE_STATE::AGAIN;
 }
 
+bool HttpRequest::IsLargeForm_() const {
+    // 小文件仍整体读进内存交给 DiskWriter 合并落盘，大文件由 HttpConn 边收边写
+    if (method_ != "POST" || path_.find("/upload") != 0 || path_.find("/uploads") == 0) return false;
+    auto type = header_.find("Content-Type");
+    auto length = header_.find("Content-Length");
+    if (type == header_.end() || length == header_.end()
+        || type->second.find("multipart/form-data") == std::string::npos) return false;
+    long long len = 0;
+    try { len = std::stoll(length->second); } catch (...) { return false; }
+    return len > Config::uploadStreamMinBytes;
+}
+
 bool HttpRequest::ParseChunkedBody_(Buffer& buff) {
     const char CRLF[] = "\r\n";
     while (true) {
@@ -148,6 +176,12 @@ bool HttpRequest::ParseRequestLine_(const string& line) {
         method_ = subMatch[1];
         path_ = subMatch[2];
         version_ = subMatch[3];
+        size_t pos = path_.find('?');
+        if (pos != string::npos) {
+            // 查询串单独解析，path_ 只保留路径部分，路由按路径匹配
+            ParseQuery_(path_.substr(pos + 1));
+            path_.erase(pos);
+        }
         state_ = HEADERS; // 状态机推进，将解析状态从REQUEST_LINE切换到HEADERS
         LOG_INFO("[%s],[%s],[%s]",method_.c_str(),path_.c_str(),version_.c_str());
         return true;
@@ -325,6 +359,49 @@ bool HttpRequest::ParseMultipartFormData(const std::string& contentType, const s
 
 
 
+void HttpRequest::ParseQuery_(const string& query) {
+    /*
+    解析 URL 查询串，如 limit=50&after=20250702101240_12
+    */
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == string::npos) end = query.size();
+        string item = query.substr(start, end - start);
+        if (!item.empty()) {
+            size_t eq = item.find('=');
+            if (eq == string::npos) {
+                query_[UrlDecode(item)] = "";
+            } else {
+                query_[UrlDecode(item.substr(0, eq))] = UrlDecode(item.substr(eq + 1));
+            }
+        }
+        start = end + 1;
+    }
+}
+
+string HttpRequest::UrlDecode(const string& str) {
+    string out;
+    out.reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] == '+') {
+            out += ' ';
+        } else if (str[i] == '%' && i + 2 < str.size()
+                   && isxdigit((unsigned char)str[i + 1]) && isxdigit((unsigned char)str[i + 2])) {
+            out += static_cast<char>(stoi(str.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += str[i];
+        }
+    }
+    return out;
+}
+
+std::string HttpRequest::GetQuery(const std::string& key) const {
+    auto it = query_.find(key);
+    return it == query_.end() ? "" : it->second;
+}
+
 std::string HttpRequest::path() const{
     return path_;
 }
@@ -361,89 +438,34 @@ std::string HttpRequest::GetPost(const char* key) const {
 }
 
 
-// 获取目录中的文件列表
-void HttpRequest::getFileList(const std::string& dirPath, std::vector<std::string>& fileList) {
-    DIR* dir;
-    struct dirent* ent;
-    
-    if ((dir = opendir(dirPath.c_str())) != nullptr) {
-        while ((ent = readdir(dir)) != nullptr) {
-            std::string filename = ent->d_name;
-            // 跳过当前目录和上级目录
-            if (filename != "." && filename != "..") {
-                fileList.push_back(filename);
-            }
-        }
-        closedir(dir);
-    }
-}
-
-// 生成文件列表HTML页面
-void HttpRequest::generateFileListPage(const std::string& templatePath, 
-                         const std::string& outputPath, 
-                         const std::string& fileDir) {
-    std::vector<std::string> files;
-    getFileList(fileDir, files);
-    
-    std::ifstream templateFile(templatePath);
-    std::ofstream outputFile(outputPath);
-    std::string line;
-    
-    // 读取模板文件直到找到标记位置
-    while (std::getline(templateFile, line)) {
-        outputFile << line << "\n";
-        if (line.find("<!--filelist_label-->") != std::string::npos) {
-            break;
-        }
-    }
-    
-    // 添加文件列表
-    for (const auto& filename : files) {
-        outputFile << "            <tr>"
-                  << "<td class=\"col1\">" << filename << "</td>"
-                  << "<td class=\"col2\"><a href=\"download/" << filename << "\">下载</a></td>"
-                  << "<td class=\"col3\"><a href=\"delete/" << filename 
-                  << "\" onclick=\"return confirmDelete();\">删除</a></td>"
-                  << "</tr>\n";
-    }
-    
-    // 写入模板剩余部分
-    while (std::getline(templateFile, line)) {
-        outputFile << line << "\n";
-    }
-}
-
-
 void HttpRequest::Updatepicturehtml(int user_id){
     MYSQL* sql = nullptr;
-    SqlConnRAII(&sql, SqlConnPool::Instance());
-
-    std::string query = "SELECT stored_filename FROM uploaded_files WHERE uploader_id = " + std::to_string(user_id);
-    if (mysql_query(sql, query.c_str()) != 0) {
-        std::cerr << "❌ 查询用户上传记录失败: " << mysql_error(sql) << std::endl;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return;
+
+    SqlParams params;
+    params.Int(user_id);
+    MYSQL_STMT* stmt = stmts->Execute(STMT_FILE_STORED_NAMES, params.Binds());
+    if (!stmt) {
+        std::cerr << "❌ 查询用户上传记录失败" << std::endl;
         return;
     }
+    SqlStmtGuard guard(stmt);
 
-    MYSQL_RES* res = mysql_store_result(sql);
-    if (!res) {
-        std::cerr << "❌ 获取结果失败: " << mysql_error(sql) << std::endl;
-        return;
-    }
+    std::string stored_filename;
+    SqlRow row(stmt);
+    row.Str(&stored_filename);
+    if (!row.Bind()) return;
 
     std::stringstream img_tags;
-    MYSQL_ROW row;
-    while ((row = mysql_fetch_row(res)) != nullptr) {
-        std::string stored_filename = row[0];
+    while (row.Fetch()) {
         img_tags <<
             "<div align=\"center\" width=\"906\" height=\"506\">\n"
             "<img src=\"images/" << stored_filename << "\" />\n"
             "</div>\n";
     }
 
-    mysql_free_result(res);
-    SqlConnPool::Instance()->FreeConn(sql);
-
-
     std::cout << "已根据用户 MySQL 数据更新 HTML 页面" << std::endl;
 }
 
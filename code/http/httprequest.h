@@ -11,7 +11,6 @@
 #include <string>
 #include <regex>
 #include <errno.h> 
-#include <dirent.h>    
 #include <fstream>
 #include <mysql/mysql.h>  //mysql
 #include <filesystem>
@@ -33,7 +32,8 @@ public:
         BODY,
         AGAIN,   // 数据还不够
         FINISH,  // 解析完成
-        ERROR    // 请求格式错误      
+        ERROR,   // 请求格式错误      
+        HEADERS_DONE  // 请求头刚到齐，请求体还没读；调用方检查完长度和配额后再次调用 parse
     };
 
     enum HTTP_CODE {
@@ -59,9 +59,12 @@ public:
     std::string version() const;
     std::string GetPost(const std::string& key) const;
     std::string GetPost(const char* key) const;
+    std::string GetQuery(const std::string& key) const;   // URL 中 ? 之后的参数，已解码
     std::string& body() ;
     std::unordered_map<std::string,std::string>& header();
     bool IsKeepAlive() const;
+    // 请求头解析完就返回 FINISH，请求体留在连接上由 HttpConn 直接写文件（PUT /files/ 和大的 multipart 上传）
+    bool IsStreamBody() const { return streamBody_; }
     void SetUserID(int id) { userID_ = id; }
     int GetUserID() const { return userID_; }
     void AddHeader(const std::string& key, const std::string& value);
@@ -69,6 +72,7 @@ public:
     std::string method_, path_, version_, body_;
     std::unordered_map<std::string, std::string> header_;
     std::unordered_map<std::string, std::string> post_;
+    std::unordered_map<std::string, std::string> query_;
     /* 
     todo 
     void HttpConn::ParseFormData() {}
@@ -78,17 +82,16 @@ public:
     void ParseHeader_(const std::string& line);
     void ParseBody_(const std::string& line,int &fd);
     void ParsePath_();
+    void ParseQuery_(const std::string& query);
+    static std::string UrlDecode(const std::string& str);
     void ParsePost_(int &fd);
     void ParseFromUrlencoded_();
     void ParseMultipartForm_(int &fd);
-    void getFileList(const std::string& dirPath, std::vector<std::string>& fileList);
     bool HandleDeleteFile(int user_id);
-    void generateFileListPage(const std::string& templatePath, 
-        const std::string& outputPath, 
-        const std::string& fileDir);
     void Updatepicturehtml(int id);
     bool ParseMultipartFormData(const std::string& contentType, const std::string& body,UploadedFile& outFile);
     bool ParseChunkedBody_(Buffer& buff);
+    bool IsLargeForm_() const;   // 超过 Config::uploadStreamMinBytes 的 multipart 上传
     bool UserVerify(const std::string& name, const std::string& pwd, bool isLogin);
     void TraverseDirectory(
         const std::string& directory_path,
@@ -100,6 +103,7 @@ public:
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
     static int ConverHex(char ch);
     int userID_ = -1;
+    bool streamBody_ = false;
 
 };
 
@@ -31,9 +31,21 @@ const unordered_map<string, string> HttpResponse::SUFFIX_TYPE = {
 
 const unordered_map<int, string> HttpResponse::CODE_STATUS = {
     {200, "OK"},
+    {201, "Created"},
+    {204, "No Content"},
+    {304, "Not Modified"},
     {400, "Bad Request"},
     {403, "Forbidden"},
     {404, "Not Found"},
+    {409, "Conflict"},
+    {411, "Length Required"},
+    {413, "Payload Too Large"},
+    {415, "Unsupported Media Type"},
+    {417, "Expectation Failed"},
+    {431, "Request Header Fields Too Large"},
+    {500, "Internal Server Error"},
+    {503, "Service Unavailable"},
+    {507, "Insufficient Storage"},
 };
 
 const unordered_map<int, string> HttpResponse::CODE_PATH = {
@@ -42,12 +54,14 @@ const unordered_map<int, string> HttpResponse::CODE_PATH = {
     {404, "/404.html"},
 };
 
-HttpResponse::HttpResponse()
+HttpResponse::HttpResponse() : jsonBuff_(1024)
 {
     code_ = -1;
     path_ = srcDir_ = "";
     isKeepAlive_ = false;
+    omitBody_ = false;
     mmFile_ = nullptr;
+    fileFd_ = -1;
     mmFileStat_ = {0};
 };
 
@@ -58,15 +72,16 @@ HttpResponse::~HttpResponse()
 
 void HttpResponse::Init(const string &srcDir, string &path, string &body, unordered_map<string, string> &header, bool isKeepAlive, int code)
 {
-    if (mmFile_)
-    {
-        UnmapFile();
-    }
+    UnmapFile();
     code_ = code;
     isKeepAlive_ = isKeepAlive;
     path_ = path;
-    body_ = body;
-    header_ = header;
+    jsonBuff_.RetrieveAll();
+    sharedBody_.reset();
+    stream_.reset();
+    header_.clear(); // 只放本次响应要额外输出的头部，请求头不再带进来
+    contentType_.clear();
+    omitBody_ = false;
     srcDir_ = srcDir;
     mmFile_ = nullptr;
     mmFileStat_ = {0};
@@ -86,20 +101,42 @@ void HttpResponse::MakeResponse(Buffer &buff, bool isJsonResponse)
     <html>...</html> （或文件内容）
     */
 
-    // 仅非 JSON 请求执行文件路径检查
-    if (stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode))
+    if (stream_ && !isJsonResponse)
     {
-        code_ = 404;
+        // 流式响应体：长度事先算好，这里只写头部
+        if (code_ == -1)
+        {
+            code_ = 200;
+        }
+        AddStateLine_(buff);
+        AddHeader_(buff, false);
+        buff.Append("Content-Length: " + to_string(stream_->Length()) + "\r\n\r\n");
+        return;
     }
-    else if (!(mmFileStat_.st_mode & S_IROTH))
+    // 仅非 JSON 请求执行文件路径检查
+    if (isJsonResponse)
     {
-        code_ = 403;
+        if (code_ == -1)
+        {
+            code_ = 200;
+        }
     }
-    else if (code_ == -1)
+    else
     {
-        code_ = 200;
+        if (stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode))
+        {
+            code_ = 404;
+        }
+        else if (!(mmFileStat_.st_mode & S_IROTH))
+        {
+            code_ = 403;
+        }
+        else if (code_ == -1)
+        {
+            code_ = 200;
+        }
+        ErrorHtml_(); // 仅 HTML 模式下处理错误页面跳转
     }
-    ErrorHtml_(); // 仅 HTML 模式下处理错误页面跳转
 
     AddStateLine_(buff);              // 写入响应状态行
     AddHeader_(buff, isJsonResponse); // 写入通用响应头（包括 Content-Type）
@@ -168,12 +205,12 @@ void HttpResponse::AddHeader_(Buffer &buff, bool isJsonResponse)
     }
     else
     {
-        buff.Append("Content-type: " + GetFileType_() + "\r\n");
+        buff.Append("Content-type: " + (contentType_.empty() ? GetFileType_() : contentType_) + "\r\n");
     }
-    auto it = header_.find("Set-Cookie");
-    if (it != header_.end()) {
-        buff.Append("Set-Cookie: " + it->second + "\r\n");
+    for (const auto& kv : header_) {
+        buff.Append(kv.first + ": " + kv.second + "\r\n");
     }
+    header_.clear(); // 额外头部只对本次响应有效，避免带到同一连接的下一个响应
 }
 
 void HttpResponse::AddContent_(Buffer &buff)
@@ -185,30 +222,49 @@ void HttpResponse::AddContent_(Buffer &buff)
         return;
     }
 
+    if (mmFileStat_.st_size >= Config::sendfileMinBytes)
+    {
+        // 大文件（上传的内容可能有几个 GB）不映射进地址空间，发送时由内核直接从页缓存拷到 socket
+        fileFd_ = srcFd;
+        buff.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n");
+        return;
+    }
+
     /* 将文件映射到内存提高文件的访问速度
         MAP_PRIVATE 建立一个写入时拷贝的私有映射*/
     LOG_DEBUG("file path %s", (srcDir_ + path_).data());
-    int *mmRet = (int *)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if (*mmRet == -1)
+    void *mmRet = mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
+    close(srcFd);
+    if (mmRet == MAP_FAILED)
     {
         ErrorContent(buff, "File NotFound!");
         return;
     }
     mmFile_ = (char *)mmRet;
-    close(srcFd);
     buff.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n");
 }
 
 void HttpResponse::AddJsonContent_(Buffer &buff)
 {
     cout<<"构建json主体"<<endl;
-    if (body_.empty())
+    if (code_ == 304 || code_ == 204 || omitBody_)
+    {
+        buff.Append("\r\n"); // 304/204/HEAD 不带响应体
+        return;
+    }
+    if (BodyLen() == 0)
     {
         ErrorContent(buff, "Empty JSON response body");
         return;
     }
-    buff.Append("Content-Length: " + std::to_string(body_.size()) + "\r\n\r\n");
-    buff.Append(body_);
+    // 这里只写头部，响应体由 HttpConn 通过 Body()/BodyLen() 直接发送
+    buff.Append("Content-Length: " + std::to_string(BodyLen()) + "\r\n\r\n");
+}
+
+void HttpResponse::SetStream(std::shared_ptr<BodyStream> stream, int code)
+{
+    stream_ = std::move(stream);
+    code_ = code;
 }
 
 void HttpResponse::UnmapFile()
@@ -218,6 +274,11 @@ void HttpResponse::UnmapFile()
         munmap(mmFile_, mmFileStat_.st_size);
         mmFile_ = nullptr;
     }
+    if (fileFd_ >= 0)
+    {
+        close(fileFd_);
+        fileFd_ = -1;
+    }
 }
 
 string HttpResponse::GetFileType_()
@@ -264,10 +325,58 @@ void HttpResponse::SetJsonResponse(const std::string &jsonStr, int code)
     {
         UnmapFile();
     } // 保守做法，防止误用
-    body_ = jsonStr;
+    sharedBody_.reset();
+    jsonBuff_.RetrieveAll();
+    jsonBuff_.Append(jsonStr);
     code_ = code;
 }
 
+Buffer& HttpResponse::JsonBody(int code)
+{
+    if (mmFile_)
+    {
+        UnmapFile();
+    }
+    sharedBody_.reset();
+    jsonBuff_.RetrieveAll();
+    code_ = code;
+    return jsonBuff_;
+}
+
+void HttpResponse::SetJsonBody(std::shared_ptr<const std::string> body, int code)
+{
+    if (mmFile_)
+    {
+        UnmapFile();
+    }
+    jsonBuff_.RetrieveAll();
+    sharedBody_ = std::move(body);
+    code_ = code;
+}
+
+void HttpResponse::SetJsonError(const std::string& message, int code)
+{
+    JsonWriter writer(JsonBody(code));
+    writer.BeginObject().Key("error").String(message).EndObject();
+}
+
+void HttpResponse::SetJsonStatus(const std::string& status, int code)
+{
+    JsonWriter writer(JsonBody(code));
+    writer.BeginObject().Key("status").String(status).EndObject();
+}
+
+const char* HttpResponse::Body() const
+{
+    return sharedBody_ ? sharedBody_->data() : jsonBuff_.Peek();
+}
+
+size_t HttpResponse::BodyLen() const
+{
+    if (omitBody_) return 0;
+    return sharedBody_ ? sharedBody_->size() : jsonBuff_.ReadableBytes();
+}
+
 void HttpResponse::AddHeader(const std::string& key, const std::string& value) {
     header_[key] = value;
 }
\ No newline at end of file
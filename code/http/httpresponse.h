@@ -7,6 +7,7 @@
 #define HTTP_RESPONSE_H
 
 #include <unordered_map>
+#include <memory>
 #include <fcntl.h>       // open
 #include <unistd.h>      // close
 #include <sys/stat.h>    // stat
@@ -15,7 +16,10 @@
 #include "../buffer/buffer.h"
 #include "../log/log.h"
 #include "httprequest.h"
+#include "jsonwriter.h"
+#include "bodystream.h"
 #include "../processing/uploadservice.h"
+#include "../config/config.h"
 
 class HttpResponse {
 public:
@@ -27,10 +31,28 @@ public:
     void UnmapFile();
     char* File();
     size_t FileLen() const;
+    // 大于 Config::sendfileMinBytes 的文件不映射，由 HttpConn 从这个描述符 sendfile；否则为 -1
+    int FileFd() const { return fileFd_; }
     void ErrorContent(Buffer& buff, std::string message);
     int Code() const { return code_; }
     void SetJsonResponse(const std::string& jsonStr, int code);
+    // 清空 JSON 响应体并返回它，调用方用 JsonWriter 直接写进去
+    Buffer& JsonBody(int code);
+    // 直接引用一份共享的 JSON（如缓存中的列表），发送时不再复制
+    void SetJsonBody(std::shared_ptr<const std::string> body, int code);
+    void SetJsonError(const std::string& message, int code);   // {"error":message}
+    void SetJsonStatus(const std::string& status, int code);   // {"status":status}
+    // JSON 响应体由 HttpConn 作为 iov_[1] 发送，和映射文件走同一条零拷贝路径
+    const char* Body() const;
+    size_t BodyLen() const;
     void AddHeader(const std::string& key, const std::string& value);
+    // 覆盖按文件后缀推断的 Content-Type，用于没有后缀的 blob 文件
+    void SetContentType(const std::string& type) { contentType_ = type; }
+    // HEAD 请求：状态码和头部照常，响应体不发
+    void OmitBody() { omitBody_ = true; }
+    // 响应体由 stream 边生成边发送，不映射文件；Content-Type 用 SetContentType 设置
+    void SetStream(std::shared_ptr<BodyStream> stream, int code);
+    std::shared_ptr<BodyStream> TakeStream() { return std::move(stream_); }
 
 private:
     void AddStateLine_(Buffer &buff);
@@ -38,19 +60,22 @@ private:
     void AddContent_(Buffer &buff);
     void AddJsonContent_(Buffer& buff);
     void ErrorHtml_();
-    void getFileList(const std::string& dirPath, std::vector<std::string>& fileList);
     std::string GetFileType_();
 
     int code_;
     bool isKeepAlive_;
     bool isJson_;
-    std::string jsonBody_;
+    bool omitBody_;
+    Buffer jsonBuff_;                                // JsonWriter 的输出
+    std::shared_ptr<const std::string> sharedBody_;  // 非空时优先于 jsonBuff_
+    std::shared_ptr<BodyStream> stream_;             // 非空时响应体由它生成，交给 HttpConn 分块发送
     std::string path_;
     std::string srcDir_;
-    std::string body_;
+    std::string contentType_;
     std::unordered_map<std::string,std::string> header_;
     
     char* mmFile_; 
+    int fileFd_;
     struct stat mmFileStat_;
 
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
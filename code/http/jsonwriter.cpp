@@ -0,0 +1,117 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-04 15:20:06
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-04 15:20:06
+ * @Description: 流式 JSON 编码器
+ */
+#include "jsonwriter.h"
+#include <charconv>
+#include <cstring>
+
+void JsonWriter::Separator_() {
+    if (afterKey_) {
+        afterKey_ = false;
+        return;
+    }
+    if (depth_ == 0) return;
+    uint64_t bit = 1ULL << (depth_ - 1);
+    if (hasItem_ & bit) {
+        buff_.Append(",", 1);
+    } else {
+        hasItem_ |= bit;
+    }
+}
+
+void JsonWriter::Open_(char c) {
+    Separator_();
+    buff_.Append(&c, 1);
+    assert(depth_ < MAX_DEPTH);
+    depth_++;
+    hasItem_ &= ~(1ULL << (depth_ - 1));
+}
+
+void JsonWriter::Close_(char c) {
+    assert(depth_ > 0);
+    depth_--;
+    buff_.Append(&c, 1);
+}
+
+JsonWriter& JsonWriter::BeginObject() { Open_('{'); return *this; }
+JsonWriter& JsonWriter::EndObject() { Close_('}'); return *this; }
+JsonWriter& JsonWriter::BeginArray() { Open_('['); return *this; }
+JsonWriter& JsonWriter::EndArray() { Close_(']'); return *this; }
+
+JsonWriter& JsonWriter::Key(const char* key, size_t len) {
+    Separator_();
+    Escape_(key, len);
+    buff_.Append(":", 1);
+    afterKey_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(const char* key) {
+    return Key(key, strlen(key));
+}
+
+JsonWriter& JsonWriter::String(const char* str, size_t len) {
+    Separator_();
+    Escape_(str, len);
+    return *this;
+}
+
+JsonWriter& JsonWriter::String(const char* str) {
+    return String(str, strlen(str));
+}
+
+JsonWriter& JsonWriter::Int(int64_t v) {
+    Separator_();
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    buff_.Append(buf, res.ptr - buf);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(bool v) {
+    Separator_();
+    if (v) { buff_.Append("true", 4); }
+    else { buff_.Append("false", 5); }
+    return *this;
+}
+
+JsonWriter& JsonWriter::Null() {
+    Separator_();
+    buff_.Append("null", 4);
+    return *this;
+}
+
+void JsonWriter::Escape_(const char* str, size_t len) {
+    // 不需要转义的连续片段整段追加，只有引号、反斜杠和控制字符逐个处理；
+    // 非 ASCII 的 UTF-8 字节原样输出
+    static const char HEX[] = "0123456789abcdef";
+    buff_.EnsureWriteable(len + 2);
+    buff_.Append("\"", 1);
+    size_t start = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = static_cast<unsigned char>(str[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        if (i > start) { buff_.Append(str + start, i - start); }
+        start = i + 1;
+        switch (c) {
+        case '"':  buff_.Append("\\\"", 2); break;
+        case '\\': buff_.Append("\\\\", 2); break;
+        case '\n': buff_.Append("\\n", 2); break;
+        case '\r': buff_.Append("\\r", 2); break;
+        case '\t': buff_.Append("\\t", 2); break;
+        case '\b': buff_.Append("\\b", 2); break;
+        case '\f': buff_.Append("\\f", 2); break;
+        default: {
+            char esc[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+            buff_.Append(esc, 6);
+            break;
+        }
+        }
+    }
+    if (len > start) { buff_.Append(str + start, len - start); }
+    buff_.Append("\"", 1);
+}
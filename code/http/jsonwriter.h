@@ -0,0 +1,56 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-04 15:20:06
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-04 15:20:06
+ * @Description: 流式 JSON 编码器，边转义边写进 Buffer，不构建中间 DOM
+ */
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <string>
+#include <cstdint>
+#include "../buffer/buffer.h"
+
+/*
+ * 用法：
+ *   JsonWriter w(buff);
+ *   w.BeginObject().Key("error").String(msg).EndObject();
+ * 逗号由编码器按嵌套层级自动补上，调用方只需按顺序写键和值。
+ * 不校验结构是否配对，调用方负责 Begin/End 成对出现。
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(Buffer& buff) : buff_(buff), depth_(0), afterKey_(false), hasItem_(0) {}
+
+    JsonWriter& BeginObject();
+    JsonWriter& EndObject();
+    JsonWriter& BeginArray();
+    JsonWriter& EndArray();
+
+    JsonWriter& Key(const char* key, size_t len);
+    JsonWriter& Key(const std::string& key) { return Key(key.data(), key.size()); }
+    JsonWriter& Key(const char* key);
+
+    JsonWriter& String(const char* str, size_t len);
+    JsonWriter& String(const std::string& str) { return String(str.data(), str.size()); }
+    JsonWriter& String(const char* str);
+    JsonWriter& Int(int64_t v);
+    JsonWriter& Bool(bool v);
+    JsonWriter& Null();
+
+private:
+    void Separator_();
+    void Open_(char c);
+    void Close_(char c);
+    void Escape_(const char* str, size_t len);
+
+    static const int MAX_DEPTH = 64;
+
+    Buffer& buff_;
+    int depth_;
+    bool afterKey_;       // 刚写完键，下一个值前面不加逗号
+    uint64_t hasItem_;    // 第 i 位表示第 i 层已经写过元素
+};
+
+#endif //JSON_WRITER_H
@@ -0,0 +1,132 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-18 15:10:06
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-18 15:10:06
+ * @Description: 增量解析 multipart/form-data，文件内容边到边交出去，不在内存里攒整个请求体
+ */
+#include "multipartreader.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+MultipartReader::MultipartReader(const std::string& contentType)
+    : state_(PREAMBLE), hasFile_(false) {
+    size_t pos = contentType.find("boundary=");
+    if (pos == std::string::npos) return;
+    std::string boundary = contentType.substr(pos + strlen("boundary="));
+    size_t end = boundary.find(';');
+    if (end != std::string::npos) boundary.erase(end);
+    if (boundary.size() >= 2 && boundary.front() == '"' && boundary.back() == '"') {
+        boundary = boundary.substr(1, boundary.size() - 2);
+    }
+    if (!boundary.empty()) { delim_ = "\r\n--" + boundary; }
+}
+
+MultipartReader::Result MultipartReader::AfterBoundary_(Buffer& buff) {
+    // 分隔行后面紧跟 "--" 是结束，跟 CRLF 是下一个字段的头部
+    const char* p = buff.Peek();
+    if (p[0] == '-' && p[1] == '-') {
+        state_ = EPILOGUE;
+    } else if (p[0] == '\r' && p[1] == '\n') {
+        state_ = HEADERS;
+    } else {
+        return ERROR;
+    }
+    buff.Retrieve(2);
+    return NEED_MORE;
+}
+
+bool MultipartReader::ParsePartHeaders_(const std::string& headers) {
+    std::string lower(headers);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    size_t pos = lower.find("filename=\"");
+    if (pos == std::string::npos) return false;
+    pos += strlen("filename=\"");
+    size_t end = headers.find('"', pos);
+    if (end == std::string::npos) return false;
+    std::string raw = headers.substr(pos, end - pos);
+    filename_ = raw.substr(raw.find_last_of("/\\") + 1);   // 有的浏览器带完整路径
+    if (filename_.empty()) return false;                   // 表单里没选文件
+
+    contentType_ = "application/octet-stream";
+    pos = lower.find("content-type:");
+    if (pos != std::string::npos) {
+        end = headers.find("\r\n", pos);
+        std::string value = headers.substr(pos + strlen("content-type:"),
+                                           end == std::string::npos ? std::string::npos : end - pos - strlen("content-type:"));
+        value.erase(0, value.find_first_not_of(" \t"));
+        value.erase(value.find_last_not_of(" \t") + 1);
+        if (!value.empty()) { contentType_ = value; }
+    }
+    return true;
+}
+
+MultipartReader::Result MultipartReader::Feed(Buffer& buff) {
+    if (delim_.empty()) return ERROR;
+    while (true) {
+        const char* begin = buff.Peek();
+        const char* end = buff.BeginWriteConst();
+        switch (state_) {
+        case PREAMBLE: {
+            // 第一个分隔行前面没有 CRLF
+            const char* first = delim_.data() + 2;
+            size_t firstLen = delim_.size() - 2;
+            const char* p = std::search(begin, end, first, first + firstLen);
+            if (p == end) {
+                buff.Retrieve(buff.ReadableBytes() - std::min(buff.ReadableBytes(), firstLen - 1));
+                return NEED_MORE;
+            }
+            buff.RetrieveUntil(p);
+            if (buff.ReadableBytes() < firstLen + 2) return NEED_MORE;
+            buff.Retrieve(firstLen);
+            if (AfterBoundary_(buff) == ERROR) return ERROR;
+            break;
+        }
+        case BOUNDARY:
+            // 缓冲区以 delim_ 开头
+            if (buff.ReadableBytes() < delim_.size() + 2) return NEED_MORE;
+            buff.Retrieve(delim_.size());
+            if (AfterBoundary_(buff) == ERROR) return ERROR;
+            break;
+        case HEADERS: {
+            static const char CRLF2[] = "\r\n\r\n";
+            size_t skip;
+            std::string headers;
+            if (buff.ReadableBytes() >= 2 && begin[0] == '\r' && begin[1] == '\n') {
+                skip = 2;   // 没有头部的字段
+            } else {
+                const char* p = std::search(begin, end, CRLF2, CRLF2 + 4);
+                if (p == end) {
+                    return buff.ReadableBytes() > MAX_PART_HEADERS ? ERROR : NEED_MORE;
+                }
+                headers.assign(begin, p);
+                skip = p - begin + 4;
+            }
+            buff.Retrieve(skip);
+            if (!hasFile_ && ParsePartHeaders_(headers)) {
+                hasFile_ = true;
+                state_ = DATA;
+            } else {
+                state_ = SKIP;
+            }
+            break;
+        }
+        case DATA:
+        case SKIP: {
+            const char* p = std::search(begin, end, delim_.data(), delim_.data() + delim_.size());
+            // 没找到分隔行时，末尾可能是分隔行的前半截，留到下一次
+            const char* safe = p != end ? p : end - std::min<size_t>(buff.ReadableBytes(), delim_.size() - 1);
+            if (state_ == DATA && safe > begin && onData && !onData(begin, safe - begin)) return ERROR;
+            buff.RetrieveUntil(safe);
+            if (p == end) return NEED_MORE;
+            state_ = BOUNDARY;
+            break;
+        }
+        case EPILOGUE:
+            buff.RetrieveAll();
+            return DONE;
+        }
+    }
+}
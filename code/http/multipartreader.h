@@ -0,0 +1,56 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-18 15:10:06
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-18 15:10:06
+ * @Description: 增量解析 multipart/form-data，文件内容边到边交出去，不在内存里攒整个请求体
+ */
+#ifndef MULTIPART_READER_H
+#define MULTIPART_READER_H
+
+#include <string>
+#include <functional>
+#include "../buffer/buffer.h"
+
+/*
+ * 请求体按到达的顺序一段段喂进来，每次只消费能确定归属的字节：
+ * 可能是分隔行开头的最后 boundary 长度个字节留在缓冲区里，等下一段数据到了再判断。
+ * 只取第一个带 filename 的字段，其余字段跳过，和 HttpRequest::ParseMultipartFormData 一致。
+ */
+class MultipartReader {
+public:
+    enum Result {
+        NEED_MORE,
+        DONE,      // 读到结束分隔行，之后的字节都忽略
+        ERROR      // 格式错误，或 onData 返回 false
+    };
+
+    // contentType 为请求头 Content-Type 的值，没有 boundary 时 Valid() 为 false
+    explicit MultipartReader(const std::string& contentType);
+
+    bool Valid() const { return !delim_.empty(); }
+    Result Feed(Buffer& buff);
+
+    bool HasFile() const { return hasFile_; }
+    const std::string& Filename() const { return filename_; }
+    const std::string& ContentType() const { return contentType_; }
+
+    // 文件内容，一个文件可能分多次回调；返回 false 中止解析
+    std::function<bool(const char* data, size_t len)> onData;
+
+private:
+    enum State { PREAMBLE, BOUNDARY, HEADERS, DATA, SKIP, EPILOGUE };
+
+    Result AfterBoundary_(Buffer& buff);
+    bool ParsePartHeaders_(const std::string& headers);
+
+    std::string delim_;     // "\r\n--" + boundary
+    State state_;
+    bool hasFile_;
+    std::string filename_;
+    std::string contentType_;
+
+    static const size_t MAX_PART_HEADERS = 16 * 1024;
+};
+
+#endif //MULTIPART_READER_H
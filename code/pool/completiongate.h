@@ -0,0 +1,46 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-06
+ * @Description  : 异步完成回调和连接关闭之间的闸门
+ */
+#ifndef COMPLETIONGATE_H
+#define COMPLETIONGATE_H
+
+#include <mutex>
+#include <cstdint>
+#include <functional>
+
+/*
+ * 连接对象按 fd 复用，DB 线程交回来的回调可能在连接超时关闭、甚至 fd 被新连接占用之后才执行。
+ * 连接每次 init/Close 调 Advance()，在锁内换代并一直持锁到关闭结束；
+ * 回调提交前用 Ticket() 记下当时的代数，完成时由 RunIf() 在同一把锁内核对，
+ * 代数变了直接丢弃，没变就在锁内构造响应并注册写事件，不会和关闭交错执行。
+ */
+class CompletionGate {
+public:
+    uint64_t Ticket() {
+        std::lock_guard<std::mutex> locker(mtx_);
+        return gen_;
+    }
+
+    // 返回的锁由调用方持有，直到连接状态重置完毕
+    std::unique_lock<std::mutex> Advance() {
+        std::unique_lock<std::mutex> locker(mtx_);
+        gen_++;
+        return locker;
+    }
+
+    // 代数没变时持锁执行 fn 并返回 true；已换代返回 false，fn 不执行
+    bool RunIf(uint64_t ticket, const std::function<void()>& fn) {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (gen_ != ticket) return false;
+        fn();
+        return true;
+    }
+
+private:
+    std::mutex mtx_;
+    uint64_t gen_ = 0;
+};
+
+#endif //COMPLETIONGATE_H
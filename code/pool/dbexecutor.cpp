@@ -0,0 +1,130 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-06
+ * @Description  : 数据库 I/O 线程，查询完成后通过 eventfd 通知事件循环
+ */
+#include "dbexecutor.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include "../log/log.h"
+using namespace std;
+
+DbExecutor::DbExecutor()
+    : maxQueue_(0), peakQueued_(0), eventFd_(-1), isClosed_(true),
+      inFlight_(0), submitted_(0), completed_(0), rejected_(0) {}
+
+DbExecutor::~DbExecutor() {
+    Stop();
+}
+
+DbExecutor* DbExecutor::Instance() {
+    static DbExecutor executor;
+    return &executor;
+}
+
+void DbExecutor::Start(int threadCount, size_t maxQueue) {
+    if (!isClosed_) return;
+    eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventFd_ < 0) {
+        LOG_ERROR("DbExecutor: eventfd error %d, queries stay synchronous", errno);
+        return;
+    }
+    maxQueue_ = maxQueue;
+    isClosed_ = false;
+    for (int i = 0; i < max(1, threadCount); i++) {
+        threads_.emplace_back(&DbExecutor::Loop_, this);
+    }
+    LOG_INFO("DbExecutor: %d threads, queue %zu", (int)threads_.size(), maxQueue_);
+}
+
+void DbExecutor::Stop() {
+    {
+        lock_guard<mutex> locker(mtx_);
+        if (isClosed_) return;
+        isClosed_ = true;
+    }
+    cond_.notify_all();
+    for (auto& t : threads_) {
+        if (t.joinable()) { t.join(); }
+    }
+    threads_.clear();
+    {
+        // 退出时连接都要关了，未交付的回调直接丢弃
+        lock_guard<mutex> locker(doneMtx_);
+        completions_.clear();
+    }
+    close(eventFd_);
+    eventFd_ = -1;
+}
+
+bool DbExecutor::Submit(function<void()> work, function<void()> done) {
+    {
+        lock_guard<mutex> locker(mtx_);
+        if (isClosed_ || jobs_.size() >= maxQueue_) {
+            rejected_++;
+            return false;
+        }
+        jobs_.push_back(Job{move(work), move(done)});
+        peakQueued_ = max(peakQueued_, jobs_.size());
+    }
+    submitted_++;
+    cond_.notify_one();
+    return true;
+}
+
+void DbExecutor::Loop_() {
+    unique_lock<mutex> locker(mtx_);
+    while (true) {
+        if (!jobs_.empty()) {
+            Job job = move(jobs_.front());
+            jobs_.pop_front();
+            locker.unlock();
+
+            inFlight_++;
+            job.work();
+            inFlight_--;
+            completed_++;
+            Complete(move(job.done));
+
+            locker.lock();
+        }
+        else if (isClosed_) break; // 关闭前把队列里的任务执行完
+        else cond_.wait(locker);
+    }
+}
+
+void DbExecutor::Complete(function<void()> done) {
+    {
+        lock_guard<mutex> doneLocker(doneMtx_);
+        completions_.push_back(move(done));
+    }
+    uint64_t one = 1;
+    ssize_t n = ::write(eventFd_, &one, sizeof(one)); // 计数累加，事件循环一次取走全部
+    (void)n;
+}
+
+vector<function<void()>> DbExecutor::TakeCompletions() {
+    uint64_t count;
+    ssize_t n = ::read(eventFd_, &count, sizeof(count));
+    (void)n;
+    vector<function<void()>> done;
+    lock_guard<mutex> locker(doneMtx_);
+    done.swap(completions_);
+    return done;
+}
+
+DbExecutorStats DbExecutor::GetStats() {
+    DbExecutorStats stats;
+    {
+        lock_guard<mutex> locker(mtx_);
+        stats.queued = jobs_.size();
+        stats.peakQueued = peakQueued_;
+    }
+    stats.threads = threads_.size();
+    stats.inFlight = inFlight_;
+    stats.submitted = submitted_;
+    stats.completed = completed_;
+    stats.rejected = rejected_;
+    return stats;
+}
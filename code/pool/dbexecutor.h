@@ -0,0 +1,81 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-06
+ * @Description  : 数据库 I/O 线程，查询完成后通过 eventfd 通知事件循环
+ */
+#ifndef DBEXECUTOR_H
+#define DBEXECUTOR_H
+
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+struct DbExecutorStats {
+    int threads;
+    size_t queued;          // 还在排队的任务
+    size_t peakQueued;
+    int inFlight;           // 正在 DB 线程上执行的任务
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t rejected;      // 队列满或未启动，由调用方同步执行
+};
+
+/*
+ * 工作线程只提交任务就返回，不再陪着数据库往返阻塞：
+ *   Submit(work, done)：work 在 DB 线程上执行（内部照常用 SqlConnRAII 借连接），
+ *   执行完把 done 放进完成队列并写 eventfd；
+ *   事件循环监听 EventFd()，可读时 TakeCompletions() 取出回调交给线程池。
+ * 在途查询数由 DB 线程数决定，和请求线程数无关。
+ */
+class DbExecutor {
+public:
+    static DbExecutor* Instance();
+
+    void Start(int threadCount, size_t maxQueue);
+    void Stop();
+    bool IsRunning() const { return !isClosed_; }
+
+    // 返回 false 表示没有接收任务，调用方应自己同步执行 work 和 done
+    bool Submit(std::function<void()> work, std::function<void()> done);
+
+    // 别的后台线程（如上传写盘线程）借用同一条完成通道，把回调交回事件循环
+    void Complete(std::function<void()> done);
+
+    int EventFd() const { return eventFd_; }
+    std::vector<std::function<void()>> TakeCompletions();
+
+    DbExecutorStats GetStats();
+
+private:
+    DbExecutor();
+    ~DbExecutor();
+
+    struct Job {
+        std::function<void()> work;
+        std::function<void()> done;
+    };
+
+    void Loop_();
+
+    std::mutex mtx_;                 // 保护 jobs_
+    std::condition_variable cond_;
+    std::deque<Job> jobs_;
+    size_t maxQueue_;
+    size_t peakQueued_;
+
+    std::mutex doneMtx_;             // 保护 completions_
+    std::vector<std::function<void()>> completions_;
+
+    std::vector<std::thread> threads_;
+    int eventFd_;
+    std::atomic<bool> isClosed_;
+
+    std::atomic<int> inFlight_;
+    std::atomic<uint64_t> submitted_, completed_, rejected_;
+};
+
+#endif // DBEXECUTOR_H
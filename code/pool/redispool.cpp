@@ -0,0 +1,105 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-06-24
+ * @Description  : 全进程共享的 Redis 连接池
+ */
+#include "redispool.h"
+#include "../config/config.h"
+using namespace std;
+
+RedisPool::RedisPool() {
+    size_ = 0;
+    inUse_ = 0;
+    peakInUse_ = 0;
+    waitTimeout_ = chrono::milliseconds(0);
+    acquires_ = waits_ = timeouts_ = 0;
+    errors_ = 0;
+    totalWaitUs_ = maxWaitUs_ = 0;
+}
+
+RedisPool* RedisPool::Instance() {
+    static RedisPool pool;
+    return &pool;
+}
+
+void RedisPool::Init(const string& host, int port, int poolSize, int waitTimeoutMs) {
+    /*
+    @host/@port：Redis 地址
+    @poolSize：连接数上限，所有 HttpConn 共享
+    @waitTimeoutMs：连接全部借出时的最长等待时间，超时抛 TimeoutError
+    */
+    call_once(initFlag_, [&] {
+        sw::redis::ConnectionOptions connOpts;
+        connOpts.host = host;
+        connOpts.port = port;
+        connOpts.keep_alive = true;
+        connOpts.connect_timeout = chrono::milliseconds(Config::redisConnectTimeoutMs);
+        connOpts.socket_timeout = chrono::milliseconds(Config::redisSocketTimeoutMs);
+
+        sw::redis::ConnectionPoolOptions poolOpts;
+        poolOpts.size = poolSize;
+        poolOpts.wait_timeout = chrono::milliseconds(waitTimeoutMs);
+        poolOpts.connection_lifetime = chrono::milliseconds(Config::redisConnLifetimeMs);
+        poolOpts.connection_idle_time = chrono::milliseconds(Config::redisConnIdleTimeMs);
+
+        redis_ = make_unique<sw::redis::Redis>(connOpts, poolOpts);
+        size_ = poolSize;
+        waitTimeout_ = chrono::milliseconds(waitTimeoutMs);
+        LOG_INFO("RedisPool init: %s:%d, size:%d, waitTimeout:%dms", host.c_str(), port, poolSize, waitTimeoutMs);
+    });
+}
+
+void RedisPool::Acquire_() {
+    // 未显式初始化时按默认配置建立，已初始化时 call_once 直接返回
+    Init(Config::redisHost, Config::redisPort, Config::redisPoolSize, Config::redisWaitTimeoutMs);
+    unique_lock<mutex> locker(mtx_);
+    acquires_++;
+    if (inUse_ >= size_) {
+        waits_++;
+        auto start = chrono::steady_clock::now();
+        bool ok = cond_.wait_for(locker, waitTimeout_, [this] { return inUse_ < size_; });
+        uint64_t waitUs = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        totalWaitUs_ += waitUs;
+        if (waitUs > maxWaitUs_) { maxWaitUs_ = waitUs; }
+        if (!ok) {
+            timeouts_++;
+            LOG_WARN("RedisPool busy! wait %llu us, inUse:%d", (unsigned long long)waitUs, inUse_);
+            throw sw::redis::TimeoutError("RedisPool: wait for connection timeout");
+        }
+    }
+    inUse_++;
+    if (inUse_ > peakInUse_) { peakInUse_ = inUse_; }
+}
+
+void RedisPool::Release_() {
+    {
+        lock_guard<mutex> locker(mtx_);
+        inUse_--;
+    }
+    cond_.notify_one();
+}
+
+RedisPoolStats RedisPool::GetStats() {
+    lock_guard<mutex> locker(mtx_);
+    RedisPoolStats stats;
+    stats.size = size_;
+    stats.inUse = inUse_;
+    stats.peakInUse = peakInUse_;
+    stats.acquires = acquires_;
+    stats.waits = waits_;
+    stats.timeouts = timeouts_;
+    stats.errors = errors_;
+    stats.totalWaitUs = totalWaitUs_;
+    stats.maxWaitUs = maxWaitUs_;
+    return stats;
+}
+
+void RedisPool::LogStats() {
+    RedisPoolStats s = GetStats();
+    LOG_INFO("RedisPool size:%d inUse:%d peak:%d acquires:%llu waits:%llu timeouts:%llu errors:%llu avgWait:%lluus maxWait:%lluus",
+             s.size, s.inUse, s.peakInUse,
+             (unsigned long long)s.acquires, (unsigned long long)s.waits,
+             (unsigned long long)s.timeouts, (unsigned long long)s.errors,
+             (unsigned long long)(s.waits ? s.totalWaitUs / s.waits : 0),
+             (unsigned long long)s.maxWaitUs);
+}
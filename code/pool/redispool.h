@@ -0,0 +1,85 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-06-24
+ * @Description  : 全进程共享的 Redis 连接池
+ */
+#ifndef REDISPOOL_H
+#define REDISPOOL_H
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <sw/redis++/redis++.h>
+#include "../log/log.h"
+
+struct RedisPoolStats {
+    int size;                 // 连接池容量
+    int inUse;                // 当前借出的连接数
+    int peakInUse;            // 借出连接数峰值
+    uint64_t acquires;        // 借用次数
+    uint64_t waits;           // 需要排队才拿到连接的次数
+    uint64_t timeouts;        // 等待超时次数
+    uint64_t errors;          // 命令执行抛出的异常次数
+    uint64_t totalWaitUs;     // 累计排队时间
+    uint64_t maxWaitUs;       // 最长一次排队时间
+};
+
+/*
+ * 整个进程只持有一个 sw::redis::Redis 对象，其内部连接池大小由 ConnectionPoolOptions 决定。
+ * Exec() 在调用前先占一个名额，名额数与连接池容量一致，因此 redis++ 内部永远不会排队，
+ * 在这里测到的等待时间就是真实的连接池等待时间。
+ */
+class RedisPool {
+public:
+    static RedisPool* Instance();
+
+    void Init(const std::string& host, int port, int poolSize, int waitTimeoutMs);
+
+    template<class F>
+    auto Exec(F&& fn) -> decltype(fn(std::declval<sw::redis::Redis&>())) {
+        Acquire_();
+        struct Releaser {
+            RedisPool* pool;
+            ~Releaser() { pool->Release_(); }
+        } releaser{this};
+        try {
+            return fn(*redis_);
+        } catch (const sw::redis::Error&) {
+            errors_++;
+            throw;
+        }
+    }
+
+    RedisPoolStats GetStats();
+    void LogStats();
+
+private:
+    RedisPool();
+    ~RedisPool() = default;
+
+    void Acquire_();
+    void Release_();
+
+    std::unique_ptr<sw::redis::Redis> redis_;
+    std::once_flag initFlag_;
+
+    int size_;
+    int inUse_;
+    int peakInUse_;
+    std::chrono::milliseconds waitTimeout_;
+
+    uint64_t acquires_;
+    uint64_t waits_;
+    uint64_t timeouts_;
+    std::atomic<uint64_t> errors_;
+    uint64_t totalWaitUs_;
+    uint64_t maxWaitUs_;
+
+    std::mutex mtx_;
+    std::condition_variable cond_;
+};
+
+#endif //REDISPOOL_H
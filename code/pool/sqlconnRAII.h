@@ -7,6 +7,7 @@
 #ifndef SQLCONNRAII_H
 #define SQLCONNRAII_H
 #include "sqlconnpool.h"
+#include "../config/config.h"
 
 /* 资源在对象构造初始化 资源在对象析构时释放*/
 class SqlConnRAII {
@@ -14,20 +15,29 @@ public:
 
     // 构造函数：执行资源的初始化
     SqlConnRAII(MYSQL** sql, SqlConnPool *connpool) {
-        *sql = connpool->GetConn(); // 获取连接
+        affine_ = Config::sqlThreadAffine;
+        *sql = affine_ ? connpool->GetThreadConn() : connpool->GetConn(); // 获取连接
         sql_ = *sql; // 保存连接指针
         connpool_ = connpool; // 保存连接池指针
     }
 
 
+    // 当前连接上的预处理语句缓存
+    SqlStmtCache* Stmts() {
+        return sql_ ? connpool_->GetStmtCache(sql_) : nullptr;
+    }
+
     // 析构函数：执行销毁操作
     ~SqlConnRAII() {
-        if(sql_) { connpool_->FreeConn(sql_); } // 不为空指针，则归还连接
+        if(!sql_) { return; }
+        if(affine_) { connpool_->ReleaseThreadConn(sql_); } // 线程亲和模式下连接留在本线程
+        else { connpool_->FreeConn(sql_); } // 不为空指针，则归还连接
     }
     
 private:
     MYSQL *sql_;
     SqlConnPool* connpool_;
+    bool affine_;
 };
 
 #endif //SQLCONNRAII_H
\ No newline at end of file
@@ -2,15 +2,20 @@
  * @Author       : mark
  * @Date         : 2020-06-17
  * @copyleft Apache 2.0
- */ 
+ */
 
 #include "sqlconnpool.h"
+#include "../config/config.h"
+#include <algorithm>
 using namespace std;
 
-SqlConnPool::SqlConnPool() {
-    // 构造函数，初始化成员变量
-    useCount_ = 0;
-    freeCount_ = 0;
+SqlConnPool::SqlConnPool(const std::string& name)
+    : name_(name), slotIndex_(0), MIN_CONN_(0), MAX_CONN_(0), total_(0), inUse_(0), peakInUse_(0), isClosed_(true), port_(0),
+      acquires_(0), waits_(0), timeouts_(0), totalWaitUs_(0), maxWaitUs_(0),
+      created_(0), connectFailures_(0), reconnects_(0), dropped_(0), closedIdle_(0),
+      pinned_(0), busy_(0), affineHits_(0), affineMisses_(0), affineFallbacks_(0) {
+    static std::atomic<int> nextSlot(0);
+    slotIndex_ = nextSlot++;
 }
 
 SqlConnPool* SqlConnPool::Instance() {
@@ -30,62 +35,425 @@ void SqlConnPool::Init(const char* host, int port,
     @user：用户名
     @pwd：密码
     @dbName：数据库名
-    @connSize：连接池大小
+    @connSize：常驻连接数，高峰期最多扩到 Config::sqlPoolMaxSize
     */
-    for (int i = 0; i < connSize; i++) {
-        MYSQL *sql = nullptr;
-        sql = mysql_init(sql); // 初始化MySQL结构体
-        if (!sql) {
-            LOG_ERROR("MySql init error!");
+    {
+        lock_guard<mutex> locker(mtx_);
+        host_ = host;
+        port_ = port;
+        user_ = user;
+        pwd_ = pwd;
+        dbName_ = dbName;
+        MIN_CONN_ = max(1, connSize);
+        MAX_CONN_ = max(MIN_CONN_, Config::sqlPoolMaxSize);
+        isClosed_ = false;
+    }
+    for (int i = 0; i < MIN_CONN_; i++) {
+        MYSQL* sql = Connect_();
+        if (!sql) { continue; } // 失败的连接不入池，借用时按需补建
+        lock_guard<mutex> locker(mtx_);
+        conns_[sql] = ConnMeta{Clock::now(), false, make_unique<SqlStmtCache>(sql)};
+        idle_.push_back(sql);
+        total_++;
+        created_++;
+    }
+    LOG_INFO("SqlConnPool[%s] %s:%d: %d/%d connections ready, max %d",
+             name_.c_str(), host_.c_str(), port_, total_, MIN_CONN_, MAX_CONN_);
+}
+
+MYSQL* SqlConnPool::Connect_() {
+    MYSQL* sql = mysql_init(nullptr); // 初始化MySQL结构体
+    if (!sql) {
+        LOG_ERROR("MySql init error!");
+        return nullptr;
+    }
+    // 超时都要设上，否则数据库无响应时借到连接的线程会一直卡住
+    unsigned int connectTimeout = Config::sqlConnectTimeoutSec;
+    unsigned int readTimeout = Config::sqlReadTimeoutSec;
+    unsigned int writeTimeout = Config::sqlWriteTimeoutSec;
+    mysql_options(sql, MYSQL_OPT_CONNECT_TIMEOUT, &connectTimeout);
+    mysql_options(sql, MYSQL_OPT_READ_TIMEOUT, &readTimeout);
+    mysql_options(sql, MYSQL_OPT_WRITE_TIMEOUT, &writeTimeout);
+    if (!mysql_real_connect(sql, host_.c_str(), user_.c_str(), pwd_.c_str(),
+                            dbName_.c_str(), port_, nullptr, 0)) { // 建立实际连接
+        LOG_ERROR("MySql Connect error[%s]: %s", name_.c_str(), mysql_error(sql));
+        mysql_close(sql);
+        return nullptr;
+    }
+    return sql;
+}
+
+MYSQL* SqlConnPool::GetConn() {
+    return GetConn(Config::sqlAcquireTimeoutMs);
+}
+
+MYSQL* SqlConnPool::GetConn(int timeoutMs) {
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + chrono::milliseconds(max(0, timeoutMs));
+    MYSQL* sql = nullptr;
+    bool needPing = false;
+    bool create = false;
+    bool waited = false;
+    {
+        unique_lock<mutex> locker(mtx_);
+        acquires_++;
+        while (true) {
+            if (isClosed_) { return nullptr; }
+            if (!idle_.empty()) {
+                // 后进先出：总是复用最热的连接，冷连接留在队头等待回收
+                sql = idle_.back();
+                idle_.pop_back();
+                ConnMeta& meta = conns_[sql];
+                meta.inUse = true;
+                needPing = start - meta.lastUsed > chrono::milliseconds(Config::sqlValidateIdleMs);
+                break;
+            }
+            Clock::time_point now = Clock::now();
+            if (waited && now >= deadline) {
+                // 等到期限才轮到建连也不建了：建连本身要花一个连接超时，调用方的等待上限不能被拖长
+                timeouts_++;
+                RecordWait_(start);
+                LOG_WARN("SqlConnPool[%s] busy! wait %dms timeout, %d/%d in use",
+                         name_.c_str(), timeoutMs, inUse_.load(), total_);
+                return nullptr;
+            }
+            if (total_ < MAX_CONN_ && now >= connectBackoff_) {
+                total_++; // 先占名额，连接在锁外建立
+                create = true;
+                break;
+            }
+            if (!waited) {
+                waited = true;
+                waits_++;
+            }
+            // 有空名额时只是在等建连退避结束，退避到期没人通知，要自己醒来
+            Clock::time_point wakeAt = deadline;
+            if (total_ < MAX_CONN_ && connectBackoff_ < wakeAt) { wakeAt = connectBackoff_; }
+            cond_.wait_until(locker, wakeAt);
         }
-        sql = mysql_real_connect(sql, host,
-                                 user, pwd,
-                                 dbName, port, nullptr, 0); // 建立实际连接
+        inUse_++;
+        busy_++;
+        peakInUse_ = max(peakInUse_, inUse_.load());
+        if (waited) { RecordWait_(start); }
+    }
+
+    if (create) {
+        sql = Connect_();
+        lock_guard<mutex> locker(mtx_);
         if (!sql) {
-            LOG_ERROR("MySql Connect error!");
+            total_--;
+            inUse_--;
+            busy_--;
+            connectFailures_++;
+            connectBackoff_ = Clock::now() + chrono::seconds(1);
+            cond_.notify_one();
+            return nullptr;
         }
-        connQue_.push(sql); // 成功建立的连接放入队列
+        created_++;
+        conns_[sql] = ConnMeta{Clock::now(), true, make_unique<SqlStmtCache>(sql)};
+        return sql;
     }
-    MAX_CONN_ = connSize; // 记录最大连接数
-    sem_init(&semId_, 0, MAX_CONN_); // 初始化信号量，初始值是最大连接数数
+    return needPing ? Validate_(sql) : sql;
 }
 
-MYSQL* SqlConnPool::GetConn() {
-    MYSQL *sql = nullptr;
-    if(connQue_.empty()){
-        LOG_WARN("SqlConnPool busy!");
+MYSQL* SqlConnPool::Validate_(MYSQL* sql) {
+    // 空闲太久的连接可能已被服务端 wait_timeout 断开，借出前确认一下
+    if (mysql_ping(sql) == 0) { return sql; }
+    LOG_WARN("SqlConnPool[%s]: ping failed (%s), reconnecting", name_.c_str(), mysql_error(sql));
+
+    unique_ptr<SqlStmtCache> stmts;
+    PinPtr pin;
+    {
+        lock_guard<mutex> locker(mtx_);
+        auto it = conns_.find(sql);
+        stmts = move(it->second.stmts);
+        pin = move(it->second.pin);
+        conns_.erase(it);
+    }
+    MYSQL* fresh = Connect_();
+    if (fresh) {
+        stmts->Rebind(fresh); // 语句缓存跟着换到新句柄上，旧语句在这里关闭
+    } else {
+        stmts.reset();
+    }
+    mysql_close(sql);
+
+    lock_guard<mutex> locker(mtx_);
+    if (!fresh) {
+        total_--;
+        inUse_--;
+        busy_--;
+        connectFailures_++;
+        connectBackoff_ = Clock::now() + chrono::seconds(1);
+        cond_.notify_one();
         return nullptr;
     }
-    // 信号量控制总连接数，互斥锁保护队列操作
-    sem_wait(&semId_); // 获取信号量，没有回阻塞
+    reconnects_++;
+    conns_[fresh] = ConnMeta{Clock::now(), true, move(stmts), move(pin)};
+    return fresh;
+}
+
+void SqlConnPool::RecordWait_(Clock::time_point start) {
+    uint64_t us = chrono::duration_cast<chrono::microseconds>(Clock::now() - start).count();
+    totalWaitUs_ += us;
+    maxWaitUs_ = max(maxWaitUs_, us);
+}
+
+void SqlConnPool::FreeConn(MYSQL* sql) {
+    if (!sql) { return; }
+    CloseList closing;
+    {
+        lock_guard<mutex> locker(mtx_); // 构造时加锁、析构时解锁
+        auto it = conns_.find(sql);
+        if (it == conns_.end() || !it->second.inUse) {
+            LOG_ERROR("SqlConnPool: free unknown connection!");
+            return;
+        }
+        inUse_--;
+        busy_--;
+        bool lost = it->second.stmts && it->second.stmts->ConnLost();
+        it->second.pin.reset();
+        if (isClosed_ || lost) {
+            // 执行中断线的连接不再放回，下次借用时按需补建
+            closing.emplace_back(sql, move(it->second.stmts));
+            conns_.erase(it);
+            total_--;
+            if (lost) { dropped_++; }
+        } else {
+            it->second.inUse = false;
+            it->second.lastUsed = Clock::now();
+            idle_.push_back(sql); // 将连接重新放回连接队列
+            CollectIdle_(closing);
+        }
+    }
+    if (isClosed_) { cond_.notify_all(); } // ClosePool 在等借出的连接全部归还
+    else { cond_.notify_one(); }
+    CloseAll_(closing);
+}
+
+SqlConnPool::ThreadSlot* SqlConnPool::LocalSlot_() {
+    thread_local ThreadSlot slots[MAX_AFFINE_POOLS];
+    if (slotIndex_ >= MAX_AFFINE_POOLS) { return nullptr; }
+    ThreadSlot& slot = slots[slotIndex_];
+    slot.owner = this;
+    return &slot;
+}
+
+SqlConnPool::ThreadSlot::~ThreadSlot() {
+    if (!sql || !owner) { return; }
+    int expected = PIN_IDLE;
+    if (pin->compare_exchange_strong(expected, PIN_BUSY)) {
+        owner->busy_++;   // 和借用一样转入 PIN_BUSY，FreeConn 里再减掉
+        owner->Unpin_(*this);
+    }
+    else { owner->DropSlot_(*this); }
+}
+
+void SqlConnPool::Unpin_(ThreadSlot& slot) {
+    // 调用前槽位必须是 PIN_BUSY，连接池不会同时收走它
+    MYSQL* sql = slot.sql;
+    DropSlot_(slot);
+    pinned_--;
+    FreeConn(sql);
+}
+
+void SqlConnPool::DropSlot_(ThreadSlot& slot) {
+    slot.sql = nullptr;
+    slot.stmts = nullptr;
+    slot.pin.reset();
+    slot.busy = false;
+}
+
+MYSQL* SqlConnPool::GetThreadConn() {
+    ThreadSlot* local = LocalSlot_();
+    if (!local) { return GetConn(); }
+    ThreadSlot& slot = *local;
+    if (slot.busy || isClosed_) {
+        // 同一线程嵌套借用时，内层走普通路径
+        affineFallbacks_++;
+        return GetConn();
+    }
+    if (slot.sql) {
+        int expected = PIN_IDLE;
+        if (!slot.pin->compare_exchange_strong(expected, PIN_BUSY)) {
+            // 连接池关闭时已经把这条连接收走并关闭了
+            DropSlot_(slot);
+            affineFallbacks_++;
+            return GetConn();
+        }
+        busy_++;
+        Clock::time_point now = Clock::now();
+        if (now - slot.lastUsed > chrono::milliseconds(Config::sqlValidateIdleMs)) {
+            MYSQL* sql = Validate_(slot.sql);
+            if (!sql) {
+                // 重连失败，Validate_ 已经把旧连接从池里移除
+                DropSlot_(slot);
+                pinned_--;
+                return nullptr;
+            }
+            slot.sql = sql;
+        }
+        slot.busy = true;
+        affineHits_++;
+        return slot.sql;
+    }
+
+    MYSQL* sql = GetConn();
+    if (!sql) { return nullptr; }
+    PinPtr pin = make_shared<atomic<int>>(PIN_BUSY);
     {
         lock_guard<mutex> locker(mtx_);
-        sql = connQue_.front();
-        connQue_.pop();
-    } // 使用互斥锁保护连接队列
+        auto it = conns_.find(sql);
+        it->second.pin = pin;
+        slot.stmts = it->second.stmts.get();
+    }
+    affineMisses_++;
+    pinned_++;
+    slot.sql = sql;
+    slot.pin = pin;
+    slot.busy = true;
     return sql;
 }
 
-void SqlConnPool::FreeConn(MYSQL* sql) {
-    lock_guard<mutex> locker(mtx_); // 构造时加锁、析构时解锁
-    connQue_.push(sql); // 将连接重新放回连接队列
-    sem_post(&semId_); // 增加信号量计数
+void SqlConnPool::ReleaseThreadConn(MYSQL* sql) {
+    if (!sql) { return; }
+    ThreadSlot* local = LocalSlot_();
+    if (!local || sql != local->sql) {
+        FreeConn(sql);
+        return;
+    }
+    ThreadSlot& slot = *local;
+    slot.busy = false;
+    slot.lastUsed = Clock::now();
+    if (isClosed_ || (slot.stmts && slot.stmts->ConnLost())) {
+        // 连接池已关闭或连接已断，不再固定，交给 FreeConn 关闭；此时仍是 PIN_BUSY，连接池不会收走
+        Unpin_(slot);
+        return;
+    }
+    busy_--;
+    slot.pin->store(PIN_IDLE);
+}
+
+void SqlConnPool::CollectIdle_(CloseList& out) {
+    // 队头是最久未用的连接，超过常驻数量的部分空闲超时就收回
+    Clock::time_point now = Clock::now();
+    while (total_ > MIN_CONN_ && !idle_.empty()) {
+        MYSQL* sql = idle_.front();
+        auto it = conns_.find(sql);
+        if (now - it->second.lastUsed < chrono::milliseconds(Config::sqlIdleTimeoutMs)) { break; }
+        idle_.pop_front();
+        out.emplace_back(sql, move(it->second.stmts));
+        conns_.erase(it);
+        total_--;
+        closedIdle_++;
+    }
+}
+
+void SqlConnPool::CloseAll_(CloseList& list) {
+    for (auto& item : list) {
+        item.second.reset(); // 先关闭语句句柄再关闭连接
+        mysql_close(item.first);
+    }
+    list.clear();
 }
 
 void SqlConnPool::ClosePool() {
-    lock_guard<mutex> locker(mtx_); // 使用RAII模式的lock_guard自动管理锁生命周期
-    while(!connQue_.empty()) {
-        // 循环直到队列为空
-        auto item = connQue_.front();
-        connQue_.pop();
-        mysql_close(item);
+    CloseList closing;
+    bool drained;
+    {
+        unique_lock<mutex> locker(mtx_);
+        if (isClosed_.exchange(true)) { return; } // 没有初始化过，或已经关闭（析构时会再调一次）
+        for (MYSQL* sql : idle_) {
+            auto it = conns_.find(sql);
+            closing.emplace_back(sql, move(it->second.stmts));
+            conns_.erase(it);
+            total_--;
+        }
+        idle_.clear();
+        // 固定在线程里但没在用的连接直接收走，那些线程之后不会再碰它
+        for (auto it = conns_.begin(); it != conns_.end();) {
+            int expected = PIN_IDLE;
+            if (it->second.pin && it->second.pin->compare_exchange_strong(expected, PIN_RECLAIMED)) {
+                closing.emplace_back(it->first, move(it->second.stmts));
+                it = conns_.erase(it);
+                total_--;
+                inUse_--;
+                pinned_--;
+            } else {
+                ++it;
+            }
+        }
+        cond_.notify_all();
+        // 仍在借出中的连接由 FreeConn 归还时关闭，等它们都还回来
+        drained = cond_.wait_for(locker, chrono::milliseconds(Config::sqlCloseWaitMs),
+                                 [this] { return inUse_ == 0; });
+    }
+    CloseAll_(closing);
+    if (!drained) {
+        // 还有线程在用连接，这时终止客户端库会让它们访问已释放的状态，宁可不终止
+        LOG_WARN("SqlConnPool[%s]: %d connections still in use after %dms, skip mysql_library_end",
+                 name_.c_str(), inUse_.load(), Config::sqlCloseWaitMs);
+        return;
     }
-    mysql_library_end(); // 终止数据库     
+    if (this == Instance()) { mysql_library_end(); } // 从库连接池先关，主库最后关闭时终止数据库
+}
+
+SqlStmtCache* SqlConnPool::GetStmtCache(MYSQL* sql) {
+    // 连接在借出期间只属于一个线程，缓存本身不需要加锁，只有查表需要
+    if (!sql) return nullptr;
+    ThreadSlot* slot = LocalSlot_();
+    if (slot && slot->sql == sql && slot->stmts) { return slot->stmts; } // 本线程固定的连接不用查表
+    lock_guard<mutex> locker(mtx_);
+    auto it = conns_.find(sql);
+    return it == conns_.end() ? nullptr : it->second.stmts.get();
 }
 
 int SqlConnPool::GetFreeConnCount() {
     lock_guard<mutex> locker(mtx_);
-    return connQue_.size();
+    return idle_.size();
+}
+
+SqlPoolStats SqlConnPool::GetStats() {
+    lock_guard<mutex> locker(mtx_);
+    SqlPoolStats stats;
+    stats.minSize = MIN_CONN_;
+    stats.maxSize = MAX_CONN_;
+    stats.total = total_;
+    stats.idle = idle_.size();
+    stats.inUse = inUse_;
+    stats.peakInUse = peakInUse_;
+    stats.acquires = acquires_;
+    stats.waits = waits_;
+    stats.timeouts = timeouts_;
+    stats.totalWaitUs = totalWaitUs_;
+    stats.maxWaitUs = maxWaitUs_;
+    stats.created = created_;
+    stats.connectFailures = connectFailures_;
+    stats.reconnects = reconnects_;
+    stats.dropped = dropped_;
+    stats.closedIdle = closedIdle_;
+    stats.pinned = pinned_;
+    stats.busy = busy_;
+    stats.affineHits = affineHits_;
+    stats.affineMisses = affineMisses_;
+    stats.affineFallbacks = affineFallbacks_;
+    return stats;
+}
+
+void SqlConnPool::LogStats() {
+    SqlPoolStats s = GetStats();
+    LOG_INFO("SqlConnPool[%s]: size %d(%d-%d) idle %d inUse %d peak %d, acquires %llu waits %llu timeouts %llu, "
+             "wait avg %lluus max %lluus, created %llu failed %llu reconnects %llu dropped %llu idleClosed %llu",
+             name_.c_str(), s.total, s.minSize, s.maxSize, s.idle, s.inUse, s.peakInUse,
+             (unsigned long long)s.acquires, (unsigned long long)s.waits, (unsigned long long)s.timeouts,
+             (unsigned long long)(s.waits ? s.totalWaitUs / s.waits : 0), (unsigned long long)s.maxWaitUs,
+             (unsigned long long)s.created, (unsigned long long)s.connectFailures,
+             (unsigned long long)s.reconnects, (unsigned long long)s.dropped, (unsigned long long)s.closedIdle);
+    if (Config::sqlThreadAffine) {
+        LOG_INFO("SqlConnPool[%s] affine: pinned %d busy %d hits %llu misses %llu fallbacks %llu",
+                 name_.c_str(), s.pinned, s.busy, (unsigned long long)s.affineHits,
+                 (unsigned long long)s.affineMisses, (unsigned long long)s.affineFallbacks);
+    }
 }
 
 SqlConnPool::~SqlConnPool() {
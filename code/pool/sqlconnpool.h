@@ -2,43 +2,143 @@
  * @Author       : mark
  * @Date         : 2020-06-16
  * @copyleft Apache 2.0
- */ 
+ */
 #ifndef SQLCONNPOOL_H
 #define SQLCONNPOOL_H
 
 #include <mysql/mysql.h>
 #include <string>
-#include <queue>
+#include <deque>
 #include <mutex>
-#include <semaphore.h>
+#include <chrono>
 #include <thread>
+#include <memory>
+#include <condition_variable>
+#include <unordered_map>
+#include <vector>
+#include <atomic>
 #include "../log/log.h"
+#include "sqlstmtcache.h"
 
+struct SqlPoolStats {
+    int minSize;
+    int maxSize;
+    int total;               // 当前连接总数（空闲 + 借出）
+    int idle;
+    int inUse;
+    int peakInUse;
+    uint64_t acquires;       // 借用次数
+    uint64_t waits;          // 需要排队的次数
+    uint64_t timeouts;       // 排队超时次数
+    uint64_t totalWaitUs;
+    uint64_t maxWaitUs;
+    uint64_t created;        // 新建连接数（含扩容）
+    uint64_t connectFailures;
+    uint64_t reconnects;     // ping 失败后重建的连接数
+    uint64_t dropped;        // 执行中断线、归还时直接丢弃的连接数
+    uint64_t closedIdle;     // 因空闲被回收的连接数
+    int pinned;              // 被线程固定占用的连接数
+    int busy;                // 正在执行的连接数，不含固定在线程里闲着的
+    uint64_t affineHits;     // 直接用本线程连接、没碰连接池锁的次数
+    uint64_t affineMisses;   // 本线程还没有连接，从池里借一条固定下来
+    uint64_t affineFallbacks;// 本线程连接正被占用（嵌套使用），退回普通借还
+};
+
+/*
+ * Instance() 是主库连接池；读写分离时 SqlRouter 另外为每个从库创建一个实例。
+ */
 class SqlConnPool {
 public:
-    static SqlConnPool *Instance();
+    static SqlConnPool *Instance();   // 主库
 
-    MYSQL *GetConn();
+    explicit SqlConnPool(const std::string& name = "primary");
+    ~SqlConnPool();
+
+    MYSQL *GetConn();                 // 等待 Config::sqlAcquireTimeoutMs
+    MYSQL *GetConn(int timeoutMs);    // 超时返回 nullptr
     void FreeConn(MYSQL * conn);
+    // 线程亲和模式：优先使用本线程固定的连接，没有时从池里借一条并固定
+    MYSQL *GetThreadConn();
+    void ReleaseThreadConn(MYSQL * conn);
     int GetFreeConnCount();
+    // 正在执行的连接数，不加锁，只作负载参考；固定在线程里闲着的连接算在 inUse 里但不算在这里
+    int Busy() const { return busy_.load(std::memory_order_relaxed); }
+    const std::string& Name() const { return name_; }
+    SqlStmtCache* GetStmtCache(MYSQL* conn);
 
     void Init(const char* host, int port,
-              const char* user,const char* pwd, 
+              const char* user,const char* pwd,
               const char* dbName, int connSize);
     void ClosePool();
 
+    SqlPoolStats GetStats();
+    void LogStats();
+
 private:
-    SqlConnPool();
-    ~SqlConnPool();
+    typedef std::chrono::steady_clock Clock;
 
+    /*
+     * 固定连接的状态，线程和连接池共享：线程借用时 IDLE -> BUSY，归还时 -> IDLE；
+     * ClosePool 只能把 IDLE 的改成 RECLAIMED 并关掉连接，线程之后发现 CAS 失败就丢掉槽位，不再碰这条连接。
+     */
+    enum PinState { PIN_IDLE, PIN_BUSY, PIN_RECLAIMED };
+    typedef std::shared_ptr<std::atomic<int>> PinPtr;
+
+    /* 线程退出时析构，把固定的连接还给所属的连接池 */
+    struct ThreadSlot {
+        SqlConnPool* owner = nullptr;
+        MYSQL* sql = nullptr;
+        SqlStmtCache* stmts = nullptr;
+        PinPtr pin;
+        bool busy = false;
+        Clock::time_point lastUsed;
+        ~ThreadSlot();
+    };
+    // 每个线程为每个连接池各留一个槽位，超出 MAX_AFFINE_POOLS 的连接池不做线程亲和，返回 nullptr
+    ThreadSlot* LocalSlot_();
+    static const int MAX_AFFINE_POOLS = 8;
+    void Unpin_(ThreadSlot& slot);
+    void DropSlot_(ThreadSlot& slot);   // 连接已被 ClosePool 收走，只清空槽位
+
+    struct ConnMeta {
+        Clock::time_point lastUsed;
+        bool inUse;
+        std::unique_ptr<SqlStmtCache> stmts;
+        PinPtr pin;       // 被线程固定时非空
+    };
+
+    MYSQL* Connect_();
+    MYSQL* Validate_(MYSQL* sql);
+    void RecordWait_(Clock::time_point start);
+
+    typedef std::vector<std::pair<MYSQL*, std::unique_ptr<SqlStmtCache>>> CloseList;
+    void CollectIdle_(CloseList& out);
+    static void CloseAll_(CloseList& list);
+
+    std::string name_;
+    int slotIndex_;
+    int MIN_CONN_;
     int MAX_CONN_;
-    int useCount_;
-    int freeCount_;
+    int total_;             // 包括正在建立中的连接
+    std::atomic<int> inUse_;
+    int peakInUse_;
+    std::atomic<bool> isClosed_;
+
+    std::string host_, user_, pwd_, dbName_;
+    int port_;
+
+    uint64_t acquires_, waits_, timeouts_, totalWaitUs_, maxWaitUs_;
+    uint64_t created_, connectFailures_, reconnects_, dropped_, closedIdle_;
+    std::atomic<int> pinned_;
+    std::atomic<int> busy_;   // 借给调用方还没还回来的；线程槽位 PIN_BUSY 时计入，PIN_IDLE 时不计
+    std::atomic<uint64_t> affineHits_, affineMisses_, affineFallbacks_;
+    Clock::time_point connectBackoff_;   // 建连失败后短时间内不再尝试，避免每个请求都卡在连接超时上
 
-    std::queue<MYSQL *> connQue_;
+    std::deque<MYSQL *> idle_;                        // 尾部是最近归还的连接
+    std::unordered_map<MYSQL*, ConnMeta> conns_;      // 全部连接
     std::mutex mtx_;
-    sem_t semId_;
+    std::condition_variable cond_;
 };
 
 
-#endif // SQLCONNPOOL_H
\ No newline at end of file
+#endif // SQLCONNPOOL_H
@@ -0,0 +1,167 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-10
+ * @Description  : MySQL 读写分离，写和强一致读走主库，其余读按策略分到从库
+ */
+#include "sqlrouter.h"
+#include "../config/config.h"
+#include "../log/log.h"
+using namespace std;
+
+SqlRouter::SqlRouter()
+    : next_(0), primaryReads_(0), replicaReads_(0), rywReads_(0), fallbacks_(0) {}
+
+SqlRouter::~SqlRouter() {
+    Close();
+}
+
+SqlRouter* SqlRouter::Instance() {
+    static SqlRouter router;
+    return &router;
+}
+
+void SqlRouter::Init(const char* user, const char* pwd, const char* dbName, int connSize) {
+    for (size_t i = 0; i < Config::sqlReplicas.size(); i++) {
+        const SqlReplicaAddr& addr = Config::sqlReplicas[i];
+        unique_ptr<SqlConnPool> pool(new SqlConnPool("replica" + to_string(i + 1)));
+        pool->Init(addr.host.c_str(), addr.port, user, pwd, dbName, connSize);
+        replicas_.push_back(move(pool));
+    }
+    LOG_INFO("SqlRouter: %zu replicas, policy %s, read-your-writes %dms", replicas_.size(),
+             Config::sqlReplicaPolicy == ReplicaPolicy::ROUND_ROBIN ? "round-robin" : "least-outstanding",
+             Config::sqlReadYourWritesMs);
+}
+
+void SqlRouter::Close() {
+    // 只关连接池，对象留到进程退出，避免其他线程手里的指针悬空
+    for (auto& pool : replicas_) {
+        pool->ClosePool();
+    }
+}
+
+template <typename Key, typename Map>
+static bool InWindow(Map& until, const Key& key, chrono::steady_clock::time_point now) {
+    auto it = until.find(key);
+    if (it == until.end()) { return false; }
+    if (it->second > now) { return true; }
+    until.erase(it);
+    return false;
+}
+
+template <typename Key, typename Map>
+static void OpenWindow(Map& until, const Key& key, chrono::steady_clock::time_point now) {
+    until[key] = now + chrono::milliseconds(Config::sqlReadYourWritesMs);
+    if (until.size() > 1024) {
+        // 窗口很短，条目多时顺手清掉已经过期的，不单独起清理线程
+        for (auto it = until.begin(); it != until.end();) {
+            if (it->second <= now) { it = until.erase(it); }
+            else { ++it; }
+        }
+    }
+}
+
+bool SqlRouter::InWriteWindow_(int userId) {
+    Shard& shard = shards_[userId % SHARD_COUNT];
+    lock_guard<mutex> locker(shard.mtx);
+    return InWindow(shard.until, userId, Clock::now());
+}
+
+bool SqlRouter::InWriteWindow_(const string& username) {
+    Shard& shard = shards_[hash<string>()(username) % SHARD_COUNT];
+    lock_guard<mutex> locker(shard.mtx);
+    return InWindow(shard.names, username, Clock::now());
+}
+
+void SqlRouter::NoteWrite(int userId) {
+    if (replicas_.empty() || userId <= 0 || Config::sqlReadYourWritesMs <= 0) { return; }
+    Shard& shard = shards_[userId % SHARD_COUNT];
+    lock_guard<mutex> locker(shard.mtx);
+    OpenWindow(shard.until, userId, Clock::now());
+}
+
+void SqlRouter::NoteUserWrite(const string& username) {
+    if (replicas_.empty() || Config::sqlReadYourWritesMs <= 0) { return; }
+    Shard& shard = shards_[hash<string>()(username) % SHARD_COUNT];
+    lock_guard<mutex> locker(shard.mtx);
+    OpenWindow(shard.names, username, Clock::now());
+}
+
+SqlConnPool* SqlRouter::ForRead(int userId) {
+    if (replicas_.empty()) {
+        primaryReads_++;
+        return Primary();
+    }
+    if (userId > 0 && InWriteWindow_(userId)) {
+        rywReads_++;
+        return Primary();
+    }
+    return PickReplica_();
+}
+
+SqlConnPool* SqlRouter::ForUserRead(const string& username) {
+    if (replicas_.empty()) {
+        primaryReads_++;
+        return Primary();
+    }
+    if (InWriteWindow_(username)) {
+        rywReads_++;
+        return Primary();
+    }
+    return PickReplica_();
+}
+
+SqlConnPool* SqlRouter::PickReplica_() {
+    replicaReads_++;
+    size_t n = replicas_.size();
+    size_t start = next_++;
+    if (Config::sqlReplicaPolicy == ReplicaPolicy::ROUND_ROBIN) {
+        return replicas_[start % n].get();
+    }
+    // 正在执行的连接最少的从库；起点轮转，负载相同时不总是落在第一个。
+    // 不按借出数比较：线程亲和模式下固定在线程里闲着的连接也算借出，比的就成了各从库被多少线程固定过
+    SqlConnPool* best = nullptr;
+    for (size_t i = 0; i < n; i++) {
+        SqlConnPool* pool = replicas_[(start + i) % n].get();
+        if (!best || pool->Busy() < best->Busy()) { best = pool; }
+    }
+    return best;
+}
+
+SqlRouterStats SqlRouter::GetStats() const {
+    SqlRouterStats stats;
+    stats.replicas = static_cast<int>(replicas_.size());
+    stats.primaryReads = primaryReads_;
+    stats.replicaReads = replicaReads_;
+    stats.rywReads = rywReads_;
+    stats.fallbacks = fallbacks_;
+    return stats;
+}
+
+void SqlRouter::LogStats() {
+    SqlRouterStats s = GetStats();
+    LOG_INFO("SqlRouter replicas:%d primaryReads:%llu replicaReads:%llu rywReads:%llu fallbacks:%llu",
+             s.replicas, (unsigned long long)s.primaryReads, (unsigned long long)s.replicaReads,
+             (unsigned long long)s.rywReads, (unsigned long long)s.fallbacks);
+    for (auto& pool : replicas_) {
+        pool->LogStats();
+    }
+}
+
+SqlReadRAII::SqlReadRAII(int userId) : sql_(nullptr) {
+    Borrow_(SqlRouter::Instance()->ForRead(userId));
+}
+
+SqlReadRAII::SqlReadRAII(const string& username) : sql_(nullptr) {
+    Borrow_(SqlRouter::Instance()->ForUserRead(username));
+}
+
+void SqlReadRAII::Borrow_(SqlConnPool* pool) {
+    SqlRouter* router = SqlRouter::Instance();
+    conn_.emplace(&sql_, pool);
+    if (!sql_ && pool != router->Primary()) {
+        // 从库宕机时连接池处于建连退避期，这里很快就会拿到 nullptr
+        conn_.reset();
+        router->NoteFallback();
+        conn_.emplace(&sql_, router->Primary());
+    }
+}
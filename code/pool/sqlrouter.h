@@ -0,0 +1,96 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-10
+ * @Description  : MySQL 读写分离，写和强一致读走主库，其余读按策略分到从库
+ */
+#ifndef SQLROUTER_H
+#define SQLROUTER_H
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "sqlconnpool.h"
+#include "sqlconnRAII.h"
+
+struct SqlRouterStats {
+    int replicas;
+    uint64_t primaryReads;   // 没有从库或要求强一致的读
+    uint64_t replicaReads;
+    uint64_t rywReads;       // 用户刚写过，读被拉回主库
+    uint64_t fallbacks;      // 从库借不到连接，退回主库
+};
+
+/*
+ * 主库就是 SqlConnPool::Instance()，从库按 Config::sqlReplicas 各建一个连接池。
+ * 用户上传/删除后 Config::sqlReadYourWritesMs 内，该用户的读都走主库，
+ * 避免刚写完就从落后的从库读到旧列表；用户名刚注册时同样按用户名开一个窗口，
+ * 注册后紧接着的登录不会因为从库还没复制到而查不到。没有配置从库时所有读写都走主库。
+ */
+class SqlRouter {
+public:
+    static SqlRouter* Instance();
+
+    // 为每个从库建立连接池，账号和库名与主库相同
+    void Init(const char* user, const char* pwd, const char* dbName, int connSize);
+    void Close();
+
+    SqlConnPool* Primary() { return SqlConnPool::Instance(); }
+    // userId > 0 时检查该用户的读己之写窗口
+    SqlConnPool* ForRead(int userId = 0);
+    // 按用户名查用户时用，刚注册的用户名在窗口内读主库
+    SqlConnPool* ForUserRead(const std::string& username);
+    void NoteWrite(int userId);
+    void NoteUserWrite(const std::string& username);
+    void NoteFallback() { fallbacks_++; }
+
+    SqlRouterStats GetStats() const;
+    void LogStats();
+
+private:
+    SqlRouter();
+    ~SqlRouter();
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<int, Clock::time_point> until;   // userId -> 窗口结束时间
+        std::unordered_map<std::string, Clock::time_point> names;   // 刚注册的用户名 -> 窗口结束时间
+    };
+
+    bool InWriteWindow_(int userId);
+    bool InWriteWindow_(const std::string& username);
+    SqlConnPool* PickReplica_();
+
+    static const int SHARD_COUNT = 16;
+
+    std::vector<std::unique_ptr<SqlConnPool>> replicas_;
+    std::atomic<size_t> next_;
+    Shard shards_[SHARD_COUNT];
+
+    std::atomic<uint64_t> primaryReads_;
+    std::atomic<uint64_t> replicaReads_;
+    std::atomic<uint64_t> rywReads_;
+    std::atomic<uint64_t> fallbacks_;
+};
+
+/* 读连接：按路由借连接，从库借不到时退回主库 */
+class SqlReadRAII {
+public:
+    explicit SqlReadRAII(int userId = 0);
+    explicit SqlReadRAII(const std::string& username);
+    SqlStmtCache* Stmts() { return conn_ ? conn_->Stmts() : nullptr; }
+
+private:
+    void Borrow_(SqlConnPool* pool);
+
+    MYSQL* sql_;
+    std::optional<SqlConnRAII> conn_;
+};
+
+#endif // SQLROUTER_H
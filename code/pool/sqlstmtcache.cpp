@@ -0,0 +1,253 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-06-30
+ * @Description  : 每个池化 MySQL 连接上的预处理语句缓存，以及参数/结果绑定的辅助类
+ */
+#include "sqlstmtcache.h"
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+using namespace std;
+
+const char* const SqlStmtCache::SQL_TEXT[STMT_COUNT] = {
+    /* STMT_USER_EXISTS */
+    "SELECT 1 FROM user WHERE username = ? LIMIT 1",
+    /* STMT_USER_GET_HASH */
+    "SELECT id, password FROM user WHERE username = ? LIMIT 1",
+    /* STMT_USER_INSERT */
+    "INSERT INTO user(username, password) VALUES(?, ?)",
+    /* STMT_USER_NAMES */
+    "SELECT username FROM user",
+    /* STMT_FILE_INSERT */
+    "INSERT INTO uploaded_files (original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id, content_hash) VALUES (?, ?, ?, ?, NOW(), ?, ?, ?)",
+    /* STMT_FILE_DELETE_ID */
+    "DELETE FROM uploaded_files WHERE id = ?",
+    /* STMT_FILE_LIST */
+    "SELECT id, original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id FROM uploaded_files "
+    "WHERE uploader_id = ? ORDER BY upload_time DESC",
+    /* STMT_FILE_STORED_NAMES */
+    "SELECT stored_filename FROM uploaded_files WHERE uploader_id = ?",
+    /* STMT_FILE_PAGE_FIRST：按 (upload_time, id) 倒序的第一页，依赖索引 (uploader_id, upload_time, id) */
+    "SELECT id, original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id FROM uploaded_files "
+    "WHERE uploader_id = ? ORDER BY upload_time DESC, id DESC LIMIT ?",
+    /* STMT_FILE_PAGE_AFTER：从游标 (upload_time, id) 之后继续，不用 OFFSET */
+    "SELECT id, original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id FROM uploaded_files "
+    "WHERE uploader_id = ? AND (upload_time < ? OR (upload_time = ? AND id < ?)) "
+    "ORDER BY upload_time DESC, id DESC LIMIT ?",
+    /* STMT_FILE_FIND：删除前先找出同名记录和它们引用的内容 */
+    "SELECT id, file_path, content_hash, file_size FROM uploaded_files WHERE stored_filename = ? AND uploader_id = ?",
+    /* STMT_FILE_GET */
+    "SELECT id, original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id, content_hash FROM uploaded_files "
+    "WHERE stored_filename = ? AND uploader_id = ? ORDER BY id DESC LIMIT 1",
+    /* STMT_BLOB_ADDREF */
+    "INSERT INTO blobs (hash, size, refcount) VALUES (?, ?, 1) "
+    "ON DUPLICATE KEY UPDATE refcount = refcount + 1",
+    /* STMT_BLOB_RELEASE */
+    "UPDATE blobs SET refcount = refcount - 1 WHERE hash = ?",
+    /* STMT_BLOB_GARBAGE */
+    "SELECT hash FROM blobs WHERE refcount <= 0 LIMIT ?",
+    /* STMT_BLOB_REMOVE */
+    "DELETE FROM blobs WHERE hash = ? AND refcount <= 0",
+    /* STMT_FILE_LEGACY：迁移工具按主键顺序分批读取没有摘要的旧记录 */
+    "SELECT id, original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id FROM uploaded_files "
+    "WHERE id > ? AND (content_hash IS NULL OR content_hash = '') ORDER BY id LIMIT ?",
+    /* STMT_FILE_ATTACH：只改仍未迁移的记录，重复运行迁移不会加两次引用 */
+    "UPDATE uploaded_files SET file_path = ?, file_size = ?, content_hash = ? "
+    "WHERE id = ? AND (content_hash IS NULL OR content_hash = '')",
+    /* STMT_FILE_USAGE：SUM 的结果是 DECIMAL，转成整数才能绑定到 long long */
+    "SELECT uploader_id, CAST(SUM(file_size) AS SIGNED) FROM uploaded_files GROUP BY uploader_id",
+};
+
+SqlStmtCache::SqlStmtCache(MYSQL* sql) : sql_(sql), threadId_(0), connLost_(false) {
+    for (auto& stmt : stmts_) { stmt = nullptr; }
+    if (sql_) { threadId_ = mysql_thread_id(sql_); }
+}
+
+SqlStmtCache::~SqlStmtCache() {
+    Reset();
+}
+
+void SqlStmtCache::Reset() {
+    for (auto& stmt : stmts_) {
+        if (stmt) {
+            mysql_stmt_close(stmt);
+            stmt = nullptr;
+        }
+    }
+}
+
+void SqlStmtCache::Rebind(MYSQL* sql) {
+    Reset();
+    sql_ = sql;
+    threadId_ = sql_ ? mysql_thread_id(sql_) : 0;
+    connLost_ = false;
+}
+
+bool SqlStmtCache::IsConnLost(unsigned int err) {
+    return err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST;
+}
+
+MYSQL_STMT* SqlStmtCache::Get(StmtId id) {
+    if (!sql_ || id < 0 || id >= STMT_COUNT) return nullptr;
+    unsigned long threadId = mysql_thread_id(sql_);
+    if (threadId != threadId_) {
+        // 连接已经重连过，服务端的预处理语句随旧会话一起失效
+        Reset();
+        threadId_ = threadId;
+    }
+    if (stmts_[id]) return stmts_[id];
+
+    MYSQL_STMT* stmt = mysql_stmt_init(sql_);
+    if (!stmt) {
+        LOG_ERROR("mysql_stmt_init failed: %s", mysql_error(sql_));
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(stmt, SQL_TEXT[id], strlen(SQL_TEXT[id])) != 0) {
+        LOG_ERROR("MySQL 预处理失败[%d]: %s", id, mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    stmts_[id] = stmt;
+    return stmt;
+}
+
+MYSQL_STMT* SqlStmtCache::Execute(StmtId id, MYSQL_BIND* params) {
+    MYSQL_STMT* stmt = Get(id);
+    if (!stmt) return nullptr;
+    if (params && mysql_stmt_bind_param(stmt, params) != 0) {
+        LOG_ERROR("MySQL 参数绑定失败[%d]: %s", id, mysql_stmt_error(stmt));
+        return nullptr;
+    }
+    if (mysql_stmt_execute(stmt) != 0) {
+        unsigned int err = mysql_stmt_errno(stmt);
+        if (err == ER_DUP_ENTRY) {
+            // 注册只发一条 INSERT，用户名重复由唯一键拒绝，属于正常结果
+            LOG_DEBUG("MySQL 唯一键冲突[%d]: %s", id, mysql_stmt_error(stmt));
+            return nullptr;
+        }
+        LOG_ERROR("MySQL 执行失败[%d]: %u %s", id, err, mysql_stmt_error(stmt));
+        if (IsConnLost(err)) {
+            // 连接已断，句柄全部作废，下次使用时重新 prepare
+            Reset();
+            connLost_ = true;
+        }
+        return nullptr;
+    }
+    return stmt;
+}
+
+SqlParams::SqlParams() : count_(0) {
+    memset(binds_, 0, sizeof(binds_));
+    memset(lengths_, 0, sizeof(lengths_));
+}
+
+SqlParams& SqlParams::Int(const int& v) {
+    assert(count_ < MAX_PARAMS);
+    MYSQL_BIND& b = binds_[count_++];
+    b.buffer_type = MYSQL_TYPE_LONG;
+    b.buffer = const_cast<int*>(&v);
+    return *this;
+}
+
+SqlParams& SqlParams::Int64(const long long& v) {
+    assert(count_ < MAX_PARAMS);
+    MYSQL_BIND& b = binds_[count_++];
+    b.buffer_type = MYSQL_TYPE_LONGLONG;
+    b.buffer = const_cast<long long*>(&v);
+    return *this;
+}
+
+SqlParams& SqlParams::Str(const std::string& s) {
+    assert(count_ < MAX_PARAMS);
+    lengths_[count_] = s.size();
+    MYSQL_BIND& b = binds_[count_];
+    b.buffer_type = MYSQL_TYPE_STRING;
+    b.buffer = const_cast<char*>(s.data());
+    b.buffer_length = s.size();
+    b.length = &lengths_[count_];
+    count_++;
+    return *this;
+}
+
+SqlRow& SqlRow::Int(int* out) {
+    cols_.push_back({MYSQL_TYPE_LONG, out, {}, 0, false, false});
+    return *this;
+}
+
+SqlRow& SqlRow::Int64(long long* out) {
+    cols_.push_back({MYSQL_TYPE_LONGLONG, out, {}, 0, false, false});
+    return *this;
+}
+
+SqlRow& SqlRow::Str(std::string* out, size_t cap) {
+    cols_.push_back({MYSQL_TYPE_STRING, out, std::vector<char>(cap), 0, false, false});
+    return *this;
+}
+
+bool SqlRow::Bind() {
+    binds_.assign(cols_.size(), MYSQL_BIND());
+    for (size_t i = 0; i < cols_.size(); i++) {
+        Column& col = cols_[i];
+        MYSQL_BIND& b = binds_[i];
+        memset(&b, 0, sizeof(b));
+        b.buffer_type = col.type;
+        if (col.type == MYSQL_TYPE_STRING) {
+            b.buffer = col.buf.data();
+            b.buffer_length = col.buf.size();
+        } else {
+            b.buffer = col.out;
+        }
+        b.length = &col.length;
+        b.is_null = &col.isNull;
+        b.error = &col.error;
+    }
+    if (mysql_stmt_bind_result(stmt_, binds_.data()) != 0) {
+        LOG_ERROR("MySQL 结果绑定失败: %s", mysql_stmt_error(stmt_));
+        return false;
+    }
+    return true;
+}
+
+bool SqlRow::Fetch() {
+    int ret = mysql_stmt_fetch(stmt_);
+    if (ret == MYSQL_NO_DATA) return false;
+    if (ret == 1) {
+        LOG_ERROR("MySQL 读取结果失败: %s", mysql_stmt_error(stmt_));
+        return false;
+    }
+    bool rebind = false;
+    for (size_t i = 0; i < cols_.size(); i++) {
+        Column& col = cols_[i];
+        if (col.type != MYSQL_TYPE_STRING) {
+            if (col.isNull) {
+                if (col.type == MYSQL_TYPE_LONG) { *static_cast<int*>(col.out) = 0; }
+                else { *static_cast<long long*>(col.out) = 0; }
+            }
+            continue;
+        }
+        std::string* out = static_cast<std::string*>(col.out);
+        if (col.isNull) {
+            out->clear();
+            continue;
+        }
+        if (col.length > col.buf.size()) {
+            // 缓冲区不够：按实际长度扩容后单独再取这一列，后续行使用新缓冲区
+            col.buf.resize(col.length);
+            MYSQL_BIND b;
+            memset(&b, 0, sizeof(b));
+            b.buffer_type = MYSQL_TYPE_STRING;
+            b.buffer = col.buf.data();
+            b.buffer_length = col.buf.size();
+            mysql_stmt_fetch_column(stmt_, &b, i, 0);
+            rebind = true;
+        }
+        out->assign(col.buf.data(), col.length);
+    }
+    if (rebind) { Bind(); }
+    return true;
+}
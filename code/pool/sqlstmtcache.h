@@ -0,0 +1,122 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-06-30
+ * @Description  : 每个池化 MySQL 连接上的预处理语句缓存，以及参数/结果绑定的辅助类
+ */
+#ifndef SQLSTMTCACHE_H
+#define SQLSTMTCACHE_H
+
+#include <mysql/mysql.h>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "../log/log.h"
+
+/* 语句编号，SQL 文本集中定义在 sqlstmtcache.cpp 的 SQL_TEXT 中 */
+enum StmtId {
+    STMT_USER_EXISTS = 0,
+    STMT_USER_GET_HASH,
+    STMT_USER_INSERT,
+    STMT_USER_NAMES,
+    STMT_FILE_INSERT,
+    STMT_FILE_DELETE_ID,
+    STMT_FILE_LIST,
+    STMT_FILE_STORED_NAMES,
+    STMT_FILE_PAGE_FIRST,
+    STMT_FILE_PAGE_AFTER,
+    STMT_FILE_FIND,
+    STMT_FILE_GET,
+    STMT_BLOB_ADDREF,
+    STMT_BLOB_RELEASE,
+    STMT_BLOB_GARBAGE,
+    STMT_BLOB_REMOVE,
+    STMT_FILE_LEGACY,
+    STMT_FILE_ATTACH,
+    STMT_FILE_USAGE,
+    STMT_COUNT
+};
+
+/*
+ * 语句在第一次使用时才 prepare，之后一直挂在连接上复用。
+ * 记录 prepare 时的 mysql_thread_id，连接被重建后 id 变化，旧句柄全部作废并重新 prepare。
+ */
+class SqlStmtCache {
+public:
+    explicit SqlStmtCache(MYSQL* sql);
+    ~SqlStmtCache();
+
+    MYSQL_STMT* Get(StmtId id);
+    // 绑定参数并执行，成功返回语句句柄；params 可以为 nullptr
+    MYSQL_STMT* Execute(StmtId id, MYSQL_BIND* params);
+
+    void Rebind(MYSQL* sql);   // 连接句柄被替换后调用
+    void Reset();              // 关闭全部语句句柄
+    bool ConnLost() const { return connLost_; }  // 执行时发现连接已断，归还时由连接池重建
+
+    static bool IsConnLost(unsigned int err);
+
+private:
+    MYSQL* sql_;
+    unsigned long threadId_;
+    bool connLost_;
+    MYSQL_STMT* stmts_[STMT_COUNT];
+
+    static const char* const SQL_TEXT[STMT_COUNT];
+};
+
+/* 输入参数绑定，引用调用方变量，执行完成前变量必须有效 */
+class SqlParams {
+public:
+    SqlParams();
+
+    SqlParams& Int(const int& v);
+    SqlParams& Int64(const long long& v);
+    SqlParams& Str(const std::string& s);
+
+    MYSQL_BIND* Binds() { return count_ ? binds_ : nullptr; }
+
+private:
+    static const int MAX_PARAMS = 16;
+    MYSQL_BIND binds_[MAX_PARAMS];
+    unsigned long lengths_[MAX_PARAMS];
+    int count_;
+};
+
+/* 结果列绑定，字符串列超出缓冲区时自动按实际长度重新读取 */
+class SqlRow {
+public:
+    explicit SqlRow(MYSQL_STMT* stmt) : stmt_(stmt) {}
+
+    SqlRow& Int(int* out);
+    SqlRow& Int64(long long* out);
+    SqlRow& Str(std::string* out, size_t cap = 256);
+
+    bool Bind();
+    // 读取下一行：true 表示读到一行，false 表示结束或出错
+    bool Fetch();
+
+private:
+    struct Column {
+        enum_field_types type;
+        void* out;
+        std::vector<char> buf;
+        unsigned long length;
+        bool isNull;
+        bool error;
+    };
+
+    MYSQL_STMT* stmt_;
+    std::vector<Column> cols_;
+    std::vector<MYSQL_BIND> binds_;
+};
+
+/* 语句用完后释放结果集，保证下次 execute 前句柄是干净的 */
+class SqlStmtGuard {
+public:
+    explicit SqlStmtGuard(MYSQL_STMT* stmt) : stmt_(stmt) {}
+    ~SqlStmtGuard() { if (stmt_) { mysql_stmt_free_result(stmt_); } }
+private:
+    MYSQL_STMT* stmt_;
+};
+
+#endif //SQLSTMTCACHE_H
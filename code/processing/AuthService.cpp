@@ -8,43 +8,38 @@
 
  #include "../processing/AuthService.h"
  #include "../processing/UserService.h"
+ #include "../processing/RedisSessionManager .h"
  #include <bcrypt/BCrypt.hpp>
- #include <random>
- 
- AuthService::AuthService(std::shared_ptr<sw::redis::Redis> redis)
-     : redis_(redis) {}
  
  bool AuthService::Login(const std::string& username, const std::string& password, std::string& token, int& userID) {
      std::string hash;
      if (!UserService::GetUserPasswordHash(username, hash, userID)) return false;
+     return FinishLogin(password, hash, userID, token);
+ }
+
+ bool AuthService::FinishLogin(const std::string& password, const std::string& hash, int userID, std::string& token) {
      if (!BCrypt::validatePassword(password, hash)) return false;
-     token = GenerateToken();
-     redis_->setex("session:" + token, 3600, std::to_string(userID));
-     return true;
+     token = RedisSessionManager::Instance()->CreateSession(userID);
+     return !token.empty();
+ }
+
+ std::string AuthService::HashPassword(const std::string& password) {
+     return BCrypt::generateHash(password);
+ }
+
+ bool AuthService::RegisterHashed(const std::string& username, const std::string& hash, int& userID) {
+     return UserService::InsertNewUser(username, hash, userID); // 单条 INSERT，重复用户名由唯一键拒绝
  }
  
  bool AuthService::Register(const std::string& username, const std::string& password, int& userID) {
-     if (UserService::UserExists(username)) return false;
      std::string hash = BCrypt::generateHash(password);
      return UserService::InsertNewUser(username, hash, userID);
  }
  
  bool AuthService::VerifyToken(const std::string& token, int& userID) {
-     auto val = redis_->get("session:" + token);
-     if (!val) return false;
-     userID = std::stoi(*val);
+     // 经过进程内会话缓存，大部分请求不会访问 Redis
+     auto id = RedisSessionManager::Instance()->GetUserID(token);
+     if (!id) return false;
+     userID = *id;
      return true;
  }
- 
- std::string AuthService::GenerateToken(int length) {
-     static const char charset[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
-     std::random_device rd;
-     std::mt19937 gen(rd());
-     std::uniform_int_distribution<> dist(0, sizeof(charset) - 2);
-     std::string token;
-     for (int i = 0; i < length; ++i) {
-         token += charset[dist(gen)];
-     }
-     return token;
- }
- 
\ No newline at end of file
@@ -12,13 +12,15 @@
 
  class AuthService {
     public:
-        AuthService(std::shared_ptr<sw::redis::Redis> redis);
+        AuthService() = default;
     
         bool Login(const std::string& username, const std::string& password, std::string& token, int& userID);
         bool Register(const std::string& username, const std::string& password, int& userID);
         bool VerifyToken(const std::string& token, int& userID);
+
+        // 拆开的两段，异步路径上数据库部分在 DB 线程执行，bcrypt 和建会话在工作线程执行
+        bool FinishLogin(const std::string& password, const std::string& hash, int userID, std::string& token);
+        static std::string HashPassword(const std::string& password);
+        bool RegisterHashed(const std::string& username, const std::string& hash, int& userID);
     
-    private:
-        std::shared_ptr<sw::redis::Redis> redis_;
-        std::string GenerateToken(int length = 32);
     };
\ No newline at end of file
@@ -0,0 +1,445 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-11 15:05:22
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-11 15:05:22
+ * @Description: 按内容寻址的上传文件存储，相同内容只存一份，引用归零后后台回收
+ */
+#include "BlobStore.h"
+#include "MetaStore.h"
+#include "FileReclaimer.h"
+#include "UserQuota.h"
+#include "FileSearchIndex.h"
+#include "../config/config.h"
+#include "../log/log.h"
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <vector>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+BlobWriter::BlobWriter() : fd_(-1), ctx_(nullptr), size_(0), unhashed_(false), hashPipe_{-1, -1} {}
+
+BlobWriter::~BlobWriter() {
+    if (fd_ >= 0) { close(fd_); }
+    if (hashPipe_[0] >= 0) { close(hashPipe_[0]); }
+    if (hashPipe_[1] >= 0) { close(hashPipe_[1]); }
+    if (!tmpPath_.empty()) { unlink(tmpPath_.c_str()); }
+    if (ctx_) { EVP_MD_CTX_free(ctx_); }
+}
+
+bool BlobWriter::Open() {
+    std::string tmpl = BlobStore::Instance()->TempDir() + "/upload.XXXXXX";
+    std::vector<char> path(tmpl.begin(), tmpl.end());
+    path.push_back('\0');
+    fd_ = mkstemp(path.data());
+    if (fd_ < 0) {
+        LOG_ERROR("BlobWriter: mkstemp %s failed: %s", tmpl.c_str(), strerror(errno));
+        return false;
+    }
+    tmpPath_ = path.data();
+    fchmod(fd_, 0644);   // mkstemp 建的是 0600，静态文件发送路径要求其他用户可读
+    ctx_ = EVP_MD_CTX_new();
+    return ctx_ && EVP_DigestInit_ex(ctx_, EVP_sha256(), nullptr) == 1;
+}
+
+bool BlobWriter::Write(const char* data, size_t len) {
+    if (fd_ < 0) return false;
+    EVP_DigestUpdate(ctx_, data, len);   // 摘要和写盘同一遍完成，不用再读一次文件
+    size_ += len;
+    while (len > 0) {
+        ssize_t n = ::write(fd_, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("BlobWriter: write %s failed: %s", tmpPath_.c_str(), strerror(errno));
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool BlobWriter::Sync() {
+    if (fd_ < 0) return false;
+    if (fdatasync(fd_) != 0) {
+        LOG_ERROR("BlobWriter: fdatasync %s failed: %s", tmpPath_.c_str(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool BlobWriter::Reserve(long long len) {
+    if (fd_ < 0 || len <= 0) return fd_ >= 0;
+    if (fallocate(fd_, 0, 0, len) == 0) return true;
+    if (errno == EOPNOTSUPP) return true;   // 文件系统不支持预分配，边写边分配
+    LOG_WARN("BlobWriter: fallocate %s %lld failed: %s", tmpPath_.c_str(), len, strerror(errno));
+    return false;
+}
+
+bool BlobWriter::OpenHashPipe_() {
+    if (hashPipe_[0] >= 0) return true;
+    if (pipe2(hashPipe_, O_CLOEXEC) != 0) {
+        hashPipe_[0] = hashPipe_[1] = -1;
+        return false;
+    }
+    fcntl(hashPipe_[1], F_SETPIPE_SZ, 1 << 20);   // 和请求体管道一样大，一次 tee 能带走整段
+    hashBuf_.resize(1 << 16);
+    return true;
+}
+
+bool BlobWriter::DrainHashPipe_(size_t len) {
+    while (len > 0) {
+        ssize_t n = ::read(hashPipe_[0], hashBuf_.data(), std::min(len, hashBuf_.size()));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("BlobWriter: read hash pipe failed: %s", strerror(errno));
+            return false;
+        }
+        if (n == 0) return false;
+        EVP_DigestUpdate(ctx_, hashBuf_.data(), n);
+        len -= n;
+    }
+    return true;
+}
+
+bool BlobWriter::SpliceFrom(int pipeFd, size_t len) {
+    if (fd_ < 0) return false;
+    // tee 只复制页面引用；摘要随请求体一段段算完，Finish 时不用在 DB 线程上把几个 GB 的文件再读一遍
+    bool teeing = !unhashed_ && OpenHashPipe_();
+    if (!teeing && !unhashed_) {
+        LOG_WARN("BlobWriter: no hash pipe for %s, hashing after upload", tmpPath_.c_str());
+    }
+    unhashed_ = !teeing;
+    while (len > 0) {
+        size_t chunk = len;
+        if (teeing) {
+            ssize_t t = tee(pipeFd, hashPipe_[1], len, 0);
+            if (t < 0) {
+                if (errno == EINTR) continue;
+                LOG_ERROR("BlobWriter: tee for %s failed: %s", tmpPath_.c_str(), strerror(errno));
+                return false;
+            }
+            if (t == 0) return false;
+            chunk = t;
+        }
+        // 只搬 tee 过的这一段，文件和摘要看到的是同样的字节
+        size_t left = chunk;
+        while (left > 0) {
+            ssize_t n = splice(pipeFd, nullptr, fd_, nullptr, left, SPLICE_F_MOVE);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                LOG_ERROR("BlobWriter: splice into %s failed: %s", tmpPath_.c_str(), strerror(errno));
+                return false;
+            }
+            if (n == 0) return false;
+            size_ += n;
+            left -= n;
+        }
+        if (teeing && !DrainHashPipe_(chunk)) return false;
+        len -= chunk;
+    }
+    return true;
+}
+
+bool BlobWriter::HashFile_() {
+    if (EVP_DigestInit_ex(ctx_, EVP_sha256(), nullptr) != 1) return false;
+    std::vector<char> buf(1 << 16);
+    off_t offset = 0;
+    while (true) {
+        ssize_t n = pread(fd_, buf.data(), buf.size(), offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("BlobWriter: read %s failed: %s", tmpPath_.c_str(), strerror(errno));
+            return false;
+        }
+        if (n == 0) break;
+        EVP_DigestUpdate(ctx_, buf.data(), n);
+        offset += n;
+    }
+    size_ = offset;
+    return true;
+}
+
+bool BlobWriter::Adopt(const std::string& path) {
+    if (fd_ >= 0) return false;
+    std::string link = BlobStore::Instance()->TempDir() + "/" + std::filesystem::path(path).filename().string() + ".adopt";
+    unlink(link.c_str());   // 上次入库失败留下的
+    if (::link(path.c_str(), link.c_str()) != 0) {
+        LOG_ERROR("BlobWriter: link %s -> %s failed: %s", path.c_str(), link.c_str(), strerror(errno));
+        return false;
+    }
+    tmpPath_ = link;
+    fd_ = open(link.c_str(), O_RDONLY);
+    ctx_ = EVP_MD_CTX_new();
+    if (fd_ < 0 || !ctx_) return false;
+    fchmod(fd_, 0644);
+    return HashFile_();
+}
+
+bool BlobWriter::Finish(std::string& hash) {
+    if (fd_ < 0) return false;
+    if (unhashed_ && !HashFile_()) return false;
+    close(fd_);
+    fd_ = -1;
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int mdLen = 0;
+    if (EVP_DigestFinal_ex(ctx_, md, &mdLen) != 1) return false;
+    static const char HEX[] = "0123456789abcdef";
+    hash.resize(mdLen * 2);
+    for (unsigned int i = 0; i < mdLen; i++) {
+        hash[i * 2] = HEX[md[i] >> 4];
+        hash[i * 2 + 1] = HEX[md[i] & 0xf];
+    }
+    return true;
+}
+
+BlobStore::BlobStore()
+    : root_(Config::uploadRoot), blobDir_(root_ + "/blobs"), tmpDir_(root_ + "/tmp"),
+      isClose_(true), pending_(false),
+      stored_(0), dedupHits_(0), bytesSaved_(0), reclaimed_(0), reclaimFailures_(0),
+      fileSyncs_(0), groupSyncs_(0) {
+    std::error_code ec;
+    std::filesystem::create_directories(blobDir_, ec);
+    std::filesystem::create_directories(tmpDir_, ec);
+    if (ec) { LOG_ERROR("BlobStore: create %s failed: %s", root_.c_str(), ec.message().c_str()); }
+}
+
+BlobStore::~BlobStore() {
+    Stop();
+}
+
+BlobStore* BlobStore::Instance() {
+    static BlobStore store;
+    return &store;
+}
+
+void BlobStore::Start() {
+    std::lock_guard<std::mutex> locker(loopMtx_);
+    if (!isClose_) return;
+    isClose_ = false;
+    pending_ = true;   // 启动时先清一遍上次退出前没来得及回收的
+    reclaimThread_ = std::thread(&BlobStore::ReclaimLoop_, this);
+}
+
+void BlobStore::Stop() {
+    {
+        std::lock_guard<std::mutex> locker(loopMtx_);
+        if (isClose_) return;
+        isClose_ = true;
+    }
+    loopCond_.notify_all();
+    if (reclaimThread_.joinable()) { reclaimThread_.join(); }
+}
+
+std::string BlobStore::PathFor(const std::string& hash) const {
+    // 两级 256 路扇出，单个目录下的文件数保持在几千以内
+    return blobDir_ + "/" + hash.substr(0, 2) + "/" + hash.substr(2, 2) + "/" + hash;
+}
+
+size_t BlobStore::LockIndex_(const std::string& hash) const {
+    return std::hash<std::string>()(hash) % LOCK_COUNT;
+}
+
+std::mutex& BlobStore::LockFor_(const std::string& hash) {
+    return locks_[LockIndex_(hash)];
+}
+
+bool BlobStore::SyncDir_(const std::string& dir) {
+    // rename 只改目录项，要让新名字掉电后还在得 fsync 目录本身
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    fileSyncs_++;
+    if (!ok) { LOG_ERROR("BlobStore: fsync dir %s failed: %s", dir.c_str(), strerror(errno)); }
+    return ok;
+}
+
+bool BlobStore::SyncFs_() {
+    // 临时目录和 blob 目录在同一个文件系统上，一次 syncfs 刷掉整批文件的数据和目录项
+    int fd = open(blobDir_.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    bool ok = syncfs(fd) == 0;
+    close(fd);
+    groupSyncs_++;
+    if (!ok) { LOG_ERROR("BlobStore: syncfs %s failed: %s", blobDir_.c_str(), strerror(errno)); }
+    return ok;
+}
+
+bool BlobStore::Commit(BlobWriter& writer, UploadedFileInfo& info) {
+    std::vector<BlobCommit> batch(1);
+    batch[0].writer = &writer;
+    batch[0].info = info;
+    CommitBatch(batch, Config::uploadFsync);
+    info = batch[0].info;
+    return batch[0].ok;
+}
+
+size_t BlobStore::CommitBatch(std::vector<BlobCommit>& batch, FsyncPolicy policy) {
+    // 只有一个文件时整批同步不划算，按单文件处理
+    bool group = policy == FsyncPolicy::GROUP && batch.size() > 1;
+    bool perFile = policy == FsyncPolicy::PER_FILE || (policy == FsyncPolicy::GROUP && batch.size() == 1);
+    std::vector<std::string> hashes(batch.size());
+    std::vector<bool> ready(batch.size(), false);
+
+    // 1. 数据先落盘再 rename，否则掉电后 blob 路径上可能是不完整的内容，之后同样内容的上传还会去重到它
+    for (size_t i = 0; i < batch.size(); i++) {
+        BlobCommit& item = batch[i];
+        item.ok = false;
+        if (!item.writer) continue;
+        if (perFile) {
+            fileSyncs_++;
+            if (!item.writer->Sync()) continue;
+        }
+        ready[i] = item.writer->Finish(hashes[i]);
+    }
+    if (group && !SyncFs_()) return 0;
+
+    // 2. 按编号从小到大拿齐涉及的分段锁，和回收线程互斥，也不会和别的批次互相等待
+    std::vector<size_t> indexes;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (ready[i]) indexes.push_back(LockIndex_(hashes[i]));
+    }
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+    std::vector<std::unique_lock<std::mutex>> held;
+    for (size_t index : indexes) {
+        held.emplace_back(locks_[index]);
+    }
+
+    // 3. 放到内容地址上
+    std::vector<bool> created(batch.size(), false);
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (!ready[i]) continue;
+        BlobCommit& item = batch[i];
+        BlobWriter& writer = *item.writer;
+        std::string path = PathFor(hashes[i]);
+        item.info.content_hash = hashes[i];
+        item.info.file_path = path;
+        item.info.file_size = writer.Size();
+
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0) {
+            // 内容已经在了，丢掉临时文件，只加引用
+            unlink(writer.tmpPath_.c_str());
+            dedupHits_++;
+            bytesSaved_ += writer.Size();
+        } else {
+            std::string dir = std::filesystem::path(path).parent_path().string();
+            std::error_code ec;
+            std::filesystem::create_directories(dir, ec);
+            if (rename(writer.tmpPath_.c_str(), path.c_str()) != 0) {
+                LOG_ERROR("BlobStore: rename to %s failed: %s", path.c_str(), strerror(errno));
+                ready[i] = false;
+                continue;
+            }
+            created[i] = true;
+            stored_++;
+            if (perFile && !SyncDir_(dir)) {
+                unlink(path.c_str());
+                writer.tmpPath_.clear();
+                ready[i] = false;
+                continue;
+            }
+        }
+        writer.tmpPath_.clear();
+    }
+    if (group && !SyncFs_()) {
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (created[i]) { unlink(batch[i].info.file_path.c_str()); }
+        }
+        return 0;
+    }
+
+    // 4. 文件已经落盘，最后才插入上传记录
+    size_t committed = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (!ready[i]) continue;
+        BlobCommit& item = batch[i];
+        bool recorded = item.attachId ? MetaStore::Instance()->AttachBlob(item.attachId, item.info)
+                                      : MetaStore::Instance()->InsertFile(item.info);
+        if (recorded) {
+            item.ok = true;
+            committed++;
+            // 迁移挂上的旧记录启动时已经计入
+            if (!item.attachId) {
+                UserQuota::Instance()->Add(item.info.uploader_id, item.info.file_size);
+                FileSearchIndex::Instance()->Add(item.info);
+            }
+        } else if (created[i]) {
+            unlink(item.info.file_path.c_str());  // 刚放进去的文件没有任何记录引用
+        }
+    }
+    return committed;
+}
+
+void BlobStore::NotifyGarbage() {
+    {
+        std::lock_guard<std::mutex> locker(loopMtx_);
+        pending_ = true;
+    }
+    loopCond_.notify_one();
+}
+
+size_t BlobStore::ReclaimOnce() {
+    std::vector<std::string> hashes;
+    if (!MetaStore::Instance()->ListGarbageBlobs(Config::blobReclaimBatch, hashes)) {
+        reclaimFailures_++;
+        return 0;
+    }
+    size_t removed = 0;
+    for (const std::string& hash : hashes) {
+        // 持锁期间没人能重新引用这份内容。先把文件移进回收目录再删记录：
+        // 删记录失败就移回来；移走之后进程退出，记录下一轮照样删，文件由回收目录启动时清掉
+        std::lock_guard<std::mutex> locker(LockFor_(hash));
+        std::string path = PathFor(hash);
+        std::string staged;
+        if (!FileReclaimer::Instance()->Stage(path, staged)) {
+            reclaimFailures_++;
+            continue;
+        }
+        if (!MetaStore::Instance()->RemoveBlob(hash)) {
+            if (!staged.empty() && rename(staged.c_str(), path.c_str()) != 0) {
+                LOG_WARN("BlobStore: restore %s failed: %s", path.c_str(), strerror(errno));
+            }
+            continue;
+        }
+        FileReclaimer::Instance()->Release(staged);   // 大文件的释放交给回收线程限速进行
+        removed++;
+    }
+    reclaimed_ += removed;
+    if (removed > 0) { LOG_DEBUG("BlobStore: reclaimed %zu blobs", removed); }
+    return removed;
+}
+
+void BlobStore::ReclaimLoop_() {
+    std::unique_lock<std::mutex> locker(loopMtx_);
+    while (!isClose_) {
+        loopCond_.wait_for(locker, std::chrono::milliseconds(Config::blobReclaimIntervalMs),
+                           [this] { return isClose_ || pending_; });
+        if (isClose_) break;
+        pending_ = false;
+        locker.unlock();
+        // 一批删满说明还有剩余，接着删
+        while (ReclaimOnce() == static_cast<size_t>(Config::blobReclaimBatch)) {}
+        locker.lock();
+    }
+}
+
+BlobStoreStats BlobStore::GetStats() const {
+    BlobStoreStats stats;
+    stats.stored = stored_;
+    stats.dedupHits = dedupHits_;
+    stats.bytesSaved = bytesSaved_;
+    stats.reclaimed = reclaimed_;
+    stats.reclaimFailures = reclaimFailures_;
+    stats.fileSyncs = fileSyncs_;
+    stats.groupSyncs = groupSyncs_;
+    return stats;
+}
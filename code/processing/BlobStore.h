@@ -0,0 +1,131 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-11 15:05:22
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-11 15:05:22
+ * @Description: 按内容寻址的上传文件存储，相同内容只存一份，引用归零后后台回收
+ */
+#pragma once
+#include <string>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <condition_variable>
+#include <openssl/evp.h>
+#include "uploaded_file.h"
+#include "../config/config.h"
+
+struct BlobStoreStats {
+    uint64_t stored;          // 新写入的 blob
+    uint64_t dedupHits;       // 内容已存在，只加引用
+    uint64_t bytesSaved;      // 去重省下的写入字节数
+    uint64_t reclaimed;       // 后台回收的 blob
+    uint64_t reclaimFailures;
+    uint64_t fileSyncs;       // 单个文件/目录的 fsync 次数
+    uint64_t groupSyncs;      // 整批 syncfs 次数
+};
+
+/* 边写边算 SHA-256 的临时文件，没有交给 BlobStore 的临时文件在析构时删除 */
+class BlobWriter {
+public:
+    BlobWriter();
+    ~BlobWriter();
+
+    bool Open();
+    bool Write(const char* data, size_t len);
+    // fdatasync，必须在 Finish 之前调用
+    bool Sync();
+    // 按最终长度预分配磁盘空间，空间不足时返回 false 且 errno 为 ENOSPC
+    bool Reserve(long long len);
+    // 从管道 splice 进文件；同一批页面 tee 到另一条管道读出来算摘要，不落盘后再读回
+    bool SpliceFrom(int pipeFd, size_t len);
+    // 接管一个已经写好的文件：硬链接进临时目录并读一遍算摘要，失败或去重时原文件都保留
+    bool Adopt(const std::string& path);
+    // 关闭文件并输出十六进制摘要，之后只能交给 BlobStore::Commit
+    bool Finish(std::string& hash);
+
+    long long Size() const { return size_; }
+
+private:
+    friend class BlobStore;
+
+    bool HashFile_();   // 从头读一遍文件重新计算摘要
+    bool OpenHashPipe_();
+    bool DrainHashPipe_(size_t len);
+
+    int fd_;
+    std::string tmpPath_;
+    EVP_MD_CTX* ctx_;
+    long long size_;
+    bool unhashed_;     // 有内容没算进摘要（tee 不可用时），摘要要在 Finish 时补算
+    int hashPipe_[2];   // SpliceFrom 用：tee 出来的数据从这里读出算摘要
+    std::vector<char> hashBuf_;
+};
+
+/* CommitBatch 的一项：调用方填 writer 和 info 中的文件名、类型、上传者，其余由 BlobStore 填写 */
+struct BlobCommit {
+    BlobWriter* writer = nullptr;
+    UploadedFileInfo info;
+    int attachId = 0;   // 非 0 时不插新记录，而是把内容挂到这条已有的旧记录上（迁移用）
+    bool ok = false;
+};
+
+/*
+ * 文件按摘要放在 uploadRoot/blobs/ab/cd/<sha256>，上传记录通过 content_hash 引用，
+ * blobs 表记录每份内容的引用数。同一摘要的“放文件 + 加引用”和“删记录 + 删文件”
+ * 用同一把分段锁串行，回收线程不会删掉刚被重新引用的内容（只适用于单进程写同一个存储目录）。
+ */
+class BlobStore {
+public:
+    static BlobStore* Instance();
+
+    void Start();   // 启动后台回收线程
+    void Stop();
+
+    std::string PathFor(const std::string& hash) const;
+    const std::string& TempDir() const { return tmpDir_; }
+
+    // 把写完的临时文件放到内容地址上并插入上传记录（info 中的路径、大小、摘要由这里填写），按 Config::uploadFsync 落盘
+    bool Commit(BlobWriter& writer, UploadedFileInfo& info);
+    // 一批文件一起入库：数据落盘 -> rename -> 目录落盘 -> 上传记录，GROUP 策略下每一步整批只同步一次。
+    // 返回成功的项数，每项的结果在 ok 中
+    size_t CommitBatch(std::vector<BlobCommit>& batch, FsyncPolicy policy);
+    // 有引用归零时调用，提前唤醒回收线程
+    void NotifyGarbage();
+    // 回收一批引用归零的 blob，返回删除的数量
+    size_t ReclaimOnce();
+
+    BlobStoreStats GetStats() const;
+
+private:
+    BlobStore();
+    ~BlobStore();
+
+    size_t LockIndex_(const std::string& hash) const;
+    std::mutex& LockFor_(const std::string& hash);
+    bool SyncDir_(const std::string& dir);
+    bool SyncFs_();
+    void ReclaimLoop_();
+
+    static const int LOCK_COUNT = 64;
+
+    std::string root_;
+    std::string blobDir_;
+    std::string tmpDir_;
+    std::mutex locks_[LOCK_COUNT];
+
+    std::mutex loopMtx_;
+    std::condition_variable loopCond_;
+    bool isClose_;
+    bool pending_;
+    std::thread reclaimThread_;
+
+    std::atomic<uint64_t> stored_;
+    std::atomic<uint64_t> dedupHits_;
+    std::atomic<uint64_t> bytesSaved_;
+    std::atomic<uint64_t> reclaimed_;
+    std::atomic<uint64_t> reclaimFailures_;
+    std::atomic<uint64_t> fileSyncs_;
+    std::atomic<uint64_t> groupSyncs_;
+};
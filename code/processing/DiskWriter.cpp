@@ -0,0 +1,149 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-15 20:16:43
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-15 20:16:43
+ * @Description: 上传写盘线程：有界队列，临时文件按策略落盘、rename 之后才插入上传记录
+ */
+#include "DiskWriter.h"
+#include "BlobStore.h"
+#include "uploadservice.h"
+#include "FileListCache.h"
+#include "../pool/dbexecutor.h"
+#include "../config/config.h"
+#include "../log/log.h"
+#include <algorithm>
+
+DiskWriter::DiskWriter()
+    : maxQueue_(0), peakQueued_(0), maxBatch_(0), isClosed_(true),
+      submitted_(0), completed_(0), failed_(0), rejected_(0), batches_(0) {}
+
+DiskWriter::~DiskWriter() {
+    Stop();
+}
+
+DiskWriter* DiskWriter::Instance() {
+    static DiskWriter writer;
+    return &writer;
+}
+
+void DiskWriter::Start(int threadCount, size_t maxQueue) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (!isClosed_) return;
+    maxQueue_ = maxQueue;
+    isClosed_ = false;
+    for (int i = 0; i < std::max(1, threadCount); i++) {
+        threads_.emplace_back(&DiskWriter::Loop_, this);
+    }
+    LOG_INFO("DiskWriter: %d threads, queue %zu, batch %d", (int)threads_.size(), maxQueue_, Config::diskWriterBatchMax);
+}
+
+void DiskWriter::Stop() {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (isClosed_) return;
+        isClosed_ = true;
+    }
+    cond_.notify_all();
+    for (auto& t : threads_) {
+        if (t.joinable()) { t.join(); }
+    }
+    threads_.clear();
+}
+
+bool DiskWriter::Submit(std::shared_ptr<const UploadedFile> file, int userId,
+                        std::shared_ptr<DiskWriteResult> result, std::function<void()> done) {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (isClosed_ || jobs_.size() >= maxQueue_) {
+            rejected_++;
+            return false;
+        }
+        jobs_.push_back(Job{std::move(file), userId, std::move(result), std::move(done)});
+        peakQueued_ = std::max(peakQueued_, jobs_.size());
+    }
+    submitted_++;
+    cond_.notify_one();
+    return true;
+}
+
+void DiskWriter::WriteNow(const UploadedFile& file, int userId, DiskWriteResult& result) {
+    // 不拷贝内容，借用调用方的对象
+    std::vector<Job> jobs(1);
+    jobs[0].file = std::shared_ptr<const UploadedFile>(&file, [](const UploadedFile*) {});
+    jobs[0].userId = userId;
+    jobs[0].result = std::shared_ptr<DiskWriteResult>(&result, [](DiskWriteResult*) {});
+    WriteBatch_(jobs);
+}
+
+void DiskWriter::WriteBatch_(std::vector<Job>& jobs) {
+    std::vector<std::unique_ptr<BlobWriter>> writers(jobs.size());
+    std::vector<BlobCommit> batch(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const UploadedFile& file = *jobs[i].file;
+        batch[i].info = UploadService::MakeInfo(file.filename, file.contentType, jobs[i].userId);
+        writers[i] = std::make_unique<BlobWriter>();
+        if (writers[i]->Open() && writers[i]->Write(file.content.data(), file.content.size())) {
+            batch[i].writer = writers[i].get();
+        } else {
+            batch[i].writer = nullptr;   // CommitBatch 跳过，这一项按失败返回
+        }
+    }
+
+    BlobStore::Instance()->CommitBatch(batch, Config::uploadFsync);
+
+    for (size_t i = 0; i < jobs.size(); i++) {
+        DiskWriteResult& result = *jobs[i].result;
+        result.ok = batch[i].ok;
+        result.durable = batch[i].ok && Config::uploadFsync != FsyncPolicy::NONE;
+        result.hash = batch[i].info.content_hash;
+        FileListCache::Instance()->Invalidate(jobs[i].userId); // 列表已变化，下次查看时重新生成
+    }
+}
+
+void DiskWriter::Loop_() {
+    std::unique_lock<std::mutex> locker(mtx_);
+    while (true) {
+        if (!jobs_.empty()) {
+            // 排在后面的一起带走，共用一次落盘
+            size_t n = std::min(jobs_.size(), static_cast<size_t>(std::max(1, Config::diskWriterBatchMax)));
+            std::vector<Job> jobs;
+            jobs.reserve(n);
+            for (size_t i = 0; i < n; i++) {
+                jobs.push_back(std::move(jobs_.front()));
+                jobs_.pop_front();
+            }
+            maxBatch_ = std::max(maxBatch_, n);
+            locker.unlock();
+
+            WriteBatch_(jobs);
+            batches_++;
+            for (Job& job : jobs) {
+                completed_++;
+                if (!job.result->ok) { failed_++; }
+                DbExecutor::Instance()->Complete(std::move(job.done));
+            }
+
+            locker.lock();
+        }
+        else if (isClosed_) break; // 关闭前把已接收的上传写完
+        else cond_.wait(locker);
+    }
+}
+
+DiskWriterStats DiskWriter::GetStats() {
+    DiskWriterStats stats;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        stats.queued = jobs_.size();
+        stats.peakQueued = peakQueued_;
+        stats.maxBatch = maxBatch_;
+        stats.threads = threads_.size();
+    }
+    stats.submitted = submitted_;
+    stats.completed = completed_;
+    stats.failed = failed_;
+    stats.rejected = rejected_;
+    stats.batches = batches_;
+    return stats;
+}
@@ -0,0 +1,87 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-15 20:16:43
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-15 20:16:43
+ * @Description: 上传写盘线程：有界队列，临时文件按策略落盘、rename 之后才插入上传记录
+ */
+#pragma once
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include "uploaded_file.h"
+
+/* 写盘结果，done 回调里读取 */
+struct DiskWriteResult {
+    bool ok = false;
+    bool durable = false;    // 响应之前文件和目录项已经落盘（Config::uploadFsync 不是 NONE）
+    bool busy = false;       // 队列满，没有写
+    std::string hash;
+};
+
+struct DiskWriterStats {
+    int threads;
+    size_t queued;
+    size_t peakQueued;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t rejected;       // 队列满
+    uint64_t batches;        // 落盘批次数，completed / batches 就是平均每批合并的文件数
+    size_t maxBatch;
+};
+
+/*
+ * 工作线程解析完 multipart 就把内容交给这里，不在磁盘上等：
+ *   写盘线程一次取出队列里最多 Config::diskWriterBatchMax 个上传，全部写进临时文件后
+ *   交给 BlobStore::CommitBatch 统一落盘、rename、插入上传记录；
+ *   完成回调借 DbExecutor 的 eventfd 交回事件循环。
+ * 磁盘慢的时候队列变长，每批合并的文件变多，GROUP 策略下 fsync 次数不随上传数线性增长。
+ */
+class DiskWriter {
+public:
+    static DiskWriter* Instance();
+
+    void Start(int threadCount, size_t maxQueue);
+    void Stop();   // 队列里已接收的上传写完再退出
+    bool IsRunning() const { return !isClosed_; }
+
+    // 返回 false 表示未启动或队列已满，没有接收任务，done 不会被调用
+    bool Submit(std::shared_ptr<const UploadedFile> file, int userId,
+                std::shared_ptr<DiskWriteResult> result, std::function<void()> done);
+    // 在调用线程上写完一个上传，写盘线程没启动时使用
+    static void WriteNow(const UploadedFile& file, int userId, DiskWriteResult& result);
+
+    DiskWriterStats GetStats();
+
+private:
+    DiskWriter();
+    ~DiskWriter();
+
+    struct Job {
+        std::shared_ptr<const UploadedFile> file;
+        int userId;
+        std::shared_ptr<DiskWriteResult> result;
+        std::function<void()> done;
+    };
+
+    void Loop_();
+    static void WriteBatch_(std::vector<Job>& jobs);
+
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    std::deque<Job> jobs_;
+    size_t maxQueue_;
+    size_t peakQueued_;
+    size_t maxBatch_;
+
+    std::vector<std::thread> threads_;
+    std::atomic<bool> isClosed_;
+
+    std::atomic<uint64_t> submitted_, completed_, failed_, rejected_, batches_;
+};
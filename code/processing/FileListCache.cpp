@@ -0,0 +1,141 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-02 10:12:40
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-02 10:12:40
+ * @Description: 按用户缓存序列化好的文件列表 JSON
+ */
+#include "FileListCache.h"
+#include "../config/config.h"
+#include "../log/log.h"
+#include <cstdio>
+
+FileListCache::FileListCache()
+    : bytes_(0), hits_(0), misses_(0), coalesced_(0), evictions_(0), invalidations_(0), staleRetries_(0) {}
+
+FileListCache* FileListCache::Instance() {
+    static FileListCache cache;
+    return &cache;
+}
+
+std::string FileListCache::MakeETag(const char* data, size_t len) {
+    // FNV-1a 64 位，重启后同样的内容得到同样的 ETag
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+    }
+    char buf[48];
+    snprintf(buf, sizeof(buf), "\"%016llx-%zx\"", (unsigned long long)h, len);
+    return buf;
+}
+
+FileListEntry FileListCache::GetOrLoad(int userId, const Loader& loader) {
+    // 查询期间该用户有写操作时结果已作废：自己查的和搭车等到的都重来，不把写之前的列表当成最新的
+    for (int attempt = 0; ; attempt++) {
+        std::shared_ptr<Flight> flight;
+        {
+            std::unique_lock<std::mutex> locker(mtx_);
+            auto it = entries_.find(userId);
+            if (it != entries_.end()) {
+                lru_.splice(lru_.begin(), lru_, it->second.pos);
+                hits_++;
+                return it->second.entry;
+            }
+            auto fit = inflight_.find(userId);
+            if (fit != inflight_.end() && !fit->second->stale) {
+                flight = fit->second;
+                coalesced_++;
+                cond_.wait(locker, [&flight] { return flight->done; });
+                if (!flight->stale || attempt >= MAX_STALE_RETRIES) return flight->entry;
+                staleRetries_++;
+                continue;
+            }
+            flight = std::make_shared<Flight>();
+            inflight_[userId] = flight;
+            misses_++;
+        }
+
+        FileListEntry entry;
+        std::string json;
+        if (loader(json, entry.nextCursor)) {
+            entry.etag = MakeETag(json);
+            entry.json = std::make_shared<const std::string>(std::move(json));
+        }
+
+        std::lock_guard<std::mutex> locker(mtx_);
+        flight->done = true;
+        flight->entry = entry;
+        auto fit = inflight_.find(userId);
+        if (fit != inflight_.end() && fit->second == flight) {
+            inflight_.erase(fit);
+        }
+        if (entry.json && !flight->stale) {
+            Put_(userId, entry);
+        }
+        cond_.notify_all();
+        // 一直有写操作时不无限重试，最后一次的结果照样返回（只是不进缓存）
+        if (!flight->stale || attempt >= MAX_STALE_RETRIES) return entry;
+        staleRetries_++;
+    }
+}
+
+bool FileListCache::Get(int userId, FileListEntry& entry) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = entries_.find(userId);
+    if (it == entries_.end()) return false;
+    lru_.splice(lru_.begin(), lru_, it->second.pos);
+    hits_++;
+    entry = it->second.entry;
+    return true;
+}
+
+void FileListCache::Put_(int userId, const FileListEntry& entry) {
+    size_t budget = Config::fileListCacheBytes;
+    size_t cost = entry.json->size() + entry.etag.size() + entry.nextCursor.size() + sizeof(Node) + 64;
+    if (cost > budget / 4) return;   // 单个超大列表不缓存，免得把其他用户全挤出去
+
+    auto it = entries_.find(userId);
+    if (it != entries_.end()) { Erase_(it); }
+    lru_.push_front(userId);
+    entries_[userId] = Node{entry, cost, lru_.begin()};
+    bytes_ += cost;
+
+    while (bytes_ > budget && !lru_.empty()) {
+        Erase_(entries_.find(lru_.back()));
+        evictions_++;
+    }
+}
+
+void FileListCache::Erase_(std::unordered_map<int, Node>::iterator it) {
+    bytes_ -= it->second.bytes;
+    lru_.erase(it->second.pos);
+    entries_.erase(it);
+}
+
+void FileListCache::Invalidate(int userId) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = entries_.find(userId);
+    if (it != entries_.end()) { Erase_(it); }
+    auto fit = inflight_.find(userId);
+    if (fit != inflight_.end()) {
+        // 正在进行的查询可能读到写之前的数据，让它作废，之后的请求重新查
+        fit->second->stale = true;
+        inflight_.erase(fit);
+    }
+    invalidations_++;
+}
+
+FileListCacheStats FileListCache::GetStats() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    FileListCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.coalesced = coalesced_;
+    stats.evictions = evictions_;
+    stats.invalidations = invalidations_;
+    stats.staleRetries = staleRetries_;
+    stats.entries = entries_.size();
+    stats.bytes = bytes_;
+    return stats;
+}
@@ -0,0 +1,85 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-02 10:12:40
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-02 10:12:40
+ * @Description: 按用户缓存序列化好的文件列表 JSON，上传/删除时失效
+ */
+#pragma once
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+struct FileListEntry {
+    std::shared_ptr<const std::string> json;   // 为空表示加载失败
+    std::string etag;
+    std::string nextCursor;                    // 还有下一页时的游标
+};
+
+struct FileListCacheStats {
+    uint64_t hits;
+    uint64_t misses;        // 真正回源数据库的次数
+    uint64_t coalesced;     // 并发未命中时搭便车等待别人结果的次数
+    uint64_t evictions;
+    uint64_t invalidations;
+    uint64_t staleRetries;  // 查询期间发生写操作，结果作废后重查的次数
+    size_t entries;
+    size_t bytes;
+};
+
+/*
+ * 列表只在上传和删除时变化，读多写少，直接缓存最终的 JSON 字符串和它的 ETag。
+ * 同一用户并发未命中时只有第一个线程去查库，其余线程等它的结果（single-flight）。
+ * 查询期间该用户上传或删除了文件，这次结果作废：不进缓存，查的和等的线程都重新加载。
+ * 总字节数超过 Config::fileListCacheBytes 时按 LRU 淘汰。
+ */
+class FileListCache {
+public:
+    // 加载第一页：输出 JSON 和下一页游标
+    typedef std::function<bool(std::string&, std::string&)> Loader;
+
+    static FileListCache* Instance();
+
+    FileListEntry GetOrLoad(int userId, const Loader& loader);
+    // 只查缓存，不触发加载
+    bool Get(int userId, FileListEntry& entry);
+    void Invalidate(int userId);
+
+    FileListCacheStats GetStats();
+
+    static std::string MakeETag(const char* data, size_t len);
+    static std::string MakeETag(const std::string& body) { return MakeETag(body.data(), body.size()); }
+
+private:
+    FileListCache();
+    ~FileListCache() = default;
+
+    struct Node {
+        FileListEntry entry;
+        size_t bytes;
+        std::list<int>::iterator pos;
+    };
+
+    struct Flight {
+        bool done = false;
+        bool stale = false;   // 加载期间发生了写操作，结果不能进缓存，也不再让新请求搭车，已经搭车的重新加载
+        FileListEntry entry;
+    };
+
+    void Put_(int userId, const FileListEntry& entry);
+    void Erase_(std::unordered_map<int, Node>::iterator it);
+
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    std::list<int> lru_;                      // 头部最近使用
+    std::unordered_map<int, Node> entries_;
+    std::unordered_map<int, std::shared_ptr<Flight>> inflight_;
+    size_t bytes_;
+
+    uint64_t hits_, misses_, coalesced_, evictions_, invalidations_, staleRetries_;
+    static const int MAX_STALE_RETRIES = 2;
+};
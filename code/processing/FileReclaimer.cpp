@@ -0,0 +1,210 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-17 10:26:51
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-17 10:26:51
+ * @Description: 后台删文件：先 rename 进回收目录，回收线程按字节限速截断、删除，失败的退避重试
+ */
+#include "FileReclaimer.h"
+#include "../config/config.h"
+#include "../log/log.h"
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+FileReclaimer::FileReclaimer()
+    : trashDir_(Config::uploadRoot + "/trash"), isClose_(true),
+      staged_(0), reclaimed_(0), bytes_(0), retries_(0), failures_(0) {
+    // 回收目录里的名字带序号，用启动时刻起步，不会和上次没删完的文件重名
+    seq_ = std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+    std::error_code ec;
+    std::filesystem::create_directories(trashDir_, ec);
+    if (ec) { LOG_ERROR("FileReclaimer: create %s failed: %s", trashDir_.c_str(), ec.message().c_str()); }
+}
+
+FileReclaimer::~FileReclaimer() {
+    Stop();
+}
+
+FileReclaimer* FileReclaimer::Instance() {
+    static FileReclaimer reclaimer;
+    return &reclaimer;
+}
+
+void FileReclaimer::Start() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (!isClose_) return;
+    isClose_ = false;
+    // 上次退出时还没删的，启动后接着删
+    std::error_code ec;
+    auto now = std::chrono::steady_clock::now();
+    for (const auto& it : std::filesystem::directory_iterator(trashDir_, ec)) {
+        queue_.push_back(Entry{it.path().string(), 0, now});
+    }
+    if (!queue_.empty()) { LOG_INFO("FileReclaimer: %zu files left in %s", queue_.size(), trashDir_.c_str()); }
+    thread_ = std::thread(&FileReclaimer::Loop_, this);
+}
+
+void FileReclaimer::Stop() {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (isClose_) return;
+        isClose_ = true;
+    }
+    cond_.notify_all();
+    if (thread_.joinable()) { thread_.join(); }
+}
+
+bool FileReclaimer::Stage(const std::string& path, std::string& staged) {
+    staged = trashDir_ + "/" + std::filesystem::path(path).filename().string() + "." + std::to_string(seq_++);
+    if (rename(path.c_str(), staged.c_str()) == 0) {
+        staged_++;
+        return true;
+    }
+    int err = errno;
+    staged.clear();
+    if (err == ENOENT) return true;
+    if (err != EXDEV) { LOG_WARN("FileReclaimer: rename %s failed: %s", path.c_str(), strerror(err)); }
+    errno = err;
+    return false;
+}
+
+void FileReclaimer::Release(const std::string& staged) {
+    if (staged.empty()) return;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        queue_.push_back(Entry{staged, 0, std::chrono::steady_clock::now()});
+    }
+    cond_.notify_one();
+}
+
+void FileReclaimer::Discard(const std::string& path) {
+    std::string staged;
+    if (Stage(path, staged)) {
+        Release(staged);
+    } else {
+        // 不在同一个文件系统上（如旧布局下的 ./resources/images），只能原地删，重启前没删的不会再被找到
+        Release(path);
+    }
+}
+
+bool FileReclaimer::IsClosing_() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return isClose_;
+}
+
+void FileReclaimer::Pace_(long long bytes) {
+    long long rate = Config::fileReclaimBytesPerSec;
+    if (rate <= 0 || bytes <= 0) return;
+    auto wait = std::chrono::microseconds(bytes * 1000000 / rate);
+    std::unique_lock<std::mutex> locker(mtx_);
+    cond_.wait_for(locker, wait, [this] { return isClose_; });
+}
+
+bool FileReclaimer::Reclaim_(const std::string& path) {
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) return errno == ENOENT;
+    long long size = S_ISREG(st.st_mode) ? st.st_size : 0;
+
+    // 只有最后一个链接才分段截断：还有别的名字指向它时（如续传完成后硬链接进了 blob 存储），截断会毁掉内容
+    long long step = Config::fileReclaimTruncateStep;
+    if (S_ISREG(st.st_mode) && st.st_nlink == 1 && step > 0 && size > step) {
+        int fd = open(path.c_str(), O_WRONLY | O_NOFOLLOW);
+        if (fd >= 0) {
+            long long left = size;
+            while (left > step) {
+                if (IsClosing_()) {
+                    close(fd);
+                    return false;   // 留在回收目录里，下次启动接着截
+                }
+                left -= step;
+                if (ftruncate(fd, left) != 0) break;   // 截不动就直接 unlink
+                Pace_(step);
+            }
+            close(fd);
+        }
+    }
+    if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+        LOG_WARN("FileReclaimer: unlink %s failed: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    // 有别的链接时 unlink 不释放数据，不计入限速
+    if (st.st_nlink == 1) {
+        bytes_ += size;
+        Pace_(std::min(size, step > 0 ? step : size));
+    }
+    reclaimed_++;
+    return true;
+}
+
+void FileReclaimer::Loop_() {
+    std::unique_lock<std::mutex> locker(mtx_);
+    while (!isClose_) {
+        if (queue_.empty()) {
+            cond_.wait(locker);
+            continue;
+        }
+        // 取出已经到重试时间的，最多一批
+        auto now = std::chrono::steady_clock::now();
+        auto earliest = std::chrono::steady_clock::time_point::max();
+        size_t batchMax = static_cast<size_t>(std::max(1, Config::fileReclaimBatch));
+        std::vector<Entry> batch;
+        std::deque<Entry> waiting;
+        for (Entry& entry : queue_) {
+            if (batch.size() < batchMax && entry.nextTry <= now) {
+                batch.push_back(std::move(entry));
+            } else {
+                earliest = std::min(earliest, entry.nextTry);
+                waiting.push_back(std::move(entry));
+            }
+        }
+        queue_.swap(waiting);
+        if (batch.empty()) {
+            cond_.wait_until(locker, earliest);
+            continue;
+        }
+        locker.unlock();
+
+        std::vector<Entry> retry;
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (IsClosing_()) break;
+            Entry& entry = batch[i];
+            if (Reclaim_(entry.path)) continue;
+            if (++entry.attempts >= Config::fileReclaimMaxRetries) {
+                failures_++;
+                LOG_ERROR("FileReclaimer: give up %s after %d attempts", entry.path.c_str(), entry.attempts);
+                continue;
+            }
+            retries_++;
+            // 1s、2s、4s ... 最多一分钟
+            int backoff = std::min(60, 1 << std::min(entry.attempts - 1, 6));
+            entry.nextTry = std::chrono::steady_clock::now() + std::chrono::seconds(backoff);
+            retry.push_back(std::move(entry));
+        }
+
+        locker.lock();
+        for (Entry& entry : retry) {
+            queue_.push_back(std::move(entry));
+        }
+    }
+}
+
+FileReclaimerStats FileReclaimer::GetStats() {
+    FileReclaimerStats stats;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        stats.queued = queue_.size();
+    }
+    stats.staged = staged_;
+    stats.reclaimed = reclaimed_;
+    stats.bytes = bytes_;
+    stats.retries = retries_;
+    stats.failures = failures_;
+    return stats;
+}
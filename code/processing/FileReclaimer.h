@@ -0,0 +1,74 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-17 10:26:51
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-17 10:26:51
+ * @Description: 后台删文件：先 rename 进回收目录，回收线程按字节限速截断、删除，失败的退避重试
+ */
+#pragma once
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+struct FileReclaimerStats {
+    size_t queued;
+    uint64_t staged;      // 移进回收目录的文件数
+    uint64_t reclaimed;   // 实际删掉的文件数
+    uint64_t bytes;       // 释放的字节数
+    uint64_t retries;
+    uint64_t failures;    // 重试用尽，留在回收目录里等下次启动
+};
+
+/*
+ * ext4/XFS 上 unlink 一个几 GB 的文件要释放大量 extent，可能卡住调用线程很久。
+ * 删除路径上只做 rename（同一文件系统内只改目录项），真正的释放交给这里的线程：
+ *   每轮最多处理 Config::fileReclaimBatch 个文件，大文件按 Config::fileReclaimTruncateStep 分段截断后再 unlink，
+ *   释放的字节按 Config::fileReclaimBytesPerSec 限速；失败的按指数退避重试。
+ * 回收目录 uploadRoot/trash 在启动时扫描一遍，上次退出时没删完的文件接着删。
+ */
+class FileReclaimer {
+public:
+    static FileReclaimer* Instance();
+
+    void Start();
+    void Stop();   // 不等队列删完，剩下的留在回收目录里
+
+    // 把文件移进回收目录，staged 输出新路径；文件已不存在时返回 true 且 staged 为空
+    bool Stage(const std::string& path, std::string& staged);
+    // 交给回收线程删除
+    void Release(const std::string& staged);
+    // Stage + Release；和回收目录不在同一个文件系统上时原地排队删除
+    void Discard(const std::string& path);
+
+    const std::string& TrashDir() const { return trashDir_; }
+    FileReclaimerStats GetStats();
+
+private:
+    FileReclaimer();
+    ~FileReclaimer();
+
+    struct Entry {
+        std::string path;
+        int attempts;
+        std::chrono::steady_clock::time_point nextTry;
+    };
+
+    void Loop_();
+    bool Reclaim_(const std::string& path);
+    void Pace_(long long bytes);   // 按限速睡眠，关闭时提前返回
+    bool IsClosing_();
+
+    std::string trashDir_;
+    std::deque<Entry> queue_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    bool isClose_;
+    std::thread thread_;
+
+    std::atomic<uint64_t> seq_;
+    std::atomic<uint64_t> staged_, reclaimed_, bytes_, retries_, failures_;
+};
@@ -0,0 +1,229 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-21 10:26:14
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-21 10:26:14
+ * @Description: 按用户的文件名三元组索引，/files/search 做前缀和子串匹配不查库
+ */
+#include "FileSearchIndex.h"
+#include <ctime>
+#include <algorithm>
+#include <unordered_set>
+#include "MetaStore.h"
+#include "../config/config.h"
+#include "../log/log.h"
+
+static inline uint32_t GramKey(const char* p) {
+    return (static_cast<uint32_t>(static_cast<unsigned char>(p[0])) << 16)
+         | (static_cast<uint32_t>(static_cast<unsigned char>(p[1])) << 8)
+         | static_cast<uint32_t>(static_cast<unsigned char>(p[2]));
+}
+
+FileSearchIndex::FileSearchIndex() : files_(0), queries_(0), builds_(0), evictions_(0) {}
+
+FileSearchIndex* FileSearchIndex::Instance() {
+    static FileSearchIndex index;
+    return &index;
+}
+
+std::string FileSearchIndex::Lower_(const std::string& s) {
+    // 只转 ASCII，多字节字符原样保留
+    std::string out(s);
+    for (char& c : out) {
+        if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+    }
+    return out;
+}
+
+void FileSearchIndex::UserIndex::Append(Doc doc) {
+    uint32_t idx = static_cast<uint32_t>(docs.size());
+    for (size_t i = 0; i + 3 <= doc.lower.size(); i++) {
+        std::vector<uint32_t>& list = grams[GramKey(doc.lower.data() + i)];
+        if (list.empty() || list.back() != idx) { list.push_back(idx); }  // 同一个名字里重复的三元组只记一次
+    }
+    docs.push_back(std::move(doc));
+}
+
+void FileSearchIndex::UserIndex::Compact() {
+    std::vector<Doc> old;
+    old.swap(docs);
+    grams.clear();
+    dead = 0;
+    for (Doc& doc : old) {
+        if (doc.alive) { Append(std::move(doc)); }
+    }
+}
+
+void FileSearchIndex::UserIndex::Query(const std::string& lower, size_t limit,
+                                       std::vector<FileSearchHit>& hits) const {
+    // 倒排表取查询串各三元组中最短的一条作为候选，再逐个确认子串
+    hits.clear();   // 某个三元组不存在时提前返回，不能留着调用方原有的内容
+    const std::vector<uint32_t>* candidates = nullptr;
+    for (size_t i = 0; i + 3 <= lower.size(); i++) {
+        auto it = grams.find(GramKey(lower.data() + i));
+        if (it == grams.end()) return;
+        if (!candidates || it->second.size() < candidates->size()) { candidates = &it->second; }
+    }
+
+    // 前缀匹配排在前面，两类各自从新到旧
+    std::vector<FileSearchHit> prefix, substr;
+    auto visit = [&](uint32_t i) {
+        const Doc& doc = docs[i];
+        if (!doc.alive) return;
+        size_t pos = doc.lower.find(lower);
+        if (pos == std::string::npos) return;
+        std::vector<FileSearchHit>& out = pos == 0 ? prefix : substr;
+        if (out.size() < limit) { out.push_back({doc.name, doc.uploadTime, doc.size, pos == 0}); }
+    };
+    if (candidates) {
+        for (auto it = candidates->rbegin(); it != candidates->rend() && prefix.size() < limit; ++it) { visit(*it); }
+    } else {
+        for (size_t i = docs.size(); i-- > 0 && prefix.size() < limit;) { visit(static_cast<uint32_t>(i)); }
+    }
+    hits = std::move(prefix);
+    for (size_t i = 0; i < substr.size() && hits.size() < limit; i++) {
+        hits.push_back(std::move(substr[i]));
+    }
+}
+
+std::shared_ptr<FileSearchIndex::UserIndex> FileSearchIndex::Find_(int userId) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    queries_++;
+    auto it = users_.find(userId);
+    if (it == users_.end()) return nullptr;
+    lru_.splice(lru_.begin(), lru_, it->second->pos);
+    return it->second;
+}
+
+bool FileSearchIndex::TrySearch(int userId, const std::string& query, size_t limit,
+                                std::vector<FileSearchHit>& hits) {
+    std::shared_ptr<UserIndex> index = Find_(userId);
+    if (!index) return false;
+    std::lock_guard<std::mutex> locker(index->mtx);
+    index->Query(Lower_(query), limit, hits);
+    return true;
+}
+
+bool FileSearchIndex::Search(int userId, const std::string& query, size_t limit,
+                             std::vector<FileSearchHit>& hits) {
+    std::shared_ptr<UserIndex> index = Find_(userId);
+    if (!index) {
+        index = Build_(userId);
+        if (!index) return false;
+    }
+    std::lock_guard<std::mutex> locker(index->mtx);
+    index->Query(Lower_(query), limit, hits);
+    return true;
+}
+
+std::shared_ptr<FileSearchIndex::UserIndex> FileSearchIndex::Build_(int userId) {
+    std::shared_ptr<Flight> flight;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        std::shared_ptr<Flight>& slot = inflight_[userId];
+        if (!slot) { slot = std::make_shared<Flight>(); }
+        flight = slot;
+        builds_++;
+    }
+
+    // ForEachFile 从新到旧，建好后反过来，让下标按入库先后递增
+    std::vector<UploadedFileInfo> files;
+    bool ok = MetaStore::Instance()->ForEachFile(userId, 0, "", 0, [&files](const UploadedFileInfo& info) {
+        files.push_back(info);
+    });
+    auto index = std::make_shared<UserIndex>();
+    if (ok) {
+        index->docs.reserve(files.size());
+        for (auto it = files.rbegin(); it != files.rend(); ++it) {
+            index->Append({it->original_filename, Lower_(it->original_filename), it->stored_filename,
+                           it->upload_time, it->file_size, true});
+        }
+    }
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = inflight_.find(userId);
+    if (it != inflight_.end() && it->second == flight) { inflight_.erase(it); }
+    if (!ok) {
+        LOG_WARN("FileSearchIndex: load files of user %d failed", userId);
+        return nullptr;
+    }
+    if (!flight->stale && users_.count(userId) == 0) {
+        Install_(userId, index);
+    }
+    return index;
+}
+
+void FileSearchIndex::Install_(int userId, const std::shared_ptr<UserIndex>& index) {
+    lru_.push_front(userId);
+    index->pos = lru_.begin();
+    users_[userId] = index;
+    files_ += index->Alive();
+    // 刚装入的这个至少保留，单个用户超过上限也照样能搜
+    while (files_ > Config::searchIndexMaxFiles && lru_.size() > 1) {
+        int victim = lru_.back();
+        lru_.pop_back();
+        auto it = users_.find(victim);
+        std::lock_guard<std::mutex> locker(it->second->mtx);
+        files_ -= it->second->Alive();
+        users_.erase(it);
+        evictions_++;
+    }
+}
+
+void FileSearchIndex::Touch_(int userId) {
+    auto it = inflight_.find(userId);
+    if (it != inflight_.end()) { it->second->stale = true; }
+}
+
+void FileSearchIndex::Add(const UploadedFileInfo& info) {
+    // 入库时没有取回数据库里的 upload_time，用本地时间代替，只用于展示
+    char now[32];
+    time_t t = time(nullptr);
+    struct tm tmNow;
+    localtime_r(&t, &tmNow);
+    strftime(now, sizeof(now), "%Y-%m-%d %H:%M:%S", &tmNow);
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    Touch_(info.uploader_id);
+    auto it = users_.find(info.uploader_id);
+    if (it == users_.end()) return;   // 还没建过索引，第一次搜索时会从库里读到
+    std::lock_guard<std::mutex> indexLocker(it->second->mtx);
+    it->second->Append({info.original_filename, Lower_(info.original_filename), info.stored_filename,
+                        now, info.file_size, true});
+    files_++;
+}
+
+void FileSearchIndex::Remove(int userId, const std::vector<UploadedFileInfo>& removed) {
+    if (removed.empty()) return;
+    std::lock_guard<std::mutex> locker(mtx_);
+    Touch_(userId);
+    auto it = users_.find(userId);
+    if (it == users_.end()) return;
+    UserIndex& index = *it->second;
+    std::lock_guard<std::mutex> indexLocker(index.mtx);
+    // 删除按文件名删掉该用户所有同名记录，这里也按 stored_filename 全部标记
+    std::unordered_set<std::string> names;
+    for (const UploadedFileInfo& info : removed) { names.insert(info.stored_filename); }
+    for (Doc& doc : index.docs) {
+        if (doc.alive && names.count(doc.storedName)) {
+            doc.alive = false;
+            index.dead++;
+            files_--;
+        }
+    }
+    // 删掉的超过一半时重建，倒排表不留太多无效下标
+    if (index.dead > 64 && index.dead * 2 > index.docs.size()) {
+        index.Compact();
+    }
+}
+
+FileSearchStats FileSearchIndex::GetStats() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    FileSearchStats stats;
+    stats.queries = queries_;
+    stats.builds = builds_;
+    stats.evictions = evictions_;
+    stats.users = users_.size();
+    stats.files = files_;
+    return stats;
+}
@@ -0,0 +1,101 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-21 10:26:14
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-21 10:26:14
+ * @Description: 按用户的文件名三元组索引，/files/search 做前缀和子串匹配不查库
+ */
+#pragma once
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "uploaded_file.h"
+
+struct FileSearchHit {
+    std::string filename;
+    std::string uploadTime;
+    long long size;
+    bool prefix;          // 文件名以查询串开头，否则是子串匹配
+};
+
+struct FileSearchStats {
+    uint64_t queries;
+    uint64_t builds;      // 从数据库建索引的次数
+    uint64_t evictions;
+    size_t users;
+    size_t files;
+};
+
+/*
+ * 某个用户第一次搜索时从 MetaStore 读出全部上传记录建索引，之后随上传入库、删除记录增减，不再查库。
+ * 文件名转小写后按字节取三元组建倒排表，UTF-8 的子串按字节匹配同样成立；
+ * 查询串不足三个字节时直接扫描该用户的全部文件名。
+ * 建索引期间有写操作时，这次的结果只用来回答当前查询，不留在内存里。
+ * 总文件数超过 Config::searchIndexMaxFiles 时按 LRU 淘汰整个用户的索引。
+ */
+class FileSearchIndex {
+public:
+    static FileSearchIndex* Instance();
+
+    // 索引已在内存时直接查询并返回 true；否则返回 false，调用方到 DB 线程里调 Search
+    bool TrySearch(int userId, const std::string& query, size_t limit, std::vector<FileSearchHit>& hits);
+    // 没有索引时先查库建好；查库失败返回 false
+    bool Search(int userId, const std::string& query, size_t limit, std::vector<FileSearchHit>& hits);
+
+    // 上传记录入库后调用
+    void Add(const UploadedFileInfo& info);
+    // 删除记录后调用，按 stored_filename 移除
+    void Remove(int userId, const std::vector<UploadedFileInfo>& removed);
+
+    FileSearchStats GetStats();
+
+private:
+    FileSearchIndex();
+    ~FileSearchIndex() = default;
+
+    struct Doc {
+        std::string name;
+        std::string lower;
+        std::string storedName;
+        std::string uploadTime;
+        long long size;
+        bool alive;
+    };
+
+    /* 一个用户的索引；docs 按入库先后排列，倒排表里的下标因此是递增的 */
+    struct UserIndex {
+        std::mutex mtx;
+        std::vector<Doc> docs;
+        std::unordered_map<uint32_t, std::vector<uint32_t>> grams;
+        size_t dead = 0;
+        std::list<int>::iterator pos;
+
+        void Append(Doc doc);
+        void Compact();
+        void Query(const std::string& lower, size_t limit, std::vector<FileSearchHit>& hits) const;
+        size_t Alive() const { return docs.size() - dead; }
+    };
+
+    struct Flight {
+        bool stale = false;   // 建索引期间该用户有上传或删除
+    };
+
+    std::shared_ptr<UserIndex> Find_(int userId);
+    std::shared_ptr<UserIndex> Build_(int userId);
+    void Install_(int userId, const std::shared_ptr<UserIndex>& index);
+    void Touch_(int userId);   // 写操作：建索引中的标记作废
+
+    static std::string Lower_(const std::string& s);
+
+    std::mutex mtx_;
+    std::list<int> lru_;     // 头部最近使用
+    std::unordered_map<int, std::shared_ptr<UserIndex>> users_;
+    std::unordered_map<int, std::shared_ptr<Flight>> inflight_;
+    size_t files_;
+
+    uint64_t queries_, builds_, evictions_;
+};
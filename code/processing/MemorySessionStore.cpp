@@ -0,0 +1,163 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-27 10:20:45
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-27 10:20:45
+ * @Description: 进程内会话存储，分片哈希表 + 时间轮过期
+ */
+#include "MemorySessionStore.h"
+#include <functional>
+
+MemorySessionStore::MemorySessionStore() : start_(Clock::now()), isClose_(false) {
+    for (auto& shard : shards_) {
+        shard.wheel.resize(WHEEL_SLOTS);
+    }
+    wheelThread_ = std::thread(&MemorySessionStore::WheelLoop_, this);
+}
+
+MemorySessionStore::~MemorySessionStore() {
+    {
+        std::lock_guard<std::mutex> locker(wheelMtx_);
+        isClose_ = true;
+    }
+    wheelCond_.notify_all();
+    if (wheelThread_.joinable()) { wheelThread_.join(); }
+}
+
+MemorySessionStore::Shard& MemorySessionStore::ShardFor_(const std::string& key) {
+    return shards_[std::hash<std::string>()(key) % SHARD_COUNT];
+}
+
+int64_t MemorySessionStore::NowMs_() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start_).count();
+}
+
+void MemorySessionStore::Schedule_(Shard& shard, const std::string& key, Entry& entry) {
+    // 向上取整到秒，保证扫到该格时条目一定已经过期
+    entry.expireTick = (entry.expireMs + 999) / 1000;
+    shard.wheel[entry.expireTick % WHEEL_SLOTS].push_back(key);
+}
+
+void MemorySessionStore::Create(const std::string& key, int userID, int ttl) {
+    Shard& shard = ShardFor_(key);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    Entry& entry = shard.table[key];
+    entry.userID = userID;
+    entry.expireMs = NowMs_() + static_cast<int64_t>(ttl) * 1000;
+    Schedule_(shard, key, entry);
+}
+
+std::optional<int> MemorySessionStore::Get(const std::string& key, int64_t* ttlMs) {
+    Shard& shard = ShardFor_(key);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.table.find(key);
+    if (it == shard.table.end()) return std::nullopt;
+    int64_t remain = it->second.expireMs - NowMs_();
+    if (remain <= 0) {
+        shard.table.erase(it); // 时间轮里的引用扫到时会被丢弃
+        return std::nullopt;
+    }
+    if (ttlMs) { *ttlMs = remain; }
+    return it->second.userID;
+}
+
+bool MemorySessionStore::Refresh_(const std::string& key, int ttl) {
+    Shard& shard = ShardFor_(key);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.table.find(key);
+    if (it == shard.table.end()) return false;
+    int64_t now = NowMs_();
+    if (it->second.expireMs <= now) {
+        shard.table.erase(it);
+        return false;
+    }
+    int64_t oldTick = it->second.expireTick;
+    it->second.expireMs = now + static_cast<int64_t>(ttl) * 1000;
+    int64_t newTick = (it->second.expireMs + 999) / 1000;
+    if (newTick % WHEEL_SLOTS == oldTick % WHEEL_SLOTS) {
+        it->second.expireTick = newTick; // 仍在同一格，沿用原引用
+    } else {
+        Schedule_(shard, key, it->second);
+    }
+    return true;
+}
+
+bool MemorySessionStore::Refresh(const std::string& key, int ttl) {
+    return Refresh_(key, ttl);
+}
+
+void MemorySessionStore::Delete(const std::string& key) {
+    Shard& shard = ShardFor_(key);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    shard.table.erase(key);
+}
+
+std::vector<std::optional<int>> MemorySessionStore::GetMany(const std::vector<std::string>& keys) {
+    std::vector<std::optional<int>> result;
+    result.reserve(keys.size());
+    for (const auto& key : keys) {
+        result.push_back(Get(key));
+    }
+    return result;
+}
+
+size_t MemorySessionStore::RefreshMany(const std::vector<std::string>& keys, int ttl) {
+    size_t refreshed = 0;
+    for (const auto& key : keys) {
+        if (Refresh_(key, ttl)) { refreshed++; }
+    }
+    return refreshed;
+}
+
+void MemorySessionStore::DeleteMany(const std::vector<std::string>& keys) {
+    for (const auto& key : keys) {
+        Delete(key);
+    }
+}
+
+size_t MemorySessionStore::Size() {
+    size_t total = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        total += shard.table.size();
+    }
+    return total;
+}
+
+void MemorySessionStore::Tick_(int64_t tick) {
+    int64_t now = NowMs_();
+    size_t slot = tick % WHEEL_SLOTS;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        std::vector<std::string>& keys = shard.wheel[slot];
+        std::vector<std::string> remain;
+        for (auto& key : keys) {
+            auto it = shard.table.find(key);
+            if (it == shard.table.end()) continue;                              // 已删除
+            if (static_cast<size_t>(it->second.expireTick % WHEEL_SLOTS) != slot) continue; // 续期后的旧引用
+            if (it->second.expireTick > tick || it->second.expireMs > now) {    // 还要再转几圈
+                remain.push_back(std::move(key));
+                continue;
+            }
+            shard.table.erase(it);
+        }
+        keys.swap(remain);
+    }
+}
+
+void MemorySessionStore::WheelLoop_() {
+    int64_t lastTick = NowMs_() / 1000;
+    std::unique_lock<std::mutex> locker(wheelMtx_);
+    while (!isClose_) {
+        wheelCond_.wait_for(locker, std::chrono::seconds(1));
+        if (isClose_) break;
+        int64_t curTick = NowMs_() / 1000;
+        locker.unlock();
+        // 线程被延迟调度时补齐错过的格子
+        for (int64_t t = lastTick + 1; t <= curTick; t++) {
+            Tick_(t);
+        }
+        lastTick = curTick;
+        locker.lock();
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-27 10:20:45
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-27 10:20:45
+ * @Description: 进程内会话存储，分片哈希表 + 时间轮过期
+ */
+#pragma once
+#include "SessionStore.h"
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <unordered_map>
+
+/*
+ * 每个分片一把锁，分片内按秒粒度的时间轮管理过期：
+ * key 挂在 expireTick % WHEEL_SLOTS 号槽里，后台线程每秒推进一格，
+ * 只检查当前槽里的 key，过期的删掉；续期后旧槽里的引用在扫到时丢弃。
+ * 读操作也会检查过期时间，因此时间轮只负责回收内存，不影响正确性。
+ */
+class MemorySessionStore : public SessionStore {
+public:
+    MemorySessionStore();
+    ~MemorySessionStore() override;
+
+    void Create(const std::string& key, int userID, int ttl) override;
+    std::optional<int> Get(const std::string& key, int64_t* ttlMs = nullptr) override;
+    bool Refresh(const std::string& key, int ttl) override;
+    void Delete(const std::string& key) override;
+
+    std::vector<std::optional<int>> GetMany(const std::vector<std::string>& keys) override;
+    size_t RefreshMany(const std::vector<std::string>& keys, int ttl) override;
+    void DeleteMany(const std::vector<std::string>& keys) override;
+
+    const char* Name() const override { return "memory"; }
+
+    size_t Size();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        int userID;
+        int64_t expireMs;     // 过期时刻（相对 start_ 的毫秒数）
+        int64_t expireTick;   // 所在时间轮格子对应的秒数
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, Entry> table;
+        std::vector<std::vector<std::string>> wheel;
+    };
+
+    Shard& ShardFor_(const std::string& key);
+    int64_t NowMs_() const;
+    void Schedule_(Shard& shard, const std::string& key, Entry& entry);
+    bool Refresh_(const std::string& key, int ttl);
+    void Tick_(int64_t tick);
+    void WheelLoop_();
+
+    static const int SHARD_COUNT = 16;
+    static const int WHEEL_SLOTS = 512;  // 秒
+
+    Shard shards_[SHARD_COUNT];
+    Clock::time_point start_;
+
+    bool isClose_;
+    std::mutex wheelMtx_;
+    std::condition_variable wheelCond_;
+    std::thread wheelThread_;
+};
@@ -0,0 +1,22 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-08 09:40:12
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-08 09:40:12
+ * @Description: 按配置选择元数据存储后端
+ */
+#include "MetaStore.h"
+#include "MySqlMetaStore.h"
+#include "SqliteMetaStore.h"
+#include "../config/config.h"
+#include <memory>
+
+MetaStore* MetaStore::Instance() {
+    static std::unique_ptr<MetaStore> store = [] () -> std::unique_ptr<MetaStore> {
+        if (Config::metaBackend == MetaBackend::SQLITE) {
+            return std::make_unique<SqliteMetaStore>(Config::sqlitePath);
+        }
+        return std::make_unique<MySqlMetaStore>();
+    }();
+    return store.get();
+}
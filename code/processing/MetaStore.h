@@ -0,0 +1,65 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-08 09:40:12
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-08 09:40:12
+ * @Description: 元数据存储接口，屏蔽 MySQL / 内嵌 SQLite 两种后端
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include "uploaded_file.h"
+
+typedef std::function<void(const UploadedFileInfo&)> FileRowFn;
+
+/*
+ * 用户表和上传记录表的全部读写。返回 false 表示查询失败（或没有找到），
+ * 调用方不关心后端是远端 MySQL 还是进程内的 SQLite。
+ */
+class MetaStore {
+public:
+    virtual ~MetaStore() = default;
+
+    // 根据 Config::metaBackend 创建，进程内唯一
+    static MetaStore* Instance();
+
+    virtual bool UserExists(const std::string& username) = 0;
+    virtual bool GetUserPasswordHash(const std::string& username, std::string& hash, int& userID) = 0;
+    // 单条 INSERT，用户名重复由唯一键拒绝，返回 false
+    virtual bool InsertUser(const std::string& username, const std::string& hash, int& userID) = 0;
+    // 逐个回调全部用户名，用于启动时装入布隆过滤器
+    virtual bool ForEachUsername(const std::function<void(const std::string&)>& fn) = 0;
+    // 按用户汇总上传记录的 file_size，用于启动时装入配额计数
+    virtual bool ForEachUserUsage(const std::function<void(int userId, long long bytes)>& fn) = 0;
+
+    // upload_time 由存储层取当前时间，info.id / info.upload_time 被忽略；
+    // content_hash 非空时先给 blobs 表中对应内容加一次引用，再插入上传记录
+    virtual bool InsertFile(const UploadedFileInfo& info) = 0;
+    // 删除用户名下同名的全部记录并释放它们对 blob 的引用，removed 输出被删除的记录；
+    // 先删记录再减引用，中途失败只会多留一个 blob，不会回收仍被引用的内容
+    virtual bool DeleteFile(const std::string& storedName, int userId,
+                            std::vector<UploadedFileInfo>& removed) = 0;
+    // 批量删除，一次借连接（SQLite 为一个写操作）删完，removed 中没有出现的文件名即不存在
+    virtual bool DeleteFiles(const std::vector<std::string>& storedNames, int userId,
+                             std::vector<UploadedFileInfo>& removed) = 0;
+    // 用户名下同名文件中最新的一条
+    virtual bool GetFile(int userId, const std::string& storedName, UploadedFileInfo& info) = 0;
+    // 按 (upload_time, id) 倒序逐行回调；limit <= 0 表示全部，afterTime 为空表示第一页
+    virtual bool ForEachFile(int userId, int limit, const std::string& afterTime, int afterId,
+                             const FileRowFn& fn) = 0;
+
+    /* 引用数归零的 blob，由 BlobStore 后台回收 */
+    virtual bool ListGarbageBlobs(int limit, std::vector<std::string>& hashes) = 0;
+    // 仅当引用数仍为 0 时删除 blob 记录，返回 true 表示删掉了，调用方随后删除文件
+    virtual bool RemoveBlob(const std::string& hash) = 0;
+
+    /* 一次性迁移：去重存储之前的上传记录没有 content_hash，文件还在旧路径上 */
+    // 按 id 升序回调 id > afterId 的旧记录，最多 limit 行
+    virtual bool ForEachLegacyFile(int afterId, int limit, const FileRowFn& fn) = 0;
+    // 给旧记录挂上已入库的内容：先加引用，再改路径和摘要；记录已被迁移或删除时撤销引用并返回 false
+    virtual bool AttachBlob(int fileId, const UploadedFileInfo& info) = 0;
+
+    virtual const char* Name() const = 0;
+    virtual void LogStats() {}
+};
@@ -0,0 +1,351 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-08 09:52:30
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-08 09:52:30
+ * @Description: 用户查询与注册、上传记录读写，全部走连接上缓存的预处理语句；读按 SqlRouter 分到从库
+ */
+#include "MySqlMetaStore.h"
+#include "../pool/sqlconnpool.h"
+#include "../pool/sqlconnRAII.h"
+#include "../pool/sqlrouter.h"
+#include <mysql/mysql.h>
+
+bool MySqlMetaStore::UserExists(const std::string& username) {
+    // 判断用户名是否已被占用，落后的从库会把刚注册的名字当成可用，只能查主库
+    MYSQL* sql;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    SqlParams params;
+    params.Str(username);
+    MYSQL_STMT* stmt = stmts->Execute(STMT_USER_EXISTS, params.Binds());
+    if (!stmt) return false;
+    SqlStmtGuard guard(stmt);
+
+    int one = 0;
+    SqlRow row(stmt);
+    row.Int(&one);
+    if (!row.Bind()) return false;
+    bool exists = row.Fetch();
+    while (row.Fetch()) {} // 读完剩余行，句柄才能复用
+    return exists;
+}
+
+bool MySqlMetaStore::GetUserPasswordHash(const std::string& username, std::string& hash, int& userID) {
+    SqlReadRAII conn(username);  // 刚注册的用户名读主库
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    SqlParams params;
+    params.Str(username);
+    MYSQL_STMT* stmt = stmts->Execute(STMT_USER_GET_HASH, params.Binds());
+    if (!stmt) return false;
+    SqlStmtGuard guard(stmt);
+
+    SqlRow row(stmt);
+    row.Int(&userID).Str(&hash, 128);
+    if (!row.Bind()) return false;
+    bool found = row.Fetch();
+    while (row.Fetch()) {}
+    return found;
+}
+
+bool MySqlMetaStore::InsertUser(const std::string& username, const std::string& hash, int& userID) {
+    MYSQL* sql;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    SqlParams params;
+    params.Str(username).Str(hash);
+    MYSQL_STMT* stmt = stmts->Execute(STMT_USER_INSERT, params.Binds());
+    if (!stmt) return false;
+
+    userID = static_cast<int>(mysql_stmt_insert_id(stmt));
+    SqlRouter::Instance()->NoteUserWrite(username);
+    return true;
+}
+
+bool MySqlMetaStore::ForEachUsername(const std::function<void(const std::string&)>& fn) {
+    // 布隆过滤器不能漏用户名，必须读主库，不能读可能落后的从库
+    MYSQL* sql;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    MYSQL_STMT* stmt = stmts->Execute(STMT_USER_NAMES, nullptr);
+    if (!stmt) return false;
+    SqlStmtGuard guard(stmt);
+
+    std::string username;
+    SqlRow row(stmt);
+    row.Str(&username, 64);
+    if (!row.Bind()) return false;
+    while (row.Fetch()) {
+        fn(username);
+    }
+    return true;
+}
+
+bool MySqlMetaStore::ForEachUserUsage(const std::function<void(int userId, long long bytes)>& fn) {
+    // 配额计数少算会放过超额上传，和布隆过滤器一样读主库
+    MYSQL* sql;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    MYSQL_STMT* stmt = stmts->Execute(STMT_FILE_USAGE, nullptr);
+    if (!stmt) return false;
+    SqlStmtGuard guard(stmt);
+
+    int userId = 0;
+    long long bytes = 0;
+    SqlRow row(stmt);
+    row.Int(&userId).Int64(&bytes);
+    if (!row.Bind()) return false;
+    while (row.Fetch()) {
+        fn(userId, bytes);
+    }
+    return true;
+}
+
+bool MySqlMetaStore::InsertFile(const UploadedFileInfo& info) {
+    MYSQL* sql = nullptr;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    long long size = info.file_size;
+    if (!info.content_hash.empty()) {
+        // 先加引用再插记录：插记录失败时引用多一次，内容只是晚些回收，不会被误删
+        SqlParams ref;
+        ref.Str(info.content_hash).Int64(size);
+        if (!stmts->Execute(STMT_BLOB_ADDREF, ref.Binds())) return false;
+    }
+    SqlParams params;
+    params.Str(info.original_filename).Str(info.stored_filename).Str(info.file_path)
+          .Int64(size).Str(info.file_type).Int(info.uploader_id).Str(info.content_hash);
+    bool ok = stmts->Execute(STMT_FILE_INSERT, params.Binds()) != nullptr;
+    if (!ok && !info.content_hash.empty()) {
+        SqlParams undo;
+        undo.Str(info.content_hash);
+        stmts->Execute(STMT_BLOB_RELEASE, undo.Binds());
+    }
+    SqlRouter::Instance()->NoteWrite(info.uploader_id);
+    return ok;
+}
+
+// 删除一个文件名下的全部记录，调用方已经借好主库连接
+static bool DeleteByName(SqlStmtCache* stmts, const std::string& storedName, int userId,
+                         std::vector<UploadedFileInfo>& removed) {
+    std::vector<UploadedFileInfo> found;
+    {
+        SqlParams params;
+        params.Str(storedName).Int(userId);
+        MYSQL_STMT* stmt = stmts->Execute(STMT_FILE_FIND, params.Binds());
+        if (!stmt) return false;
+        SqlStmtGuard guard(stmt);
+
+        UploadedFileInfo info;
+        info.original_filename = info.stored_filename = storedName;
+        info.uploader_id = userId;
+        SqlRow row(stmt);
+        row.Int(&info.id).Str(&info.file_path).Str(&info.content_hash, 65).Int64(&info.file_size);
+        if (!row.Bind()) return false;
+        while (row.Fetch()) {
+            found.push_back(info);
+        }
+    }
+
+    for (const UploadedFileInfo& info : found) {
+        SqlParams del;
+        del.Int(info.id);
+        MYSQL_STMT* stmt = stmts->Execute(STMT_FILE_DELETE_ID, del.Binds());
+        if (!stmt || mysql_stmt_affected_rows(stmt) == 0) continue;  // 并发删除时由另一方释放引用
+        if (!info.content_hash.empty()) {
+            SqlParams rel;
+            rel.Str(info.content_hash);
+            stmts->Execute(STMT_BLOB_RELEASE, rel.Binds());
+        }
+        removed.push_back(info);
+    }
+    return true;
+}
+
+bool MySqlMetaStore::DeleteFile(const std::string& storedName, int userId,
+                                std::vector<UploadedFileInfo>& removed) {
+    return DeleteFiles(std::vector<std::string>{storedName}, userId, removed);
+}
+
+bool MySqlMetaStore::DeleteFiles(const std::vector<std::string>& storedNames, int userId,
+                                 std::vector<UploadedFileInfo>& removed) {
+    MYSQL* sql = nullptr;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    bool ok = true;
+    for (const std::string& name : storedNames) {
+        if (!DeleteByName(stmts, name, userId, removed)) {
+            ok = false;
+            break;
+        }
+    }
+    SqlRouter::Instance()->NoteWrite(userId);
+    return ok;
+}
+
+bool MySqlMetaStore::GetFile(int userId, const std::string& storedName, UploadedFileInfo& info) {
+    SqlReadRAII conn(userId);
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    SqlParams params;
+    params.Str(storedName).Int(userId);
+    MYSQL_STMT* stmt = stmts->Execute(STMT_FILE_GET, params.Binds());
+    if (!stmt) return false;
+    SqlStmtGuard guard(stmt);
+
+    SqlRow row(stmt);
+    row.Int(&info.id)
+       .Str(&info.original_filename)
+       .Str(&info.stored_filename)
+       .Str(&info.file_path)
+       .Int64(&info.file_size)
+       .Str(&info.upload_time, 64)
+       .Str(&info.file_type, 64)
+       .Int(&info.uploader_id)
+       .Str(&info.content_hash, 65);
+    if (!row.Bind()) return false;
+    bool found = row.Fetch();
+    while (row.Fetch()) {}
+    return found;
+}
+
+bool MySqlMetaStore::ListGarbageBlobs(int limit, std::vector<std::string>& hashes) {
+    MYSQL* sql = nullptr;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    SqlParams params;
+    params.Int(limit);
+    MYSQL_STMT* stmt = stmts->Execute(STMT_BLOB_GARBAGE, params.Binds());
+    if (!stmt) return false;
+    SqlStmtGuard guard(stmt);
+
+    std::string hash;
+    SqlRow row(stmt);
+    row.Str(&hash, 65);
+    if (!row.Bind()) return false;
+    while (row.Fetch()) {
+        hashes.push_back(hash);
+    }
+    return true;
+}
+
+bool MySqlMetaStore::RemoveBlob(const std::string& hash) {
+    MYSQL* sql = nullptr;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    SqlParams params;
+    params.Str(hash);
+    MYSQL_STMT* stmt = stmts->Execute(STMT_BLOB_REMOVE, params.Binds());
+    return stmt && mysql_stmt_affected_rows(stmt) == 1;
+}
+
+static void BindFileRow(SqlRow& row, UploadedFileInfo& info) {
+    row.Int(&info.id)
+       .Str(&info.original_filename)
+       .Str(&info.stored_filename)
+       .Str(&info.file_path)
+       .Int64(&info.file_size)
+       .Str(&info.upload_time, 64)
+       .Str(&info.file_type, 64)
+       .Int(&info.uploader_id);
+}
+
+bool MySqlMetaStore::ForEachFile(int userId, int limit, const std::string& afterTime, int afterId,
+                                 const FileRowFn& fn) {
+    SqlReadRAII conn(userId);  // 用户刚上传或删除过时读主库
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    // 语句在连接上只 prepare 一次，之后每次只绑定参数并执行
+    SqlParams params;
+    MYSQL_STMT* stmt = nullptr;
+    if (limit <= 0) {
+        params.Int(userId);
+        stmt = stmts->Execute(STMT_FILE_LIST, params.Binds());
+    } else if (afterTime.empty()) {
+        params.Int(userId).Int(limit);
+        stmt = stmts->Execute(STMT_FILE_PAGE_FIRST, params.Binds());
+    } else {
+        params.Int(userId).Str(afterTime).Str(afterTime).Int(afterId).Int(limit);
+        stmt = stmts->Execute(STMT_FILE_PAGE_AFTER, params.Binds());
+    }
+    if (!stmt) return false;
+    SqlStmtGuard guard(stmt);
+
+    UploadedFileInfo info;
+    SqlRow row(stmt);
+    BindFileRow(row, info);
+    if (!row.Bind()) return false;
+
+    // 未调用 mysql_stmt_store_result，行由服务端逐行送来，内存只占一行
+    while (row.Fetch()) {
+        fn(info);
+    }
+    return true;
+}
+
+bool MySqlMetaStore::ForEachLegacyFile(int afterId, int limit, const FileRowFn& fn) {
+    // 迁移紧跟在写入之后，读主库
+    MYSQL* sql = nullptr;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    SqlParams params;
+    params.Int(afterId).Int(limit);
+    MYSQL_STMT* stmt = stmts->Execute(STMT_FILE_LEGACY, params.Binds());
+    if (!stmt) return false;
+    SqlStmtGuard guard(stmt);
+
+    UploadedFileInfo info;
+    SqlRow row(stmt);
+    BindFileRow(row, info);
+    if (!row.Bind()) return false;
+    while (row.Fetch()) {
+        fn(info);
+    }
+    return true;
+}
+
+bool MySqlMetaStore::AttachBlob(int fileId, const UploadedFileInfo& info) {
+    MYSQL* sql = nullptr;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    SqlStmtCache* stmts = conn.Stmts();
+    if (!stmts) return false;
+
+    long long size = info.file_size;
+    SqlParams ref;
+    ref.Str(info.content_hash).Int64(size);
+    if (!stmts->Execute(STMT_BLOB_ADDREF, ref.Binds())) return false;
+
+    SqlParams params;
+    params.Str(info.file_path).Int64(size).Str(info.content_hash).Int(fileId);
+    MYSQL_STMT* stmt = stmts->Execute(STMT_FILE_ATTACH, params.Binds());
+    bool ok = stmt && mysql_stmt_affected_rows(stmt) == 1;
+    if (!ok) {
+        SqlParams undo;
+        undo.Str(info.content_hash);
+        stmts->Execute(STMT_BLOB_RELEASE, undo.Binds());
+    }
+    SqlRouter::Instance()->NoteWrite(info.uploader_id);
+    return ok;
+}
@@ -0,0 +1,35 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-08 09:52:30
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-08 09:52:30
+ * @Description: 基于 MySQL 连接池和预处理语句缓存的元数据存储
+ */
+#pragma once
+#include "MetaStore.h"
+
+class MySqlMetaStore : public MetaStore {
+public:
+    bool UserExists(const std::string& username) override;
+    bool GetUserPasswordHash(const std::string& username, std::string& hash, int& userID) override;
+    bool InsertUser(const std::string& username, const std::string& hash, int& userID) override;
+    bool ForEachUsername(const std::function<void(const std::string&)>& fn) override;
+    bool ForEachUserUsage(const std::function<void(int userId, long long bytes)>& fn) override;
+
+    bool InsertFile(const UploadedFileInfo& info) override;
+    bool DeleteFile(const std::string& storedName, int userId,
+                    std::vector<UploadedFileInfo>& removed) override;
+    bool DeleteFiles(const std::vector<std::string>& storedNames, int userId,
+                     std::vector<UploadedFileInfo>& removed) override;
+    bool GetFile(int userId, const std::string& storedName, UploadedFileInfo& info) override;
+    bool ForEachFile(int userId, int limit, const std::string& afterTime, int afterId,
+                     const FileRowFn& fn) override;
+
+    bool ListGarbageBlobs(int limit, std::vector<std::string>& hashes) override;
+    bool RemoveBlob(const std::string& hash) override;
+
+    bool ForEachLegacyFile(int afterId, int limit, const FileRowFn& fn) override;
+    bool AttachBlob(int fileId, const UploadedFileInfo& info) override;
+
+    const char* Name() const override { return "mysql"; }
+};
@@ -10,11 +10,13 @@
  #pragma once
 #include <memory>
 #include <string>
-#include <sw/redis++/redis++.h>
+#include <optional>
+#include "../log/log.h"
 
 class RedisSessionManager {
 public:
     RedisSessionManager(int defaultTTL = 3600);
+    static RedisSessionManager* Instance();
 
     std::string CreateSession(int userID, int ttl = -1);
     void RefreshSessionTTL(const std::string& token);
@@ -22,7 +24,9 @@ public:
     void DeleteSession(const std::string& token);
 
 private:
-    std::shared_ptr<sw::redis::Redis> redis_;
+    std::optional<int> VerifySigned_(const std::string& token);
+    void RevokeSigned_(const std::string& token);
+
     int defaultTTL_;
     std::string GenerateToken(int length = 32);
 };
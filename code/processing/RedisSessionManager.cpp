@@ -2,37 +2,140 @@
  * @Author: Wang
  * @Date: 2025-06-23 20:29:19
  * @LastEditors: Please set LastEditors
- * @LastEditTime: 2025-06-23 20:30:50
- * @Description: 请填写简介
+ * @LastEditTime: 2025-06-24 10:12:40
+ * @Description: 会话的创建、续期、查询与删除，数据落在 SessionStore（Redis 或进程内存）
  */
 
 
  #include "../processing/RedisSessionManager .h"
+#include "../processing/SessionCache.h"
+#include "../processing/TokenSigner.h"
+#include "../processing/SessionStore.h"
+#include "../processing/SessionRefresher.h"
+#include "../config/config.h"
 #include <random>
 #include <chrono>
+#include <ctime>
+#include <algorithm>
 
 RedisSessionManager::RedisSessionManager(int defaultTTL)
-    : defaultTTL_(defaultTTL), redis_(std::make_shared<sw::redis::Redis>("tcp://127.0.0.1:6379")) {}
+    : defaultTTL_(defaultTTL) {}
+
+RedisSessionManager* RedisSessionManager::Instance() {
+    static RedisSessionManager manager(Config::sessionTTL);
+    return &manager;
+}
 
 std::string RedisSessionManager::CreateSession(int userID, int ttl) {
     if (ttl <= 0) ttl = defaultTTL_;
+    if (Config::sessionMode == SessionMode::SIGNED) {
+        // 签名 token 自带 userID 和过期时间，签发时不访问 Redis
+        std::string token = TokenSigner::Instance()->Issue(userID, ttl);
+        if (token.empty()) return "";   // 随机数不可用，不签发
+        SessionCache::Instance()->PutValid(token, userID, static_cast<int64_t>(ttl) * 1000);
+        return token;
+    }
     std::string token = GenerateToken();
-    redis_->setex("session:" + token, ttl, std::to_string(userID));
+    try {
+        SessionStore::Instance()->Create("session:" + token, userID, ttl);
+    } catch (const SessionStoreError& e) {
+        LOG_ERROR("CreateSession: store error: %s", e.what());
+        return "";
+    }
+    SessionCache::Instance()->PutValid(token, userID, static_cast<int64_t>(ttl) * 1000);
     return token;
 }
 
 void RedisSessionManager::RefreshSessionTTL(const std::string& token) {
-    redis_->expire("session:" + token, std::chrono::seconds(defaultTTL_));
+    // 不在请求线程里直接 EXPIRE，交给 SessionRefresher 去重后批量续期
+    SessionRefresher::Instance()->Touch(token);
 }
 
 std::optional<int> RedisSessionManager::GetUserID(const std::string& token) {
-    auto val = redis_->get("session:" + token);
-    if (val) return std::stoi(*val);
-    return std::nullopt;
+    if (token.empty()) return std::nullopt;
+    if (TokenSigner::LooksSigned(token)) return VerifySigned_(token);
+
+    // 先查进程内缓存，命中（包括负缓存）就不再访问 Redis
+    int userID = 0;
+    bool valid = false;
+    if (SessionCache::Instance()->Get(token, userID, valid)) {
+        if (valid) return userID;
+        return std::nullopt;
+    }
+
+    // 未命中：同时取回剩余寿命，缓存时间不超过存储中的过期时间
+    std::optional<int> id;
+    int64_t ttlMs = -1;
+    try {
+        id = SessionStore::Instance()->Get("session:" + token, &ttlMs);
+    } catch (const SessionStoreError& e) {
+        LOG_ERROR("GetUserID: store error: %s", e.what());
+        return std::nullopt; // 存储故障不写负缓存
+    }
+
+    if (!id || *id <= 0) {
+        SessionCache::Instance()->PutInvalid(token);
+        return std::nullopt;
+    }
+    SessionCache::Instance()->PutValid(token, *id, ttlMs);
+    return id;
+}
+
+std::optional<int> RedisSessionManager::VerifySigned_(const std::string& token) {
+    // 签名和过期时间在本地校验，常数时间比较，不依赖 Redis
+    SignedToken info;
+    if (!TokenSigner::Instance()->Verify(token, info)) return std::nullopt;
+
+    // 吊销检查经过进程内缓存，同一 token 在缓存有效期内只查一次 Redis
+    int userID = 0;
+    bool valid = false;
+    if (SessionCache::Instance()->Get(token, userID, valid)) {
+        if (valid) return userID;
+        return std::nullopt;
+    }
+
+    bool revoked = false;
+    try {
+        revoked = SessionStore::Instance()->Get("revoked:" + info.jti).has_value();
+    } catch (const SessionStoreError& e) {
+        LOG_ERROR("VerifySigned: store error: %s", e.what());
+        return std::nullopt;
+    }
+    if (revoked) {
+        SessionCache::Instance()->PutInvalid(token);
+        return std::nullopt;
+    }
+    int64_t remainMs = (info.expiresAt - time(nullptr)) * 1000;
+    SessionCache::Instance()->PutValid(token, info.userID, remainMs);
+    return info.userID;
+}
+
+void RedisSessionManager::RevokeSigned_(const std::string& token) {
+    SignedToken info;
+    if (!TokenSigner::Instance()->Verify(token, info)) return; // 伪造或已过期的 token 无需记录
+    // 吊销记录只保留到 token 自身过期为止，集合大小受活跃 token 数限制
+    long long remain = std::max<long long>(1, info.expiresAt - time(nullptr));
+    try {
+        SessionStore::Instance()->Create("revoked:" + info.jti, info.userID, static_cast<int>(remain));
+    } catch (const SessionStoreError& e) {
+        LOG_ERROR("RevokeSigned: store error: %s", e.what());
+    }
 }
 
 void RedisSessionManager::DeleteSession(const std::string& token) {
-    redis_->del("session:" + token);
+    if (token.empty()) return;
+    if (TokenSigner::LooksSigned(token)) {
+        RevokeSigned_(token);
+        SessionCache::Instance()->PutInvalid(token);
+        return;
+    }
+    try {
+        SessionStore::Instance()->Delete("session:" + token);
+    } catch (const SessionStoreError& e) {
+        LOG_ERROR("DeleteSession: store error: %s", e.what());
+    }
+    // 删除后立即让本进程的缓存失效，并记为无效 token
+    SessionCache::Instance()->PutInvalid(token);
 }
 
 std::string RedisSessionManager::GenerateToken(int length) {
@@ -45,4 +148,4 @@ std::string RedisSessionManager::GenerateToken(int length) {
         token += charset[dist(gen)];
     }
     return token;
-}
\ No newline at end of file
+}
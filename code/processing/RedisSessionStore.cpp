@@ -0,0 +1,120 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-27 10:20:45
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-27 10:20:45
+ * @Description: 基于 RedisPool 的会话存储，批量操作合并成一次 pipeline
+ */
+#include "RedisSessionStore.h"
+#include "../pool/redispool.h"
+#include <chrono>
+
+static std::optional<int> ParseUserID(const sw::redis::OptionalString& val) {
+    if (!val) return std::nullopt;
+    try {
+        return std::stoi(*val);
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+void RedisSessionStore::Create(const std::string& key, int userID, int ttl) {
+    try {
+        RedisPool::Instance()->Exec([&](sw::redis::Redis& redis) {
+            redis.setex(key, ttl, std::to_string(userID));
+        });
+    } catch (const sw::redis::Error& e) {
+        throw SessionStoreError(e.what());
+    }
+}
+
+std::optional<int> RedisSessionStore::Get(const std::string& key, int64_t* ttlMs) {
+    sw::redis::OptionalString val;
+    long long pttl = -2;
+    try {
+        RedisPool::Instance()->Exec([&](sw::redis::Redis& redis) {
+            if (!ttlMs) {
+                val = redis.get(key);
+                return;
+            }
+            // 需要剩余寿命时，值和 PTTL 在一次往返里取回
+            auto replies = redis.pipeline(false).get(key).pttl(key).exec();
+            val = replies.get<sw::redis::OptionalString>(0);
+            pttl = replies.get<long long>(1);
+        });
+    } catch (const sw::redis::Error& e) {
+        throw SessionStoreError(e.what());
+    }
+    if (ttlMs) {
+        if (pttl == -2) return std::nullopt; // GET 和 PTTL 之间 key 恰好过期
+        *ttlMs = pttl;
+    }
+    return ParseUserID(val);
+}
+
+bool RedisSessionStore::Refresh(const std::string& key, int ttl) {
+    try {
+        return RedisPool::Instance()->Exec([&](sw::redis::Redis& redis) {
+            return redis.expire(key, std::chrono::seconds(ttl));
+        });
+    } catch (const sw::redis::Error& e) {
+        throw SessionStoreError(e.what());
+    }
+}
+
+void RedisSessionStore::Delete(const std::string& key) {
+    try {
+        RedisPool::Instance()->Exec([&](sw::redis::Redis& redis) {
+            redis.del(key);
+        });
+    } catch (const sw::redis::Error& e) {
+        throw SessionStoreError(e.what());
+    }
+}
+
+std::vector<std::optional<int>> RedisSessionStore::GetMany(const std::vector<std::string>& keys) {
+    std::vector<std::optional<int>> result;
+    if (keys.empty()) return result;
+    try {
+        RedisPool::Instance()->Exec([&](sw::redis::Redis& redis) {
+            auto pipe = redis.pipeline(false);
+            for (const auto& key : keys) { pipe.get(key); }
+            auto replies = pipe.exec();
+            for (size_t i = 0; i < keys.size(); i++) {
+                result.push_back(ParseUserID(replies.get<sw::redis::OptionalString>(i)));
+            }
+        });
+    } catch (const sw::redis::Error& e) {
+        throw SessionStoreError(e.what());
+    }
+    return result;
+}
+
+size_t RedisSessionStore::RefreshMany(const std::vector<std::string>& keys, int ttl) {
+    size_t refreshed = 0;
+    if (keys.empty()) return refreshed;
+    try {
+        RedisPool::Instance()->Exec([&](sw::redis::Redis& redis) {
+            auto pipe = redis.pipeline(false);
+            for (const auto& key : keys) { pipe.expire(key, std::chrono::seconds(ttl)); }
+            auto replies = pipe.exec();
+            for (size_t i = 0; i < keys.size(); i++) {
+                if (replies.get<bool>(i)) { refreshed++; }
+            }
+        });
+    } catch (const sw::redis::Error& e) {
+        throw SessionStoreError(e.what());
+    }
+    return refreshed;
+}
+
+void RedisSessionStore::DeleteMany(const std::vector<std::string>& keys) {
+    if (keys.empty()) return;
+    try {
+        RedisPool::Instance()->Exec([&](sw::redis::Redis& redis) {
+            redis.del(keys.begin(), keys.end());
+        });
+    } catch (const sw::redis::Error& e) {
+        throw SessionStoreError(e.what());
+    }
+}
@@ -0,0 +1,23 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-27 10:20:45
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-27 10:20:45
+ * @Description: 基于 RedisPool 的会话存储
+ */
+#pragma once
+#include "SessionStore.h"
+
+class RedisSessionStore : public SessionStore {
+public:
+    void Create(const std::string& key, int userID, int ttl) override;
+    std::optional<int> Get(const std::string& key, int64_t* ttlMs = nullptr) override;
+    bool Refresh(const std::string& key, int ttl) override;
+    void Delete(const std::string& key) override;
+
+    std::vector<std::optional<int>> GetMany(const std::vector<std::string>& keys) override;
+    size_t RefreshMany(const std::vector<std::string>& keys, int ttl) override;
+    void DeleteMany(const std::vector<std::string>& keys) override;
+
+    const char* Name() const override { return "redis"; }
+};
@@ -0,0 +1,332 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-14 09:40:18
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-14 09:40:18
+ * @Description: 断点续传（tus 风格）：建会话、按偏移追加分片、查询偏移，写满后入库
+ */
+#include "ResumableUpload.h"
+#include "BlobStore.h"
+#include "FileReclaimer.h"
+#include "uploadservice.h"
+#include "../config/config.h"
+#include "../log/log.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+static const size_t ID_BYTES = 16;
+
+ResumableUpload::ResumableUpload() : dir_(Config::uploadStateDir), lastSweep_(Clock::now()) {}
+
+ResumableUpload* ResumableUpload::Instance() {
+    static ResumableUpload upload;
+    return &upload;
+}
+
+void ResumableUpload::Start() {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) { LOG_ERROR("ResumableUpload: create %s failed: %s", dir_.c_str(), ec.message().c_str()); }
+    SweepExpired_();
+}
+
+std::string ResumableUpload::InfoPath_(const std::string& id) const {
+    return dir_ + "/" + id + ".info";
+}
+
+std::string ResumableUpload::PartPath_(const std::string& id) const {
+    return dir_ + "/" + id + ".part";
+}
+
+bool ResumableUpload::ValidId_(const std::string& id) {
+    // id 会拼进文件路径，只接受自己生成的格式
+    if (id.size() != ID_BYTES * 2) return false;
+    for (char c : id) {
+        if (!isxdigit((unsigned char)c)) return false;
+    }
+    return true;
+}
+
+bool ResumableUpload::SaveState_(const UploadSession& s) {
+    // 先写临时文件再 rename，崩溃时 .info 要么是旧偏移要么是新偏移
+    std::string path = InfoPath_(s.id);
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << "user " << s.userId << "\n"
+            << "length " << s.length << "\n"
+            << "offset " << s.offset << "\n"
+            << "type " << s.contentType << "\n"
+            << "name " << s.filename << "\n";
+        if (!out.flush()) {
+            LOG_ERROR("ResumableUpload: write %s failed", tmp.c_str());
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("ResumableUpload: rename %s failed: %s", tmp.c_str(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool ResumableUpload::LoadState_(const std::string& id, UploadSession& s) {
+    std::ifstream in(InfoPath_(id));
+    if (!in) return false;
+    s.id = id;
+    s.userId = 0;
+    s.length = s.offset = -1;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t sp = line.find(' ');
+        if (sp == std::string::npos) continue;
+        std::string key = line.substr(0, sp);
+        std::string value = line.substr(sp + 1);
+        try {
+            if (key == "user") s.userId = std::stoi(value);
+            else if (key == "length") s.length = std::stoll(value);
+            else if (key == "offset") s.offset = std::stoll(value);
+            else if (key == "type") s.contentType = value;
+            else if (key == "name") s.filename = value;
+        } catch (...) {
+            return false;
+        }
+    }
+    if (s.userId <= 0 || s.length < 0 || s.offset < 0 || s.offset > s.length || s.filename.empty()) {
+        LOG_WARN("ResumableUpload: broken state file %s", InfoPath_(id).c_str());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<ResumableUpload::Entry> ResumableUpload::Find_(const std::string& id) {
+    if (!ValidId_(id)) return nullptr;
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = entries_.find(id);
+    if (it != entries_.end()) return it->second;
+    // 重启后第一次访问，从状态文件恢复
+    auto entry = std::make_shared<Entry>();
+    if (!LoadState_(id, entry->session)) return nullptr;
+    entries_[id] = entry;
+    return entry;
+}
+
+void ResumableUpload::Remove_(const std::string& id) {
+    // 调用方持有会话锁并已置 removed
+    unlink(InfoPath_(id).c_str());
+    FileReclaimer::Instance()->Discard(PartPath_(id));   // 放弃的大文件不在请求线程上释放
+    std::lock_guard<std::mutex> locker(mtx_);
+    entries_.erase(id);
+}
+
+ResumableUpload::Result ResumableUpload::Create(int userId, long long length, const std::string& filename,
+                                                const std::string& contentType, std::string& id) {
+    if (length < 0 || filename.empty()) return FAILED;
+
+    bool sweep = false;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (Clock::now() - lastSweep_ > std::chrono::minutes(10)) {
+            lastSweep_ = Clock::now();
+            sweep = true;
+        }
+    }
+    if (sweep) { SweepExpired_(); }
+
+    unsigned char raw[ID_BYTES];
+    if (RAND_bytes(raw, sizeof(raw)) != 1) {
+        LOG_ERROR("ResumableUpload: RAND_bytes failed");
+        return FAILED;
+    }
+    static const char HEX[] = "0123456789abcdef";
+    id.resize(ID_BYTES * 2);
+    for (size_t i = 0; i < ID_BYTES; i++) {
+        id[i * 2] = HEX[raw[i] >> 4];
+        id[i * 2 + 1] = HEX[raw[i] & 0xf];
+    }
+
+    auto entry = std::make_shared<Entry>();
+    UploadSession& s = entry->session;
+    s.id = id;
+    s.userId = userId;
+    s.length = length;
+    s.offset = 0;
+    s.filename = filename;
+    s.contentType = contentType.empty() ? "application/octet-stream" : contentType;
+
+    int fd = open(PartPath_(id).c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        LOG_ERROR("ResumableUpload: create %s failed: %s", PartPath_(id).c_str(), strerror(errno));
+        return FAILED;
+    }
+    close(fd);
+    if (!SaveState_(s)) {
+        unlink(PartPath_(id).c_str());
+        return FAILED;
+    }
+    std::lock_guard<std::mutex> locker(mtx_);
+    entries_[id] = entry;
+    LOG_INFO("ResumableUpload: session %s user:%d length:%lld", id.c_str(), userId, length);
+    return OK;
+}
+
+ResumableUpload::Result ResumableUpload::Query(const std::string& id, int userId, UploadSession& out) {
+    std::shared_ptr<Entry> entry = Find_(id);
+    if (!entry) return NOT_FOUND;
+    std::lock_guard<std::mutex> locker(entry->mtx);
+    if (entry->removed || entry->session.userId != userId) return NOT_FOUND;
+    out = entry->session;
+    return OK;
+}
+
+ResumableUpload::Result ResumableUpload::Append(const std::string& id, int userId, long long offset,
+                                                const char* data, size_t len, UploadSession& out, bool& completed) {
+    completed = false;
+    std::shared_ptr<Entry> entry = Find_(id);
+    if (!entry) return NOT_FOUND;
+    std::lock_guard<std::mutex> locker(entry->mtx);
+    UploadSession& s = entry->session;
+    if (entry->removed || s.userId != userId) return NOT_FOUND;
+    out = s;
+    if (offset != s.offset) return CONFLICT;
+    if (static_cast<long long>(len) > s.length - s.offset) return TOO_LARGE;
+
+    if (len > 0) {
+        int fd = open(PartPath_(id).c_str(), O_WRONLY);
+        if (fd < 0) {
+            LOG_ERROR("ResumableUpload: open %s failed: %s", PartPath_(id).c_str(), strerror(errno));
+            return FAILED;
+        }
+        // 直接写到目标偏移，不经过内存里的整文件缓冲
+        size_t done = 0;
+        while (done < len) {
+            ssize_t n = pwrite(fd, data + done, len - done, offset + done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                LOG_ERROR("ResumableUpload: pwrite %s failed: %s", PartPath_(id).c_str(), strerror(errno));
+                close(fd);
+                return FAILED;
+            }
+            done += n;
+        }
+        if (Config::uploadChunkFsync && fdatasync(fd) != 0) {
+            LOG_ERROR("ResumableUpload: fdatasync %s failed: %s", PartPath_(id).c_str(), strerror(errno));
+            close(fd);
+            return FAILED;
+        }
+        close(fd);
+
+        s.offset += len;
+        if (!SaveState_(s)) {
+            s.offset -= len;   // 偏移没推进，客户端会重发这一段，pwrite 覆盖同样的字节
+            return FAILED;
+        }
+    }
+    out = s;
+    if (s.offset < s.length) return OK;
+
+    if (!Finalize_(*entry)) return FAILED;
+    completed = true;
+    return OK;
+}
+
+bool ResumableUpload::Finalize_(Entry& entry) {
+    UploadSession& s = entry.session;
+    // 摘要在最后读一遍算：分片可能重发，边写边算得保证每个字节只进一次摘要
+    BlobWriter writer;
+    if (!writer.Adopt(PartPath_(s.id))) return false;
+    if (!UploadService::CommitBlob(writer, s.filename, s.contentType, s.userId)) {
+        LOG_WARN("ResumableUpload: commit %s failed, session kept for retry", s.id.c_str());
+        return false;
+    }
+    entry.removed = true;
+    Remove_(s.id);
+    LOG_INFO("ResumableUpload: session %s completed (%lld bytes)", s.id.c_str(), s.length);
+    return true;
+}
+
+ResumableUpload::Result ResumableUpload::Abort(const std::string& id, int userId) {
+    std::shared_ptr<Entry> entry = Find_(id);
+    if (!entry) return NOT_FOUND;
+    std::lock_guard<std::mutex> locker(entry->mtx);
+    if (entry->removed || entry->session.userId != userId) return NOT_FOUND;
+    entry->removed = true;
+    Remove_(id);
+    return OK;
+}
+
+void ResumableUpload::SweepExpired_() {
+    // .info 每个分片都会改写，修改时间就是会话最后一次活动的时间
+    namespace fs = std::filesystem;
+    auto deadline = fs::file_time_type::clock::now() - std::chrono::seconds(Config::uploadSessionTtlSec);
+    std::error_code ec;
+    std::vector<std::string> expired;
+    for (fs::directory_iterator it(dir_, ec), end; !ec && it != end; it.increment(ec)) {
+        const fs::path& p = it->path();
+        if (p.extension() != ".info") continue;
+        std::error_code tec;
+        auto mtime = fs::last_write_time(p, tec);
+        if (!tec && mtime < deadline) { expired.push_back(p.stem().string()); }
+    }
+    for (const std::string& id : expired) {
+        std::shared_ptr<Entry> entry;
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            auto it = entries_.find(id);
+            if (it != entries_.end()) entry = it->second;
+        }
+        if (entry) {
+            std::unique_lock<std::mutex> locker(entry->mtx, std::try_to_lock);
+            if (!locker.owns_lock() || entry->removed) continue;   // 正在写分片，说明还活着
+            entry->removed = true;
+            Remove_(id);
+        } else {
+            unlink(InfoPath_(id).c_str());
+            FileReclaimer::Instance()->Discard(PartPath_(id));
+        }
+        LOG_INFO("ResumableUpload: session %s expired", id.c_str());
+    }
+}
+
+static bool DecodeBase64(const std::string& in, std::string& out) {
+    if (in.size() % 4 != 0) return false;
+    std::vector<unsigned char> buf(in.size() / 4 * 3 + 1);
+    int n = EVP_DecodeBlock(buf.data(), reinterpret_cast<const unsigned char*>(in.data()), in.size());
+    if (n < 0) return false;
+    // EVP_DecodeBlock 把填充的 '=' 也解成 0，按填充个数去掉
+    size_t pad = 0;
+    if (!in.empty() && in[in.size() - 1] == '=') pad++;
+    if (in.size() > 1 && in[in.size() - 2] == '=') pad++;
+    out.assign(reinterpret_cast<char*>(buf.data()), n - pad);
+    return true;
+}
+
+bool ResumableUpload::ParseMetadata(const std::string& header, std::string& filename, std::string& contentType) {
+    std::stringstream ss(header);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t start = item.find_first_not_of(" ");
+        if (start == std::string::npos) continue;
+        item = item.substr(start);
+        size_t sp = item.find(' ');
+        std::string key = item.substr(0, sp);
+        std::string value;
+        if (sp != std::string::npos && !DecodeBase64(item.substr(sp + 1), value)) return false;
+        if (key == "filename") {
+            filename = value.substr(value.find_last_of("/\\") + 1);   // 和表单上传一样只保留文件名
+        } else if (key == "filetype") {
+            contentType = value;
+        }
+    }
+    // 文件名会写进按行解析的状态文件
+    return !filename.empty() && filename.find('\n') == std::string::npos
+           && contentType.find('\n') == std::string::npos;
+}
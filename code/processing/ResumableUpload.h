@@ -0,0 +1,81 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-14 09:40:18
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-14 09:40:18
+ * @Description: 断点续传（tus 风格）：建会话、按偏移追加分片、查询偏移，写满后入库
+ */
+#pragma once
+#include <string>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+
+struct UploadSession {
+    std::string id;
+    int userId;
+    long long length;      // 客户端声明的总长度
+    long long offset;      // 已经落盘的字节数
+    std::string filename;
+    std::string contentType;
+};
+
+/*
+ * 每个会话在 Config::uploadStateDir 下对应两个文件：<id>.info 记录会话状态，<id>.part 是数据本身。
+ * 分片用 pwrite 直接写到 .part 的对应偏移，落盘后再改写 .info 推进偏移；中途断开时偏移停在最后
+ * 一个完整分片，客户端 HEAD 查到偏移后从那里重发。重启后会话从 .info 恢复。
+ * 写满后 .part 硬链接进 BlobStore，和普通上传走同一套去重入库流程。
+ */
+class ResumableUpload {
+public:
+    enum Result {
+        OK,
+        NOT_FOUND,     // 没有这个会话，或者不属于当前用户
+        CONFLICT,      // Upload-Offset 和服务端记录的偏移不一致
+        TOO_LARGE,     // 超出声明的总长度
+        FAILED
+    };
+
+    static ResumableUpload* Instance();
+
+    void Start();   // 建目录并清掉过期会话
+
+    Result Create(int userId, long long length, const std::string& filename,
+                  const std::string& contentType, std::string& id);
+    Result Query(const std::string& id, int userId, UploadSession& out);
+    // 在 offset 处写入一个分片；写满后入库，completed 置为 true，会话随之删除。
+    // 入库失败时会话保留，客户端在 offset == length 处重发空分片即可重试
+    Result Append(const std::string& id, int userId, long long offset,
+                  const char* data, size_t len, UploadSession& out, bool& completed);
+    Result Abort(const std::string& id, int userId);
+
+    // Upload-Metadata: filename <base64>,filetype <base64>
+    static bool ParseMetadata(const std::string& header, std::string& filename, std::string& contentType);
+
+private:
+    ResumableUpload();
+
+    struct Entry {
+        std::mutex mtx;          // 同一会话的分片串行写
+        UploadSession session;
+        bool removed = false;    // 已完成、取消或过期，持有旧指针的请求按不存在处理
+    };
+    typedef std::chrono::steady_clock Clock;
+
+    std::shared_ptr<Entry> Find_(const std::string& id);
+    void Remove_(const std::string& id);
+    bool Finalize_(Entry& entry);
+    void SweepExpired_();
+
+    std::string InfoPath_(const std::string& id) const;
+    std::string PartPath_(const std::string& id) const;
+    bool SaveState_(const UploadSession& s);
+    bool LoadState_(const std::string& id, UploadSession& s);
+    static bool ValidId_(const std::string& id);
+
+    std::string dir_;
+    std::mutex mtx_;
+    std::unordered_map<std::string, std::shared_ptr<Entry>> entries_;
+    Clock::time_point lastSweep_;
+};
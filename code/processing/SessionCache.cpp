@@ -0,0 +1,110 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-25 09:41:12
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-25 09:41:12
+ * @Description: 进程内的 token -> userID 缓存
+ */
+#include "SessionCache.h"
+#include "../config/config.h"
+#include <algorithm>
+#include <functional>
+
+SessionCache::SessionCache()
+    : hits_(0), negHits_(0), misses_(0), evictions_(0) {
+    capacityPerShard_ = std::max(1, Config::sessionCacheCapacity / SHARD_COUNT);
+}
+
+SessionCache* SessionCache::Instance() {
+    static SessionCache cache;
+    return &cache;
+}
+
+SessionCache::Shard& SessionCache::ShardFor_(const std::string& token) {
+    return shards_[std::hash<std::string>()(token) % SHARD_COUNT];
+}
+
+bool SessionCache::Get(const std::string& token, int& userID, bool& valid) {
+    Shard& shard = ShardFor_(token);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.index.find(token);
+    if (it == shard.index.end()) {
+        misses_++;
+        return false;
+    }
+    if (it->second->expires <= Clock::now()) {
+        // 过期条目直接丢弃，按未命中处理
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        misses_++;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second); // 移到链表头
+    userID = it->second->userID;
+    valid = userID > 0;
+    if (valid) { hits_++; }
+    else { negHits_++; }
+    return true;
+}
+
+void SessionCache::PutValid(const std::string& token, int userID, int64_t ttlMs) {
+    /*
+    @ttlMs：Redis 中该 token 的剩余寿命，<0 表示未设置过期
+    缓存时间取 min(ttlMs, sessionCachePositiveTtlMs)，保证不会比 Redis 晚过期
+    */
+    int64_t ttl = Config::sessionCachePositiveTtlMs;
+    if (ttlMs >= 0) { ttl = std::min<int64_t>(ttl, ttlMs); }
+    if (ttl <= 0 || userID <= 0) return;
+    Put_(token, userID, ttl);
+}
+
+void SessionCache::PutInvalid(const std::string& token) {
+    Put_(token, 0, Config::sessionCacheNegativeTtlMs);
+}
+
+void SessionCache::Put_(const std::string& token, int userID, int64_t ttlMs) {
+    Shard& shard = ShardFor_(token);
+    Clock::time_point expires = Clock::now() + std::chrono::milliseconds(ttlMs);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.index.find(token);
+    if (it != shard.index.end()) {
+        it->second->userID = userID;
+        it->second->expires = expires;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+    shard.lru.push_front({token, userID, expires});
+    shard.index[token] = shard.lru.begin();
+    while (shard.index.size() > capacityPerShard_) {
+        // 淘汰最久未使用的条目
+        shard.index.erase(shard.lru.back().token);
+        shard.lru.pop_back();
+        evictions_++;
+    }
+}
+
+void SessionCache::Erase(const std::string& token) {
+    Shard& shard = ShardFor_(token);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.index.find(token);
+    if (it == shard.index.end()) return;
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+}
+
+void SessionCache::Clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        shard.index.clear();
+        shard.lru.clear();
+    }
+}
+
+SessionCacheStats SessionCache::GetStats() const {
+    SessionCacheStats stats;
+    stats.hits = hits_;
+    stats.negHits = negHits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    return stats;
+}
@@ -0,0 +1,70 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-25 09:41:12
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-25 09:41:12
+ * @Description: 进程内的 token -> userID 缓存，挡在 Redis 会话校验前面
+ */
+#pragma once
+#include <list>
+#include <mutex>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+
+struct SessionCacheStats {
+    uint64_t hits;         // 命中有效 token
+    uint64_t negHits;      // 命中无效 token
+    uint64_t misses;       // 未命中，需要回源 Redis
+    uint64_t evictions;    // 因容量淘汰的条目
+};
+
+/*
+ * 按 token 哈希分成若干分片，每个分片一把锁、一条 LRU 链表，互不竞争。
+ * 条目自带过期时间：有效条目不超过 Redis 中的剩余寿命，无效条目只缓存很短时间。
+ */
+class SessionCache {
+public:
+    static SessionCache* Instance();
+
+    // 命中返回 true；valid 为 false 表示命中的是负缓存
+    bool Get(const std::string& token, int& userID, bool& valid);
+    void PutValid(const std::string& token, int userID, int64_t ttlMs);
+    void PutInvalid(const std::string& token);
+    void Erase(const std::string& token);
+    void Clear();
+
+    SessionCacheStats GetStats() const;
+
+private:
+    SessionCache();
+    ~SessionCache() = default;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        std::string token;
+        int userID;        // <= 0 表示无效 token
+        Clock::time_point expires;
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        std::list<Entry> lru;  // 头部最近使用
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    Shard& ShardFor_(const std::string& token);
+    void Put_(const std::string& token, int userID, int64_t ttlMs);
+
+    static const int SHARD_COUNT = 16;
+
+    Shard shards_[SHARD_COUNT];
+    size_t capacityPerShard_;
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> negHits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> evictions_;
+};
@@ -0,0 +1,115 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-28 16:02:10
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-28 16:02:10
+ * @Description: 会话滑动过期，活跃 token 合并后由后台线程批量续期
+ */
+#include "SessionRefresher.h"
+#include "SessionStore.h"
+#include "TokenSigner.h"
+#include "../config/config.h"
+#include "../log/log.h"
+#include <chrono>
+#include <algorithm>
+
+SessionRefresher::SessionRefresher()
+    : ttl_(3600), intervalMs_(5000), touches_(0), refreshed_(0), isClose_(true) {}
+
+SessionRefresher::~SessionRefresher() {
+    Stop();
+}
+
+SessionRefresher* SessionRefresher::Instance() {
+    static SessionRefresher refresher;
+    return &refresher;
+}
+
+void SessionRefresher::Start(int ttl, int intervalMs) {
+    std::lock_guard<std::mutex> locker(loopMtx_);
+    if (!isClose_) return;
+    ttl_ = ttl;
+    intervalMs_ = intervalMs;
+    isClose_ = false;
+    flushThread_ = std::thread(&SessionRefresher::FlushLoop_, this);
+}
+
+void SessionRefresher::Stop() {
+    {
+        std::lock_guard<std::mutex> locker(loopMtx_);
+        if (isClose_) return;
+        isClose_ = true;
+    }
+    loopCond_.notify_all();
+    if (flushThread_.joinable()) { flushThread_.join(); }
+    Flush();
+}
+
+SessionRefresher::TouchSet& SessionRefresher::LocalSet_() {
+    thread_local std::shared_ptr<TouchSet> local;
+    if (!local) {
+        local = std::make_shared<TouchSet>();
+        std::lock_guard<std::mutex> locker(regMtx_);
+        sets_.push_back(local);
+    }
+    return *local;
+}
+
+void SessionRefresher::Touch(const std::string& token) {
+    if (token.empty() || TokenSigner::LooksSigned(token)) return; // 签名 token 的过期时间固定在 token 内
+    TouchSet& set = LocalSet_();
+    std::lock_guard<std::mutex> locker(set.mtx);  // 只和 Flush 换出集合时竞争
+    set.tokens.insert(token);
+    touches_++;
+}
+
+size_t SessionRefresher::Flush() {
+    // 把各线程的集合整体换出来，持锁时间只有一次 swap
+    std::vector<std::shared_ptr<TouchSet>> sets;
+    {
+        std::lock_guard<std::mutex> locker(regMtx_);
+        sets = sets_;
+    }
+    std::unordered_set<std::string> merged;
+    for (auto& set : sets) {
+        std::unordered_set<std::string> tokens;
+        {
+            std::lock_guard<std::mutex> locker(set->mtx);
+            tokens.swap(set->tokens);
+        }
+        merged.insert(tokens.begin(), tokens.end());
+    }
+    if (merged.empty()) return 0;
+
+    std::vector<std::string> keys;
+    keys.reserve(merged.size());
+    for (const auto& token : merged) {
+        keys.push_back("session:" + token);
+    }
+
+    size_t refreshed = 0;
+    size_t batch = std::max(1, Config::sessionRefreshBatch);
+    for (size_t i = 0; i < keys.size(); i += batch) {
+        std::vector<std::string> part(keys.begin() + i, keys.begin() + std::min(keys.size(), i + batch));
+        try {
+            refreshed += SessionStore::Instance()->RefreshMany(part, ttl_);
+        } catch (const SessionStoreError& e) {
+            // 续期失败不重试，下个周期这些用户再次访问时会重新记录
+            LOG_WARN("SessionRefresher: refresh %zu sessions failed: %s", part.size(), e.what());
+        }
+    }
+    refreshed_ += refreshed;
+    LOG_DEBUG("SessionRefresher: %zu touched, %zu refreshed", keys.size(), refreshed);
+    return refreshed;
+}
+
+void SessionRefresher::FlushLoop_() {
+    std::unique_lock<std::mutex> locker(loopMtx_);
+    while (!isClose_) {
+        loopCond_.wait_for(locker, std::chrono::milliseconds(intervalMs_));
+        if (isClose_) break;
+        locker.unlock();
+        Flush();
+        locker.lock();
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-28 16:02:10
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-28 16:02:10
+ * @Description: 会话滑动过期，活跃 token 合并后由后台线程批量续期
+ */
+#pragma once
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <unordered_set>
+
+/*
+ * 请求线程只把 token 记到本线程的集合里（几乎无竞争），
+ * 后台线程每隔 interval 把所有线程的集合换出来、去重，
+ * 再通过 SessionStore::RefreshMany 一次 pipeline 发出全部 EXPIRE。
+ * 一个活跃用户在一个周期内无论请求多少次，只产生一次 EXPIRE。
+ */
+class SessionRefresher {
+public:
+    static SessionRefresher* Instance();
+
+    void Start(int ttl, int intervalMs);
+    void Stop();   // 停止前会再刷一次
+
+    void Touch(const std::string& token);
+    size_t Flush();
+
+    uint64_t TouchCount() const { return touches_; }
+    uint64_t RefreshCount() const { return refreshed_; }
+
+private:
+    SessionRefresher();
+    ~SessionRefresher();
+
+    struct TouchSet {
+        std::mutex mtx;
+        std::unordered_set<std::string> tokens;
+    };
+
+    TouchSet& LocalSet_();
+    void FlushLoop_();
+
+    int ttl_;
+    int intervalMs_;
+
+    std::mutex regMtx_;                              // 保护 sets_
+    std::vector<std::shared_ptr<TouchSet>> sets_;    // 每个请求线程一个
+
+    std::atomic<uint64_t> touches_;
+    std::atomic<uint64_t> refreshed_;
+
+    bool isClose_;
+    std::mutex loopMtx_;
+    std::condition_variable loopCond_;
+    std::thread flushThread_;
+};
@@ -0,0 +1,23 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-27 10:20:45
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-27 10:20:45
+ * @Description: 按配置选择会话存储后端
+ */
+#include "SessionStore.h"
+#include "RedisSessionStore.h"
+#include "MemorySessionStore.h"
+#include "../config/config.h"
+#include "../log/log.h"
+#include <memory>
+
+SessionStore* SessionStore::Instance() {
+    static std::unique_ptr<SessionStore> store = [] () -> std::unique_ptr<SessionStore> {
+        if (Config::sessionBackend == SessionBackend::MEMORY) {
+            return std::make_unique<MemorySessionStore>();
+        }
+        return std::make_unique<RedisSessionStore>();
+    }();
+    return store.get();
+}
@@ -0,0 +1,44 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-27 10:20:45
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-27 10:20:45
+ * @Description: 会话存储接口，屏蔽 Redis / 内存两种后端
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+
+// 后端不可用时抛出，调用方据此区分“不存在”和“查不到”
+class SessionStoreError : public std::runtime_error {
+public:
+    explicit SessionStoreError(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+/*
+ * 带过期时间的 key -> userID 存储。key 由调用方拼好（如 session:<token>、revoked:<jti>），
+ * ttl 以秒为单位。
+ */
+class SessionStore {
+public:
+    virtual ~SessionStore() = default;
+
+    // 根据 Config::sessionBackend 创建，进程内唯一
+    static SessionStore* Instance();
+
+    virtual void Create(const std::string& key, int userID, int ttl) = 0;
+    // ttlMs 输出剩余寿命（毫秒），-1 表示没有过期时间
+    virtual std::optional<int> Get(const std::string& key, int64_t* ttlMs = nullptr) = 0;
+    virtual bool Refresh(const std::string& key, int ttl) = 0;
+    virtual void Delete(const std::string& key) = 0;
+
+    virtual std::vector<std::optional<int>> GetMany(const std::vector<std::string>& keys) = 0;
+    // 返回成功续期的 key 数量
+    virtual size_t RefreshMany(const std::vector<std::string>& keys, int ttl) = 0;
+    virtual void DeleteMany(const std::vector<std::string>& keys) = 0;
+
+    virtual const char* Name() const = 0;
+};
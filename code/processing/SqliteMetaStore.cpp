@@ -0,0 +1,606 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-08 10:15:47
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-08 10:15:47
+ * @Description: 内嵌 SQLite 元数据存储，WAL 模式，读连接按线程独占，写入由单独线程合并提交
+ */
+#include "SqliteMetaStore.h"
+#include "../config/config.h"
+#include "../log/log.h"
+#include <filesystem>
+#include <algorithm>
+#include <memory>
+
+const char* const SqliteMetaStore::SQL_TEXT[Q_COUNT] = {
+    /* Q_USER_EXISTS */
+    "SELECT 1 FROM user WHERE username = ? LIMIT 1",
+    /* Q_USER_GET_HASH */
+    "SELECT id, password FROM user WHERE username = ? LIMIT 1",
+    /* Q_USER_INSERT */
+    "INSERT INTO user(username, password) VALUES(?, ?)",
+    /* Q_USER_NAMES */
+    "SELECT username FROM user",
+    /* Q_FILE_INSERT：upload_time 和 MySQL 的 NOW() 一样取本地时间，文本格式相同，游标可以通用 */
+    "INSERT INTO uploaded_files (original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id, content_hash) "
+    "VALUES (?, ?, ?, ?, datetime('now', 'localtime'), ?, ?, ?)",
+    /* Q_FILE_DELETE_ID */
+    "DELETE FROM uploaded_files WHERE id = ?",
+    /* Q_FILE_LIST */
+    "SELECT id, original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id FROM uploaded_files "
+    "WHERE uploader_id = ? ORDER BY upload_time DESC, id DESC",
+    /* Q_FILE_PAGE_FIRST */
+    "SELECT id, original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id FROM uploaded_files "
+    "WHERE uploader_id = ? ORDER BY upload_time DESC, id DESC LIMIT ?",
+    /* Q_FILE_PAGE_AFTER */
+    "SELECT id, original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id FROM uploaded_files "
+    "WHERE uploader_id = ? AND (upload_time < ? OR (upload_time = ? AND id < ?)) "
+    "ORDER BY upload_time DESC, id DESC LIMIT ?",
+    /* Q_FILE_FIND */
+    "SELECT id, file_path, content_hash, file_size FROM uploaded_files WHERE stored_filename = ? AND uploader_id = ?",
+    /* Q_FILE_GET */
+    "SELECT id, original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id, content_hash FROM uploaded_files "
+    "WHERE stored_filename = ? AND uploader_id = ? ORDER BY id DESC LIMIT 1",
+    /* Q_BLOB_ADDREF */
+    "INSERT INTO blobs (hash, size, refcount) VALUES (?, ?, 1) "
+    "ON CONFLICT(hash) DO UPDATE SET refcount = refcount + 1",
+    /* Q_BLOB_RELEASE */
+    "UPDATE blobs SET refcount = refcount - 1 WHERE hash = ?",
+    /* Q_BLOB_GARBAGE */
+    "SELECT hash FROM blobs WHERE refcount <= 0 LIMIT ?",
+    /* Q_BLOB_REMOVE */
+    "DELETE FROM blobs WHERE hash = ? AND refcount <= 0",
+    /* Q_FILE_LEGACY */
+    "SELECT id, original_filename, stored_filename, file_path, file_size, "
+    "upload_time, file_type, uploader_id FROM uploaded_files "
+    "WHERE id > ? AND (content_hash IS NULL OR content_hash = '') ORDER BY id LIMIT ?",
+    /* Q_FILE_ATTACH */
+    "UPDATE uploaded_files SET file_path = ?, file_size = ?, content_hash = ? "
+    "WHERE id = ? AND (content_hash IS NULL OR content_hash = '')",
+    /* Q_FILE_USAGE */
+    "SELECT uploader_id, SUM(file_size) FROM uploaded_files GROUP BY uploader_id",
+    /* Q_BEGIN：IMMEDIATE 一开始就拿写锁，避免提交时才发现冲突 */
+    "BEGIN IMMEDIATE",
+    /* Q_COMMIT */
+    "COMMIT",
+    /* Q_ROLLBACK */
+    "ROLLBACK",
+    /* Q_SAVEPOINT */
+    "SAVEPOINT w",
+    /* Q_RELEASE */
+    "RELEASE w",
+    /* Q_ROLLBACK_TO */
+    "ROLLBACK TO w",
+};
+
+/* 建表语句和 README 中的 MySQL 表结构一致 */
+static const char* const SCHEMA_SQL =
+    "CREATE TABLE IF NOT EXISTS user ("
+    "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "  username TEXT UNIQUE,"
+    "  password TEXT);"
+    "CREATE TABLE IF NOT EXISTS uploaded_files ("
+    "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "  original_filename TEXT,"
+    "  stored_filename TEXT,"
+    "  file_path TEXT,"
+    "  file_size INTEGER,"
+    "  upload_time TEXT,"
+    "  file_type TEXT,"
+    "  uploader_id INTEGER REFERENCES user(id),"
+    "  content_hash TEXT);"
+    "CREATE INDEX IF NOT EXISTS idx_uploader_time_id ON uploaded_files(uploader_id, upload_time, id);"
+    "CREATE TABLE IF NOT EXISTS blobs ("
+    "  hash TEXT PRIMARY KEY,"
+    "  size INTEGER,"
+    "  refcount INTEGER NOT NULL DEFAULT 0);"
+    "CREATE INDEX IF NOT EXISTS idx_blob_refcount ON blobs(refcount);";
+
+/* 语句用完后立即 reset，结束读事务，否则会一直占着 WAL 快照，检查点无法推进 */
+class SqliteStmtGuard {
+public:
+    explicit SqliteStmtGuard(sqlite3_stmt* stmt) : stmt_(stmt) {}
+    ~SqliteStmtGuard() { if (stmt_) { sqlite3_reset(stmt_); } }
+private:
+    sqlite3_stmt* stmt_;
+};
+
+static void BindText(sqlite3_stmt* stmt, int idx, const std::string& s) {
+    // 执行期间调用方的字符串一直有效，不需要 SQLite 拷贝
+    sqlite3_bind_text(stmt, idx, s.data(), static_cast<int>(s.size()), SQLITE_STATIC);
+}
+
+static std::string ColumnText(sqlite3_stmt* stmt, int col) {
+    const unsigned char* text = sqlite3_column_text(stmt, col);
+    if (!text) return std::string();
+    return std::string(reinterpret_cast<const char*>(text), sqlite3_column_bytes(stmt, col));
+}
+
+static bool StepDone(sqlite3* db, sqlite3_stmt* stmt) {
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_DONE) return true;
+    if (rc == SQLITE_CONSTRAINT) {
+        // 用户名重复等唯一键冲突是正常的业务结果
+        LOG_DEBUG("SQLite 约束冲突: %s", sqlite3_errmsg(db));
+        return false;
+    }
+    LOG_WARN("SQLite 执行失败: %d %s", rc, sqlite3_errmsg(db));
+    return false;
+}
+
+SqliteMetaStore::Conn::~Conn() {
+    for (auto& stmt : stmts) {
+        if (stmt) {
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
+        }
+    }
+    if (db) {
+        sqlite3_close(db);
+        db = nullptr;
+    }
+}
+
+sqlite3_stmt* SqliteMetaStore::Conn::Get(Query id) {
+    if (!db) return nullptr;
+    sqlite3_stmt* stmt = stmts[id];
+    if (stmt) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        return stmt;
+    }
+    if (sqlite3_prepare_v3(db, SQL_TEXT[id], -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+        LOG_ERROR("SQLite 预处理失败[%d]: %s", id, sqlite3_errmsg(db));
+        return nullptr;
+    }
+    stmts[id] = stmt;
+    return stmt;
+}
+
+bool SqliteMetaStore::Conn::Exec(Query id) {
+    sqlite3_stmt* stmt = Get(id);
+    if (!stmt) return false;
+    SqliteStmtGuard guard(stmt);
+    return StepDone(db, stmt);
+}
+
+SqliteMetaStore::SqliteMetaStore(const std::string& path)
+    : path_(path), isClose_(true), writes_(0), failedWrites_(0), commits_(0), maxBatch_(0) {
+    std::filesystem::path dir = std::filesystem::path(path_).parent_path();
+    std::error_code ec;
+    if (!dir.empty()) { std::filesystem::create_directories(dir, ec); }
+
+    if (!Open_(writer_, true) || !InitSchema_()) {
+        LOG_ERROR("SqliteMetaStore: open %s failed", path_.c_str());
+        return;
+    }
+    isClose_ = false;
+    writerThread_ = std::thread(&SqliteMetaStore::WriterLoop_, this);
+}
+
+SqliteMetaStore::~SqliteMetaStore() {
+    Close();
+}
+
+void SqliteMetaStore::Close() {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (isClose_) return;
+        isClose_ = true;
+    }
+    cond_.notify_all();
+    if (writerThread_.joinable()) { writerThread_.join(); }
+}
+
+bool SqliteMetaStore::Open_(Conn& conn, bool writer) {
+    // 连接只在一个线程内使用，关掉 SQLite 自带的连接级互斥锁
+    int flags = SQLITE_OPEN_NOMUTEX;
+    flags |= writer ? (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) : SQLITE_OPEN_READONLY;
+    if (sqlite3_open_v2(path_.c_str(), &conn.db, flags, nullptr) != SQLITE_OK) {
+        LOG_ERROR("SQLite 打开失败 %s: %s", path_.c_str(), conn.db ? sqlite3_errmsg(conn.db) : "oom");
+        sqlite3_close(conn.db);
+        conn.db = nullptr;
+        return false;
+    }
+    sqlite3_busy_timeout(conn.db, Config::sqliteBusyTimeoutMs);
+    if (!writer) return true;
+
+    // WAL 下 synchronous=NORMAL 只在检查点时 fsync，进程崩溃不丢数据，掉电可能丢最近几次提交
+    std::string pragmas = "PRAGMA journal_mode=WAL; PRAGMA synchronous=" + Config::sqliteSynchronous + ";";
+    char* err = nullptr;
+    if (sqlite3_exec(conn.db, pragmas.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+        LOG_ERROR("SQLite 设置 WAL 失败: %s", err ? err : "");
+        sqlite3_free(err);
+        return false;
+    }
+    return true;
+}
+
+bool SqliteMetaStore::InitSchema_() {
+    char* err = nullptr;
+    if (sqlite3_exec(writer_.db, SCHEMA_SQL, nullptr, nullptr, &err) != SQLITE_OK) {
+        LOG_ERROR("SQLite 建表失败: %s", err ? err : "");
+        sqlite3_free(err);
+        return false;
+    }
+    // 去重存储之前建的库没有 content_hash 列，补上；已经有时报 duplicate column，忽略
+    sqlite3_exec(writer_.db, "ALTER TABLE uploaded_files ADD COLUMN content_hash TEXT", nullptr, nullptr, nullptr);
+    return true;
+}
+
+SqliteMetaStore::Conn* SqliteMetaStore::ReadConn_() {
+    // 进程内只有一个 SqliteMetaStore，线程退出时连接随之关闭
+    thread_local std::unique_ptr<Conn> local;
+    if (!local) {
+        std::unique_ptr<Conn> conn(new Conn());
+        if (!Open_(*conn, false)) return nullptr;
+        local = std::move(conn);
+    }
+    return local.get();
+}
+
+bool SqliteMetaStore::Write_(const WriteOp& op) {
+    WriteJob job{&op, false, false};
+    std::unique_lock<std::mutex> locker(mtx_);
+    if (isClose_) return false;
+    queue_.push_back(&job);
+    cond_.notify_one();
+    doneCond_.wait(locker, [&job] { return job.done; });
+    return job.ok;
+}
+
+void SqliteMetaStore::WriterLoop_() {
+    std::vector<WriteJob*> batch;
+    size_t batchMax = std::max(1, Config::sqliteWriteBatchMax);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> locker(mtx_);
+            cond_.wait(locker, [this] { return isClose_ || !queue_.empty(); });
+            if (queue_.empty()) break;   // 已关闭且队列排空
+            // 上一个事务提交期间排进来的写操作，这次一起提交
+            size_t n = std::min(queue_.size(), batchMax);
+            batch.assign(queue_.begin(), queue_.begin() + n);
+            queue_.erase(queue_.begin(), queue_.begin() + n);
+        }
+        CommitBatch_(batch);
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            for (WriteJob* job : batch) { job->done = true; }
+        }
+        doneCond_.notify_all();
+        batch.clear();
+    }
+}
+
+void SqliteMetaStore::CommitBatch_(std::vector<WriteJob*>& batch) {
+    writes_ += batch.size();
+    size_t peak = maxBatch_.load();
+    while (batch.size() > peak && !maxBatch_.compare_exchange_weak(peak, batch.size())) {}
+
+    if (!writer_.Exec(Q_BEGIN)) {
+        for (WriteJob* job : batch) { job->ok = false; }
+        failedWrites_ += batch.size();
+        return;
+    }
+    for (WriteJob* job : batch) {
+        if (!writer_.Exec(Q_SAVEPOINT)) {
+            job->ok = false;
+            continue;
+        }
+        job->ok = (*job->op)(writer_);
+        if (!job->ok) { writer_.Exec(Q_ROLLBACK_TO); }
+        writer_.Exec(Q_RELEASE);
+    }
+    if (!writer_.Exec(Q_COMMIT)) {
+        writer_.Exec(Q_ROLLBACK);
+        for (WriteJob* job : batch) { job->ok = false; }
+    }
+    commits_++;
+    for (WriteJob* job : batch) {
+        if (!job->ok) { failedWrites_++; }
+    }
+}
+
+bool SqliteMetaStore::UserExists(const std::string& username) {
+    Conn* conn = ReadConn_();
+    if (!conn) return false;
+    sqlite3_stmt* stmt = conn->Get(Q_USER_EXISTS);
+    if (!stmt) return false;
+    SqliteStmtGuard guard(stmt);
+    BindText(stmt, 1, username);
+    return sqlite3_step(stmt) == SQLITE_ROW;
+}
+
+bool SqliteMetaStore::GetUserPasswordHash(const std::string& username, std::string& hash, int& userID) {
+    Conn* conn = ReadConn_();
+    if (!conn) return false;
+    sqlite3_stmt* stmt = conn->Get(Q_USER_GET_HASH);
+    if (!stmt) return false;
+    SqliteStmtGuard guard(stmt);
+    BindText(stmt, 1, username);
+    if (sqlite3_step(stmt) != SQLITE_ROW) return false;
+    userID = sqlite3_column_int(stmt, 0);
+    hash = ColumnText(stmt, 1);
+    return true;
+}
+
+bool SqliteMetaStore::InsertUser(const std::string& username, const std::string& hash, int& userID) {
+    return Write_([&](Conn& conn) {
+        sqlite3_stmt* stmt = conn.Get(Q_USER_INSERT);
+        if (!stmt) return false;
+        SqliteStmtGuard guard(stmt);
+        BindText(stmt, 1, username);
+        BindText(stmt, 2, hash);
+        if (!StepDone(conn.db, stmt)) return false;
+        userID = static_cast<int>(sqlite3_last_insert_rowid(conn.db));
+        return true;
+    });
+}
+
+bool SqliteMetaStore::ForEachUsername(const std::function<void(const std::string&)>& fn) {
+    Conn* conn = ReadConn_();
+    if (!conn) return false;
+    sqlite3_stmt* stmt = conn->Get(Q_USER_NAMES);
+    if (!stmt) return false;
+    SqliteStmtGuard guard(stmt);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        fn(ColumnText(stmt, 0));
+    }
+    return rc == SQLITE_DONE;
+}
+
+bool SqliteMetaStore::ForEachUserUsage(const std::function<void(int userId, long long bytes)>& fn) {
+    Conn* conn = ReadConn_();
+    if (!conn) return false;
+    sqlite3_stmt* stmt = conn->Get(Q_FILE_USAGE);
+    if (!stmt) return false;
+    SqliteStmtGuard guard(stmt);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        fn(sqlite3_column_int(stmt, 0), sqlite3_column_int64(stmt, 1));
+    }
+    return rc == SQLITE_DONE;
+}
+
+bool SqliteMetaStore::InsertFile(const UploadedFileInfo& info) {
+    // 加引用和插记录在同一个保存点里，要么都成功要么都回滚
+    return Write_([&](Conn& conn) {
+        if (!info.content_hash.empty()) {
+            sqlite3_stmt* ref = conn.Get(Q_BLOB_ADDREF);
+            if (!ref) return false;
+            SqliteStmtGuard refGuard(ref);
+            BindText(ref, 1, info.content_hash);
+            sqlite3_bind_int64(ref, 2, info.file_size);
+            if (!StepDone(conn.db, ref)) return false;
+        }
+        sqlite3_stmt* stmt = conn.Get(Q_FILE_INSERT);
+        if (!stmt) return false;
+        SqliteStmtGuard guard(stmt);
+        BindText(stmt, 1, info.original_filename);
+        BindText(stmt, 2, info.stored_filename);
+        BindText(stmt, 3, info.file_path);
+        sqlite3_bind_int64(stmt, 4, info.file_size);
+        BindText(stmt, 5, info.file_type);
+        sqlite3_bind_int(stmt, 6, info.uploader_id);
+        BindText(stmt, 7, info.content_hash);
+        return StepDone(conn.db, stmt);
+    });
+}
+
+bool SqliteMetaStore::DeleteFile(const std::string& storedName, int userId,
+                                 std::vector<UploadedFileInfo>& removed) {
+    return DeleteFiles(std::vector<std::string>{storedName}, userId, removed);
+}
+
+bool SqliteMetaStore::DeleteFiles(const std::vector<std::string>& storedNames, int userId,
+                                  std::vector<UploadedFileInfo>& removed) {
+    // 整批在一个写操作里，只占写线程一次、只提交一次
+    std::vector<UploadedFileInfo> all;
+    bool ok = Write_([&](Conn& conn) {
+        all.clear();
+        for (const std::string& storedName : storedNames) {
+            std::vector<UploadedFileInfo> found;
+            {
+                sqlite3_stmt* stmt = conn.Get(Q_FILE_FIND);
+                if (!stmt) return false;
+                SqliteStmtGuard guard(stmt);
+                BindText(stmt, 1, storedName);
+                sqlite3_bind_int(stmt, 2, userId);
+                UploadedFileInfo info;
+                info.original_filename = info.stored_filename = storedName;
+                info.uploader_id = userId;
+                info.file_size = 0;
+                while (sqlite3_step(stmt) == SQLITE_ROW) {
+                    info.id = sqlite3_column_int(stmt, 0);
+                    info.file_path = ColumnText(stmt, 1);
+                    info.content_hash = ColumnText(stmt, 2);
+                    info.file_size = sqlite3_column_int64(stmt, 3);
+                    found.push_back(info);
+                }
+            }
+            // 写线程串行执行，查到的记录不会被别人同时删掉
+            for (const UploadedFileInfo& info : found) {
+                sqlite3_stmt* del = conn.Get(Q_FILE_DELETE_ID);
+                if (!del) return false;
+                SqliteStmtGuard delGuard(del);
+                sqlite3_bind_int(del, 1, info.id);
+                if (!StepDone(conn.db, del)) return false;
+                if (!info.content_hash.empty()) {
+                    sqlite3_stmt* rel = conn.Get(Q_BLOB_RELEASE);
+                    if (!rel) return false;
+                    SqliteStmtGuard relGuard(rel);
+                    BindText(rel, 1, info.content_hash);
+                    if (!StepDone(conn.db, rel)) return false;
+                }
+            }
+            all.insert(all.end(), found.begin(), found.end());
+        }
+        return true;
+    });
+    if (ok) { removed.insert(removed.end(), all.begin(), all.end()); }
+    return ok;
+}
+
+bool SqliteMetaStore::GetFile(int userId, const std::string& storedName, UploadedFileInfo& info) {
+    Conn* conn = ReadConn_();
+    if (!conn) return false;
+    sqlite3_stmt* stmt = conn->Get(Q_FILE_GET);
+    if (!stmt) return false;
+    SqliteStmtGuard guard(stmt);
+    BindText(stmt, 1, storedName);
+    sqlite3_bind_int(stmt, 2, userId);
+    if (sqlite3_step(stmt) != SQLITE_ROW) return false;
+    info.id = sqlite3_column_int(stmt, 0);
+    info.original_filename = ColumnText(stmt, 1);
+    info.stored_filename = ColumnText(stmt, 2);
+    info.file_path = ColumnText(stmt, 3);
+    info.file_size = sqlite3_column_int64(stmt, 4);
+    info.upload_time = ColumnText(stmt, 5);
+    info.file_type = ColumnText(stmt, 6);
+    info.uploader_id = sqlite3_column_int(stmt, 7);
+    info.content_hash = ColumnText(stmt, 8);
+    return true;
+}
+
+bool SqliteMetaStore::ListGarbageBlobs(int limit, std::vector<std::string>& hashes) {
+    Conn* conn = ReadConn_();
+    if (!conn) return false;
+    sqlite3_stmt* stmt = conn->Get(Q_BLOB_GARBAGE);
+    if (!stmt) return false;
+    SqliteStmtGuard guard(stmt);
+    sqlite3_bind_int(stmt, 1, limit);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        hashes.push_back(ColumnText(stmt, 0));
+    }
+    return rc == SQLITE_DONE;
+}
+
+bool SqliteMetaStore::RemoveBlob(const std::string& hash) {
+    bool removed = false;
+    bool ok = Write_([&](Conn& conn) {
+        sqlite3_stmt* stmt = conn.Get(Q_BLOB_REMOVE);
+        if (!stmt) return false;
+        SqliteStmtGuard guard(stmt);
+        BindText(stmt, 1, hash);
+        if (!StepDone(conn.db, stmt)) return false;
+        removed = sqlite3_changes(conn.db) == 1;
+        return true;
+    });
+    return ok && removed;
+}
+
+bool SqliteMetaStore::ForEachLegacyFile(int afterId, int limit, const FileRowFn& fn) {
+    Conn* conn = ReadConn_();
+    if (!conn) return false;
+    sqlite3_stmt* stmt = conn->Get(Q_FILE_LEGACY);
+    if (!stmt) return false;
+    SqliteStmtGuard guard(stmt);
+    sqlite3_bind_int(stmt, 1, afterId);
+    sqlite3_bind_int(stmt, 2, limit);
+
+    UploadedFileInfo info;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        info.id = sqlite3_column_int(stmt, 0);
+        info.original_filename = ColumnText(stmt, 1);
+        info.stored_filename = ColumnText(stmt, 2);
+        info.file_path = ColumnText(stmt, 3);
+        info.file_size = sqlite3_column_int64(stmt, 4);
+        info.upload_time = ColumnText(stmt, 5);
+        info.file_type = ColumnText(stmt, 6);
+        info.uploader_id = sqlite3_column_int(stmt, 7);
+        fn(info);
+    }
+    return rc == SQLITE_DONE;
+}
+
+bool SqliteMetaStore::AttachBlob(int fileId, const UploadedFileInfo& info) {
+    // 加引用和改记录在同一个保存点里，记录已迁移时返回 false 整个回滚
+    return Write_([&](Conn& conn) {
+        sqlite3_stmt* ref = conn.Get(Q_BLOB_ADDREF);
+        if (!ref) return false;
+        {
+            SqliteStmtGuard refGuard(ref);
+            BindText(ref, 1, info.content_hash);
+            sqlite3_bind_int64(ref, 2, info.file_size);
+            if (!StepDone(conn.db, ref)) return false;
+        }
+        sqlite3_stmt* stmt = conn.Get(Q_FILE_ATTACH);
+        if (!stmt) return false;
+        SqliteStmtGuard guard(stmt);
+        BindText(stmt, 1, info.file_path);
+        sqlite3_bind_int64(stmt, 2, info.file_size);
+        BindText(stmt, 3, info.content_hash);
+        sqlite3_bind_int(stmt, 4, fileId);
+        return StepDone(conn.db, stmt) && sqlite3_changes(conn.db) == 1;
+    });
+}
+
+bool SqliteMetaStore::ForEachFile(int userId, int limit, const std::string& afterTime, int afterId,
+                                  const FileRowFn& fn) {
+    Conn* conn = ReadConn_();
+    if (!conn) return false;
+
+    sqlite3_stmt* stmt = nullptr;
+    if (limit <= 0) {
+        stmt = conn->Get(Q_FILE_LIST);
+        if (!stmt) return false;
+        sqlite3_bind_int(stmt, 1, userId);
+    } else if (afterTime.empty()) {
+        stmt = conn->Get(Q_FILE_PAGE_FIRST);
+        if (!stmt) return false;
+        sqlite3_bind_int(stmt, 1, userId);
+        sqlite3_bind_int(stmt, 2, limit);
+    } else {
+        stmt = conn->Get(Q_FILE_PAGE_AFTER);
+        if (!stmt) return false;
+        sqlite3_bind_int(stmt, 1, userId);
+        BindText(stmt, 2, afterTime);
+        BindText(stmt, 3, afterTime);
+        sqlite3_bind_int(stmt, 4, afterId);
+        sqlite3_bind_int(stmt, 5, limit);
+    }
+    SqliteStmtGuard guard(stmt);
+
+    UploadedFileInfo info;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        info.id = sqlite3_column_int(stmt, 0);
+        info.original_filename = ColumnText(stmt, 1);
+        info.stored_filename = ColumnText(stmt, 2);
+        info.file_path = ColumnText(stmt, 3);
+        info.file_size = sqlite3_column_int64(stmt, 4);
+        info.upload_time = ColumnText(stmt, 5);
+        info.file_type = ColumnText(stmt, 6);
+        info.uploader_id = sqlite3_column_int(stmt, 7);
+        fn(info);
+    }
+    if (rc != SQLITE_DONE) {
+        LOG_ERROR("SQLite 查询文件列表失败: %d %s", rc, sqlite3_errmsg(conn->db));
+        return false;
+    }
+    return true;
+}
+
+SqliteStoreStats SqliteMetaStore::GetStats() {
+    SqliteStoreStats stats;
+    stats.writes = writes_;
+    stats.failedWrites = failedWrites_;
+    stats.commits = commits_;
+    stats.maxBatch = maxBatch_;
+    return stats;
+}
+
+void SqliteMetaStore::LogStats() {
+    SqliteStoreStats s = GetStats();
+    LOG_INFO("SqliteMetaStore writes:%llu failed:%llu commits:%llu maxBatch:%zu",
+             (unsigned long long)s.writes, (unsigned long long)s.failedWrites,
+             (unsigned long long)s.commits, s.maxBatch);
+}
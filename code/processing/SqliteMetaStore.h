@@ -0,0 +1,129 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-08 10:15:47
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-08 10:15:47
+ * @Description: 内嵌 SQLite 元数据存储，WAL 模式，读连接按线程独占，写入由单独线程合并提交
+ */
+#pragma once
+#include "MetaStore.h"
+#include <sqlite3.h>
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+struct SqliteStoreStats {
+    uint64_t writes;        // 写操作数
+    uint64_t failedWrites;
+    uint64_t commits;       // 事务数，writes / commits 即平均每次提交合并的写操作数
+    size_t maxBatch;
+};
+
+/*
+ * WAL 模式下读写互不阻塞：每个工作线程第一次查询时打开自己的只读连接，语句 prepare 后一直复用；
+ * 所有写操作排队交给写线程，写线程把同一时刻攒下的写操作放进一个事务，一次提交只落一次 WAL，
+ * 每个写操作各自一个保存点，单个失败（如用户名重复）只回滚它自己。
+ */
+class SqliteMetaStore : public MetaStore {
+public:
+    explicit SqliteMetaStore(const std::string& path);
+    ~SqliteMetaStore() override;
+
+    bool UserExists(const std::string& username) override;
+    bool GetUserPasswordHash(const std::string& username, std::string& hash, int& userID) override;
+    bool InsertUser(const std::string& username, const std::string& hash, int& userID) override;
+    bool ForEachUsername(const std::function<void(const std::string&)>& fn) override;
+    bool ForEachUserUsage(const std::function<void(int userId, long long bytes)>& fn) override;
+
+    bool InsertFile(const UploadedFileInfo& info) override;
+    bool DeleteFile(const std::string& storedName, int userId,
+                    std::vector<UploadedFileInfo>& removed) override;
+    bool DeleteFiles(const std::vector<std::string>& storedNames, int userId,
+                     std::vector<UploadedFileInfo>& removed) override;
+    bool GetFile(int userId, const std::string& storedName, UploadedFileInfo& info) override;
+    bool ForEachFile(int userId, int limit, const std::string& afterTime, int afterId,
+                     const FileRowFn& fn) override;
+
+    bool ListGarbageBlobs(int limit, std::vector<std::string>& hashes) override;
+    bool RemoveBlob(const std::string& hash) override;
+
+    bool ForEachLegacyFile(int afterId, int limit, const FileRowFn& fn) override;
+    bool AttachBlob(int fileId, const UploadedFileInfo& info) override;
+
+    const char* Name() const override { return "sqlite"; }
+    void LogStats() override;
+    SqliteStoreStats GetStats();
+
+    void Close();   // 写完队列中剩余的写操作后关闭，之后的写操作直接返回 false
+
+private:
+    enum Query {
+        Q_USER_EXISTS = 0,
+        Q_USER_GET_HASH,
+        Q_USER_INSERT,
+        Q_USER_NAMES,
+        Q_FILE_INSERT,
+        Q_FILE_DELETE_ID,
+        Q_FILE_LIST,
+        Q_FILE_PAGE_FIRST,
+        Q_FILE_PAGE_AFTER,
+        Q_FILE_FIND,
+        Q_FILE_GET,
+        Q_BLOB_ADDREF,
+        Q_BLOB_RELEASE,
+        Q_BLOB_GARBAGE,
+        Q_BLOB_REMOVE,
+        Q_FILE_LEGACY,
+        Q_FILE_ATTACH,
+        Q_FILE_USAGE,
+        Q_BEGIN,
+        Q_COMMIT,
+        Q_ROLLBACK,
+        Q_SAVEPOINT,
+        Q_RELEASE,
+        Q_ROLLBACK_TO,
+        Q_COUNT
+    };
+    static const char* const SQL_TEXT[Q_COUNT];
+
+    /* 一条 SQLite 连接和挂在上面的预处理语句，只在一个线程里使用 */
+    struct Conn {
+        sqlite3* db = nullptr;
+        sqlite3_stmt* stmts[Q_COUNT] = {};
+        ~Conn();
+        // 第一次使用时 prepare，之后 reset 并清空绑定后复用
+        sqlite3_stmt* Get(Query id);
+        bool Exec(Query id);    // 执行不带参数、不返回行的语句
+    };
+
+    typedef std::function<bool(Conn&)> WriteOp;
+    struct WriteJob {
+        const WriteOp* op;
+        bool ok;
+        bool done;
+    };
+
+    bool Open_(Conn& conn, bool writer);
+    bool InitSchema_();
+    Conn* ReadConn_();
+    bool Write_(const WriteOp& op);
+    void WriterLoop_();
+    void CommitBatch_(std::vector<WriteJob*>& batch);
+
+    std::string path_;
+    Conn writer_;                      // 只在写线程中使用
+
+    std::deque<WriteJob*> queue_;
+    std::mutex mtx_;
+    std::condition_variable cond_;     // 写线程等待新的写操作
+    std::condition_variable doneCond_; // 调用方等待自己的写操作提交
+    bool isClose_;
+    std::thread writerThread_;
+
+    std::atomic<uint64_t> writes_, failedWrites_, commits_;
+    std::atomic<size_t> maxBatch_;
+};
@@ -0,0 +1,138 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-26 14:05:31
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-26 14:05:31
+ * @Description: HMAC-SHA256 签名的无状态会话 token
+ */
+#include "TokenSigner.h"
+#include "../config/config.h"
+#include "../log/log.h"
+#include <ctime>
+#include <vector>
+#include <cstdlib>
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+TokenSigner::TokenSigner() {
+    secret_ = Config::sessionSecret;
+    if (secret_.empty()) {
+        // 没有配置密钥时随机生成，只在本进程内有效
+        unsigned char key[32];
+        if (RAND_bytes(key, sizeof(key)) != 1) {
+            // 不能用没填满的缓冲区当密钥，secret_ 留空，Ready() 为 false
+            LOG_ERROR("TokenSigner: RAND_bytes failed, no signing key");
+            return;
+        }
+        secret_.assign(reinterpret_cast<char*>(key), sizeof(key));
+        OPENSSL_cleanse(key, sizeof(key));
+        LOG_WARN("TokenSigner: sessionSecret not set, using a random key");
+    }
+}
+
+TokenSigner* TokenSigner::Instance() {
+    static TokenSigner signer;
+    return &signer;
+}
+
+std::string TokenSigner::Issue(int userID, int ttl) {
+    std::string jti;
+    if (!Ready() || !RandomHex_(8, jti)) return "";
+    int64_t now = time(nullptr);
+    std::string payload = std::to_string(userID) + "." + std::to_string(now) + "." +
+                          std::to_string(now + ttl) + "." + jti;
+    return payload + "." + Sign_(payload);
+}
+
+bool TokenSigner::Verify(const std::string& token, SignedToken& out) const {
+    if (!Ready()) return false;
+    size_t sigPos = token.rfind('.');
+    if (sigPos == std::string::npos) return false;
+    std::string payload = token.substr(0, sigPos);
+
+    std::string expected = Sign_(payload);
+    size_t sigLen = token.size() - sigPos - 1;
+    if (sigLen != expected.size() ||
+        CRYPTO_memcmp(token.data() + sigPos + 1, expected.data(), expected.size()) != 0) {
+        return false;
+    }
+
+    // 签名正确后再解析字段
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t dot = payload.find('.', start);
+        fields.push_back(payload.substr(start, dot - start));
+        if (dot == std::string::npos) break;
+        start = dot + 1;
+    }
+    if (fields.size() != 4) return false;
+
+    char* end = nullptr;
+    out.userID = static_cast<int>(strtol(fields[0].c_str(), &end, 10));
+    if (*end != '\0' || out.userID <= 0) return false;
+    out.issuedAt = strtoll(fields[1].c_str(), &end, 10);
+    if (*end != '\0') return false;
+    out.expiresAt = strtoll(fields[2].c_str(), &end, 10);
+    if (*end != '\0') return false;
+    out.jti = fields[3];
+
+    return out.expiresAt > time(nullptr);
+}
+
+bool TokenSigner::LooksSigned(const std::string& token) {
+    // 随机 token 只含字母数字，签名 token 一定带 '.'
+    return token.find('.') != std::string::npos;
+}
+
+std::string TokenSigner::Sign_(const std::string& payload) const {
+    unsigned char mac[EVP_MAX_MD_SIZE];
+    unsigned int macLen = 0;
+    HMAC(EVP_sha256(), secret_.data(), static_cast<int>(secret_.size()),
+         reinterpret_cast<const unsigned char*>(payload.data()), payload.size(),
+         mac, &macLen);
+    return Base64UrlEncode_(mac, macLen);
+}
+
+std::string TokenSigner::Base64UrlEncode_(const unsigned char* data, size_t len) {
+    static const char table[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        uint32_t n = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out += table[(n >> 18) & 63];
+        out += table[(n >> 12) & 63];
+        out += table[(n >> 6) & 63];
+        out += table[n & 63];
+    }
+    if (i + 1 == len) {
+        uint32_t n = data[i] << 16;
+        out += table[(n >> 18) & 63];
+        out += table[(n >> 12) & 63];
+    } else if (i + 2 == len) {
+        uint32_t n = (data[i] << 16) | (data[i + 1] << 8);
+        out += table[(n >> 18) & 63];
+        out += table[(n >> 12) & 63];
+        out += table[(n >> 6) & 63];
+    }
+    return out; // 不带 '=' 填充，可以直接放进 Cookie
+}
+
+bool TokenSigner::RandomHex_(size_t bytes, std::string& out) {
+    static const char hex[] = "0123456789abcdef";
+    std::vector<unsigned char> buf(bytes);
+    if (RAND_bytes(buf.data(), static_cast<int>(bytes)) != 1) {
+        LOG_ERROR("TokenSigner: RAND_bytes failed, token not issued");
+        return false;
+    }
+    out.clear();
+    for (unsigned char c : buf) {
+        out += hex[c >> 4];
+        out += hex[c & 15];
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-06-26 14:05:31
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-06-26 14:05:31
+ * @Description: HMAC-SHA256 签名的无状态会话 token
+ */
+#pragma once
+#include <string>
+#include <cstdint>
+
+struct SignedToken {
+    int userID;
+    int64_t issuedAt;    // 签发时间（秒）
+    int64_t expiresAt;   // 过期时间（秒）
+    std::string jti;     // 随机编号，用于吊销
+};
+
+/*
+ * token 格式：<userID>.<issuedAt>.<expiresAt>.<jti>.<base64url(HMAC-SHA256)>
+ * 签名覆盖最后一个 '.' 之前的全部内容，校验用 CRYPTO_memcmp 做常数时间比较。
+ */
+class TokenSigner {
+public:
+    static TokenSigner* Instance();
+
+    // 随机数生成失败时返回空串，调用方不能签发会话
+    std::string Issue(int userID, int ttl);
+    // 签名正确且未过期返回 true，不检查吊销
+    bool Verify(const std::string& token, SignedToken& out) const;
+
+    static bool LooksSigned(const std::string& token);
+    // 没有可用密钥（未配置且随机生成失败）时为 false，服务器据此拒绝启动
+    bool Ready() const { return !secret_.empty(); }
+
+private:
+    TokenSigner();
+    ~TokenSigner() = default;
+
+    std::string Sign_(const std::string& payload) const;
+
+    static std::string Base64UrlEncode_(const unsigned char* data, size_t len);
+    static bool RandomHex_(size_t bytes, std::string& out);
+
+    std::string secret_;
+};
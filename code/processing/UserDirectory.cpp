@@ -0,0 +1,148 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-09 14:20:36
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-09 14:20:36
+ * @Description: 用户名布隆过滤器和用户缓存
+ */
+#include "UserDirectory.h"
+#include "MetaStore.h"
+#include "../config/config.h"
+#include "../log/log.h"
+#include <algorithm>
+
+UserDirectory::UserDirectory()
+    : bits_(std::max<uint64_t>(64, Config::userBloomBits) / 64),
+      bitCount_(bits_.size() * 64),
+      hashCount_(std::max(1, Config::userBloomHashes)),
+      ready_(false), bloomRejects_(0), hits_(0), misses_(0), evictions_(0), loadedUsers_(0) {
+    for (auto& word : bits_) { word.store(0, std::memory_order_relaxed); }
+    capacityPerShard_ = std::max(1, Config::userCacheCapacity / SHARD_COUNT);
+}
+
+UserDirectory* UserDirectory::Instance() {
+    static UserDirectory dir;
+    return &dir;
+}
+
+void UserDirectory::Hash_(const std::string& username, uint64_t& h1, uint64_t& h2) {
+    // FNV-1a 得到 h1，再用 splitmix64 的混合步骤派生 h2，h2 取奇数保证步长遍历整个位数组
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : username) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h1 = h;
+    h += 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h2 = (h ^ (h >> 31)) | 1;
+}
+
+bool UserDirectory::Load() {
+    if (!Config::userBloomEnabled) return false;
+    size_t count = 0;
+    bool ok = MetaStore::Instance()->ForEachUsername([this, &count](const std::string& username) {
+        Add(username);
+        count++;
+    });
+    if (!ok) {
+        LOG_WARN("UserDirectory: load usernames failed, bloom filter disabled");
+        return false;
+    }
+    // 装入期间注册的用户由 Add 直接写入，不会漏
+    loadedUsers_ = count;
+    ready_ = true;
+    LOG_INFO("UserDirectory: %zu usernames loaded, bloom %llu bits x %d hashes",
+             count, (unsigned long long)bitCount_, hashCount_);
+    return true;
+}
+
+bool UserDirectory::MayExist(const std::string& username) {
+    if (!ready_.load(std::memory_order_acquire)) return true;
+    uint64_t h1, h2;
+    Hash_(username, h1, h2);
+    for (int i = 0; i < hashCount_; i++) {
+        uint64_t bit = (h1 + i * h2) % bitCount_;
+        if (!(bits_[bit / 64].load(std::memory_order_relaxed) & (1ULL << (bit % 64)))) {
+            bloomRejects_++;
+            return false;
+        }
+    }
+    return true;
+}
+
+void UserDirectory::Add(const std::string& username) {
+    uint64_t h1, h2;
+    Hash_(username, h1, h2);
+    for (int i = 0; i < hashCount_; i++) {
+        uint64_t bit = (h1 + i * h2) % bitCount_;
+        bits_[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_relaxed);
+    }
+}
+
+UserDirectory::Shard& UserDirectory::ShardFor_(const std::string& username) {
+    return shards_[std::hash<std::string>()(username) % SHARD_COUNT];
+}
+
+bool UserDirectory::Get(const std::string& username, std::string& hash, int& userID) {
+    Shard& shard = ShardFor_(username);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.index.find(username);
+    if (it == shard.index.end()) {
+        misses_++;
+        return false;
+    }
+    if (it->second->expires <= Clock::now()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        misses_++;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    userID = it->second->userID;
+    hash = it->second->hash;
+    hits_++;
+    return true;
+}
+
+void UserDirectory::Put(const std::string& username, int userID, const std::string& hash) {
+    if (Config::userCacheCapacity <= 0) return;
+    Shard& shard = ShardFor_(username);
+    Clock::time_point expires = Clock::now() + std::chrono::milliseconds(Config::userCacheTtlMs);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.index.find(username);
+    if (it != shard.index.end()) {
+        it->second->userID = userID;
+        it->second->hash = hash;
+        it->second->expires = expires;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+    shard.lru.push_front({username, userID, hash, expires});
+    shard.index[username] = shard.lru.begin();
+    while (shard.index.size() > capacityPerShard_) {
+        shard.index.erase(shard.lru.back().username);
+        shard.lru.pop_back();
+        evictions_++;
+    }
+}
+
+void UserDirectory::Invalidate(const std::string& username) {
+    Shard& shard = ShardFor_(username);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.index.find(username);
+    if (it == shard.index.end()) return;
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+}
+
+UserDirectoryStats UserDirectory::GetStats() const {
+    UserDirectoryStats stats;
+    stats.bloomRejects = bloomRejects_;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    stats.loadedUsers = loadedUsers_;
+    return stats;
+}
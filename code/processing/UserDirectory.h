@@ -0,0 +1,85 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-09 14:20:36
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-09 14:20:36
+ * @Description: 用户名布隆过滤器和 username -> (id, 密码哈希) 缓存，挡在用户表查询前面
+ */
+#pragma once
+#include <list>
+#include <mutex>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+
+struct UserDirectoryStats {
+    uint64_t bloomRejects;  // 过滤器判定用户不存在，没有查库
+    uint64_t hits;          // 缓存命中
+    uint64_t misses;
+    uint64_t evictions;
+    size_t loadedUsers;     // 启动时装入过滤器的用户数
+};
+
+/*
+ * 过滤器启动时从用户表全量装入，之后每次注册追加；装入完成前一律回答“可能存在”，不会误判。
+ * 过滤器只增不减，没有删除用户的路径，所以“不存在”的回答总是可靠的。
+ * 缓存按用户名哈希分片，条目带过期时间，库里改了密码最多晚 userCacheTtlMs 生效，本进程修改时调用 Invalidate。
+ */
+class UserDirectory {
+public:
+    static UserDirectory* Instance();
+
+    // 扫描用户表装入过滤器，失败时过滤器保持关闭
+    bool Load();
+
+    // false 表示用户名一定不存在
+    bool MayExist(const std::string& username);
+    void Add(const std::string& username);
+
+    bool Get(const std::string& username, std::string& hash, int& userID);
+    void Put(const std::string& username, int userID, const std::string& hash);
+    void Invalidate(const std::string& username);
+
+    UserDirectoryStats GetStats() const;
+
+private:
+    UserDirectory();
+    ~UserDirectory() = default;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        std::string username;
+        int userID;
+        std::string hash;
+        Clock::time_point expires;
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        std::list<Entry> lru;  // 头部最近使用
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    Shard& ShardFor_(const std::string& username);
+    // 双重哈希：第 i 个位置取 h1 + i * h2
+    static void Hash_(const std::string& username, uint64_t& h1, uint64_t& h2);
+
+    static const int SHARD_COUNT = 16;
+
+    std::vector<std::atomic<uint64_t>> bits_;
+    uint64_t bitCount_;
+    int hashCount_;
+    std::atomic<bool> ready_;
+
+    Shard shards_[SHARD_COUNT];
+    size_t capacityPerShard_;
+
+    std::atomic<uint64_t> bloomRejects_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> evictions_;
+    size_t loadedUsers_;
+};
@@ -0,0 +1,77 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-18 09:52:30
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-18 09:52:30
+ * @Description: 每个用户已用存储的内存计数，上传请求在读请求体之前据此拒绝超额
+ */
+#include "UserQuota.h"
+#include "MetaStore.h"
+#include "../config/config.h"
+#include "../log/log.h"
+
+UserQuota::UserQuota() : ready_(false), rejects_(0) {}
+
+UserQuota* UserQuota::Instance() {
+    static UserQuota quota;
+    return &quota;
+}
+
+bool UserQuota::Load() {
+    std::unordered_map<int, long long> loaded;
+    long long total = 0;
+    bool ok = MetaStore::Instance()->ForEachUserUsage([&loaded, &total](int userId, long long bytes) {
+        loaded[userId] = bytes;
+        total += bytes;
+    });
+    if (!ok) {
+        LOG_WARN("UserQuota: load usage failed, quota check disabled");
+        return false;
+    }
+    // 在服务启动前调用，此时还没有上传和删除，直接覆盖
+    for (const auto& kv : loaded) {
+        Shard& shard = ShardFor_(kv.first);
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        shard.used[kv.first] = kv.second;
+    }
+    ready_ = true;
+    LOG_INFO("UserQuota: %zu users loaded, %lld bytes in use", loaded.size(), total);
+    return true;
+}
+
+bool UserQuota::Allow(int userId, long long bytes) {
+    if (Config::userQuotaBytes <= 0 || !ready_) return true;
+    if (Used(userId) + bytes <= Config::userQuotaBytes) return true;
+    rejects_++;
+    return false;
+}
+
+long long UserQuota::Used(int userId) {
+    Shard& shard = ShardFor_(userId);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.used.find(userId);
+    return it == shard.used.end() ? 0 : it->second;
+}
+
+void UserQuota::Add(int userId, long long bytes) {
+    if (bytes == 0) return;
+    Shard& shard = ShardFor_(userId);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    long long& used = shard.used[userId];
+    used += bytes;
+    if (used <= 0) {
+        shard.used.erase(userId);   // 文件删光了不留条目
+    }
+}
+
+UserQuotaStats UserQuota::GetStats() {
+    UserQuotaStats stats;
+    stats.users = 0;
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        stats.users += shard.used.size();
+    }
+    stats.rejects = rejects_;
+    stats.loaded = ready_;
+    return stats;
+}
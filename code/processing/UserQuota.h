@@ -0,0 +1,56 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-18 09:52:30
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-18 09:52:30
+ * @Description: 每个用户已用存储的内存计数，上传请求在读请求体之前据此拒绝超额
+ */
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+struct UserQuotaStats {
+    size_t users;        // 有计数的用户数
+    uint64_t rejects;    // 因超出配额被拒绝的上传
+    bool loaded;
+};
+
+/*
+ * 启动时按用户汇总 uploaded_files 装入，之后上传入库时加、删除记录时减，不再查库。
+ * 计数按上传记录算：同一份内容被去重存储，也按每条记录的大小计入各自的用户。
+ * 检查只看请求头里声明的长度，并发上传时可能合计略超配额，下一次上传会被挡住。
+ * 装入失败时不做配额检查，只按请求大小限制。
+ */
+class UserQuota {
+public:
+    static UserQuota* Instance();
+
+    bool Load();
+
+    // 已用 + bytes 不超过 Config::userQuotaBytes；没有配额或计数没装入时总是 true
+    bool Allow(int userId, long long bytes);
+    long long Used(int userId);
+    // 上传入库后加，删除记录后减（bytes 为负）
+    void Add(int userId, long long bytes);
+
+    UserQuotaStats GetStats();
+
+private:
+    UserQuota();
+    ~UserQuota() = default;
+
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<int, long long> used;
+    };
+
+    Shard& ShardFor_(int userId) { return shards_[static_cast<unsigned>(userId) % SHARD_COUNT]; }
+
+    static const int SHARD_COUNT = 16;
+
+    Shard shards_[SHARD_COUNT];
+    std::atomic<bool> ready_;
+    std::atomic<uint64_t> rejects_;
+};
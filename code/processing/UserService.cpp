@@ -2,74 +2,41 @@
  * @Author: Wang
  * @Date: 2025-06-04 10:35:05
  * @LastEditors: 
- * @LastEditTime: 2025-06-23 20:32:38
- * @Description: 
+ * @LastEditTime: 2025-06-30 15:02:11
+ * @Description: 用户查询与注册，先查布隆过滤器和用户缓存，具体读写交给 MetaStore 后端
  */
 #include "UserService.h"
-#include "../pool/sqlconnRAII.h"  // 你项目中的连接池封装
-#include <mysql/mysql.h>
-#include <cstring>
+#include "MetaStore.h"
+#include "UserDirectory.h"
 
 bool UserService::UserExists(const std::string& username) {
-    MYSQL* sql;
-    SqlConnRAII conn(&sql, SqlConnPool::Instance());
-
-    char esc_name[100];
-    mysql_real_escape_string(sql, esc_name, username.c_str(), username.length());
-
-    char query[256];
-    snprintf(query, sizeof(query),
-             "SELECT 1 FROM user WHERE username='%s' LIMIT 1", esc_name);
-
-    if (mysql_query(sql, query)) return false;
-    MYSQL_RES* res = mysql_store_result(sql);
-    bool exists = (mysql_num_rows(res) > 0);
-    mysql_free_result(res);
-    return exists;
+    UserDirectory* dir = UserDirectory::Instance();
+    if (!dir->MayExist(username)) return false;
+    std::string hash;
+    int userID;
+    if (dir->Get(username, hash, userID)) return true;
+    return MetaStore::Instance()->UserExists(username);
 }
 
 bool UserService::GetUserPasswordHash(const std::string& username, std::string& hash, int& userID) {
-    MYSQL* sql;
-    SqlConnRAII conn(&sql, SqlConnPool::Instance());
-
-    char esc_name[100];
-    mysql_real_escape_string(sql, esc_name, username.c_str(), username.length());
-
-    char query[256];
-    snprintf(query, sizeof(query),
-             "SELECT id, password FROM user WHERE username='%s' LIMIT 1", esc_name);
-
-    if (mysql_query(sql, query)) return false;
-    MYSQL_RES* res = mysql_store_result(sql);
-    if (!res) return false;
-
-    MYSQL_ROW row = mysql_fetch_row(res);
-    if (!row) {
-        mysql_free_result(res);
-        return false;
-    }
-
-    userID = std::stoi(row[0]);
-    hash = row[1];
-    mysql_free_result(res);
+    UserDirectory* dir = UserDirectory::Instance();
+    if (!dir->MayExist(username)) return false;  // 不存在的用户名不查库
+    if (dir->Get(username, hash, userID)) return true;
+    if (!MetaStore::Instance()->GetUserPasswordHash(username, hash, userID)) return false;
+    dir->Put(username, userID, hash);
     return true;
 }
 
 bool UserService::InsertNewUser(const std::string& username, const std::string& hash, int& userID) {
-    MYSQL* sql;
-    SqlConnRAII conn(&sql, SqlConnPool::Instance());
-
-    char esc_name[100], esc_hash[256];
-    mysql_real_escape_string(sql, esc_name, username.c_str(), username.length());
-    mysql_real_escape_string(sql, esc_hash, hash.c_str(), hash.length());
-
-    char query[512];
-    snprintf(query, sizeof(query),
-             "INSERT INTO user(username, password) VALUES('%s', '%s')",
-             esc_name, esc_hash);
-
-    if (mysql_query(sql, query)) return false;
-
-    userID = mysql_insert_id(sql);
-    return true;
+    UserDirectory* dir = UserDirectory::Instance();
+    std::string cachedHash;
+    int cachedID;
+    if (dir->Get(username, cachedHash, cachedID)) return false;  // 缓存里有，一定已被占用
+
+    // 不先查是否存在，直接 INSERT，由唯一键判重，没有查与插之间的竞争
+    bool ok = MetaStore::Instance()->InsertUser(username, hash, userID);
+    // 失败多半是用户名已存在（可能是别的进程注册的），同样加进过滤器；真是数据库出错也只是多一次假阳性
+    dir->Add(username);
+    if (ok) { dir->Put(username, userID, hash); } // 注册完通常紧接着登录
+    return ok;
 }
@@ -0,0 +1,321 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-17 16:40:12
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-17 16:40:12
+ * @Description: 只存储不压缩的 ZIP 打包流，边读文件边算 CRC 边发送，超过 4GB 或 65535 个文件时用 ZIP64
+ */
+#include "ZipStream.h"
+#include "../log/log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace {
+
+const uint32_t SIG_LOCAL = 0x04034b50;
+const uint32_t SIG_DESCRIPTOR = 0x08074b50;
+const uint32_t SIG_CENTRAL = 0x02014b50;
+const uint32_t SIG_ZIP64_END = 0x06064b50;
+const uint32_t SIG_ZIP64_LOCATOR = 0x07064b50;
+const uint32_t SIG_END = 0x06054b50;
+
+const uint16_t VERSION_DEFAULT = 20;
+const uint16_t VERSION_ZIP64 = 45;
+const uint16_t MADE_BY_UNIX = 3 << 8;
+const uint16_t FLAG_DESCRIPTOR = 0x0008;   // CRC 和长度在内容之后
+const uint16_t FLAG_UTF8 = 0x0800;         // 文件名按 UTF-8 解释
+const uint16_t EXTRA_ZIP64 = 0x0001;
+
+const uint32_t MAX32 = 0xFFFFFFFF;
+const uint16_t MAX16 = 0xFFFF;
+
+const uint32_t* CrcTable() {
+    static uint32_t table[256];
+    static bool ready = [] {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)ready;
+    return table;
+}
+
+uint32_t Crc32(uint32_t crc, const char* data, size_t len) {
+    const uint32_t* table = CrcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void DosTime(time_t t, uint16_t& dosTime, uint16_t& dosDate) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    if (tm.tm_year < 80) {   // DOS 时间从 1980 年开始
+        dosTime = 0;
+        dosDate = (1 << 5) | 1;
+        return;
+    }
+    dosTime = static_cast<uint16_t>((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+    dosDate = static_cast<uint16_t>(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+}
+
+} // namespace
+
+ZipStream::ZipStream(size_t chunkBytes)
+    : localBytes_(0), centralBytes_(0), chunk_(std::max<size_t>(chunkBytes, 4096)),
+      buf_(static_cast<int>(chunk_ + 1024)), state_(LOCAL), index_(0), fd_(-1),
+      remaining_(0), produced_(0) {}
+
+ZipStream::~ZipStream() {
+    if (fd_ >= 0) { close(fd_); }
+}
+
+uint64_t ZipStream::LocalSize_(const Entry& e) {
+    return 30 + e.name.size() + (e.zip64Size ? 20 : 0);
+}
+
+uint64_t ZipStream::DescriptorSize_(const Entry& e) {
+    return e.zip64Size ? 24 : 16;
+}
+
+uint64_t ZipStream::CentralSize_(const Entry& e) {
+    size_t extra = (e.zip64Size ? 16 : 0) + (e.offset >= MAX32 ? 8 : 0);
+    return 46 + e.name.size() + (extra ? 4 + extra : 0);
+}
+
+bool ZipStream::NeedZip64End_() const {
+    return entries_.size() >= MAX16 || localBytes_ >= MAX32 || centralBytes_ >= MAX32;
+}
+
+bool ZipStream::AddFile(const std::string& name, const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    Entry e;
+    e.name = name;
+    e.path = path;
+    e.size = static_cast<uint64_t>(st.st_size);
+    e.offset = localBytes_;
+    e.crc = 0;
+    e.zip64Size = e.size >= MAX32;
+    DosTime(st.st_mtime, e.dosTime, e.dosDate);
+    localBytes_ += LocalSize_(e) + e.size + DescriptorSize_(e);
+    centralBytes_ += CentralSize_(e);
+    entries_.push_back(std::move(e));
+    return true;
+}
+
+long long ZipStream::Length() const {
+    uint64_t total = localBytes_ + centralBytes_ + 22;
+    if (NeedZip64End_()) { total += 56 + 20; }
+    return static_cast<long long>(total);
+}
+
+void ZipStream::Put16_(uint16_t v) {
+    char b[2] = {static_cast<char>(v), static_cast<char>(v >> 8)};
+    buf_.Append(b, 2);
+}
+
+void ZipStream::Put32_(uint32_t v) {
+    char b[4];
+    for (int i = 0; i < 4; i++) { b[i] = static_cast<char>(v >> (8 * i)); }
+    buf_.Append(b, 4);
+}
+
+void ZipStream::Put64_(uint64_t v) {
+    char b[8];
+    for (int i = 0; i < 8; i++) { b[i] = static_cast<char>(v >> (8 * i)); }
+    buf_.Append(b, 8);
+}
+
+void ZipStream::PutLocal_(const Entry& e) {
+    Put32_(SIG_LOCAL);
+    Put16_(e.zip64Size ? VERSION_ZIP64 : VERSION_DEFAULT);
+    Put16_(FLAG_DESCRIPTOR | FLAG_UTF8);
+    Put16_(0);                                // 存储，不压缩
+    Put16_(e.dosTime);
+    Put16_(e.dosDate);
+    Put32_(0);                                // CRC 在数据描述符里
+    Put32_(e.zip64Size ? MAX32 : 0);
+    Put32_(e.zip64Size ? MAX32 : 0);
+    Put16_(static_cast<uint16_t>(e.name.size()));
+    Put16_(e.zip64Size ? 20 : 0);
+    buf_.Append(e.name);
+    if (e.zip64Size) {
+        // 流式解压的读取方据此知道数据描述符里是 8 字节长度
+        Put16_(EXTRA_ZIP64);
+        Put16_(16);
+        Put64_(0);
+        Put64_(0);
+    }
+}
+
+void ZipStream::PutDescriptor_(const Entry& e) {
+    Put32_(SIG_DESCRIPTOR);
+    Put32_(e.crc);
+    if (e.zip64Size) {
+        Put64_(e.size);
+        Put64_(e.size);
+    } else {
+        Put32_(static_cast<uint32_t>(e.size));
+        Put32_(static_cast<uint32_t>(e.size));
+    }
+}
+
+void ZipStream::PutCentral_(const Entry& e) {
+    bool offset64 = e.offset >= MAX32;
+    uint16_t extra = (e.zip64Size ? 16 : 0) + (offset64 ? 8 : 0);
+    Put32_(SIG_CENTRAL);
+    Put16_(MADE_BY_UNIX | VERSION_ZIP64);
+    Put16_(e.zip64Size || offset64 ? VERSION_ZIP64 : VERSION_DEFAULT);
+    Put16_(FLAG_DESCRIPTOR | FLAG_UTF8);
+    Put16_(0);
+    Put16_(e.dosTime);
+    Put16_(e.dosDate);
+    Put32_(e.crc);
+    Put32_(e.zip64Size ? MAX32 : static_cast<uint32_t>(e.size));
+    Put32_(e.zip64Size ? MAX32 : static_cast<uint32_t>(e.size));
+    Put16_(static_cast<uint16_t>(e.name.size()));
+    Put16_(extra ? extra + 4 : 0);
+    Put16_(0);                                // 注释长度
+    Put16_(0);                                // 起始磁盘
+    Put16_(0);                                // 内部属性
+    Put32_(0100644u << 16);                   // 外部属性：unix 普通文件 0644
+    Put32_(offset64 ? MAX32 : static_cast<uint32_t>(e.offset));
+    buf_.Append(e.name);
+    if (extra) {
+        // 只放取值为 0xFFFFFFFF 的字段，顺序固定为原始长度、压缩后长度、本地头位置
+        Put16_(EXTRA_ZIP64);
+        Put16_(extra);
+        if (e.zip64Size) {
+            Put64_(e.size);
+            Put64_(e.size);
+        }
+        if (offset64) { Put64_(e.offset); }
+    }
+}
+
+void ZipStream::PutEnd_() {
+    uint64_t count = entries_.size();
+    if (NeedZip64End_()) {
+        uint64_t zip64EndOffset = localBytes_ + centralBytes_;
+        Put32_(SIG_ZIP64_END);
+        Put64_(44);                           // 本记录除去前 12 字节的长度
+        Put16_(MADE_BY_UNIX | VERSION_ZIP64);
+        Put16_(VERSION_ZIP64);
+        Put32_(0);
+        Put32_(0);
+        Put64_(count);
+        Put64_(count);
+        Put64_(centralBytes_);
+        Put64_(localBytes_);
+        Put32_(SIG_ZIP64_LOCATOR);
+        Put32_(0);
+        Put64_(zip64EndOffset);
+        Put32_(1);
+    }
+    uint16_t count16 = count >= MAX16 ? MAX16 : static_cast<uint16_t>(count);
+    Put32_(SIG_END);
+    Put16_(0);
+    Put16_(0);
+    Put16_(count16);
+    Put16_(count16);
+    Put32_(centralBytes_ >= MAX32 ? MAX32 : static_cast<uint32_t>(centralBytes_));
+    Put32_(localBytes_ >= MAX32 ? MAX32 : static_cast<uint32_t>(localBytes_));
+    Put16_(0);
+}
+
+bool ZipStream::ReadData_() {
+    Entry& e = entries_[index_];
+    size_t room = chunk_ > buf_.ReadableBytes() ? chunk_ - buf_.ReadableBytes() : 0;
+    size_t want = static_cast<size_t>(std::min<uint64_t>(room, remaining_));
+    if (want == 0) return true;
+    buf_.EnsureWriteable(want);
+    ssize_t n = read(fd_, buf_.BeginWrite(), want);
+    if (n < 0 && errno == EINTR) return true;
+    if (n <= 0) {
+        // 长度已经写进 Content-Length 和中央目录，文件变短就没法补齐了
+        LOG_WARN("ZipStream: read %s failed: %s", e.path.c_str(), n < 0 ? strerror(errno) : "file shrank");
+        return false;
+    }
+    e.crc = Crc32(e.crc, buf_.BeginWrite(), n);   // 读进发送缓冲区的同时算 CRC，不多一遍拷贝
+    buf_.HasWritten(n);
+    remaining_ -= n;
+    return true;
+}
+
+bool ZipStream::Step_() {
+    switch (state_) {
+    case LOCAL: {
+        if (index_ == entries_.size()) {
+            state_ = CENTRAL;
+            index_ = 0;
+            return true;
+        }
+        const Entry& e = entries_[index_];
+        fd_ = open(e.path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd_ < 0 || fstat(fd_, &st) != 0 || static_cast<uint64_t>(st.st_size) != e.size) {
+            LOG_WARN("ZipStream: %s changed since listing", e.path.c_str());
+            return false;
+        }
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        PutLocal_(e);
+        remaining_ = e.size;
+        state_ = DATA;
+        return true;
+    }
+    case DATA:
+        if (remaining_ == 0) {
+            close(fd_);
+            fd_ = -1;
+            state_ = DESCRIPTOR;
+            return true;
+        }
+        return ReadData_();
+    case DESCRIPTOR:
+        PutDescriptor_(entries_[index_]);
+        index_++;
+        state_ = LOCAL;
+        return true;
+    case CENTRAL:
+        if (index_ == entries_.size()) {
+            state_ = END;
+            return true;
+        }
+        PutCentral_(entries_[index_++]);
+        return true;
+    case END:
+        PutEnd_();
+        state_ = DONE;
+        return true;
+    case DONE:
+        return true;
+    }
+    return false;
+}
+
+bool ZipStream::Next(const char*& data, size_t& len) {
+    buf_.RetrieveAll();
+    while (state_ != DONE && buf_.ReadableBytes() < chunk_) {
+        if (!Step_()) return false;
+    }
+    data = buf_.Peek();
+    len = buf_.ReadableBytes();
+    produced_ += len;
+    if (state_ == DONE && len == 0 && produced_ != static_cast<uint64_t>(Length())) {
+        LOG_ERROR("ZipStream: produced %llu bytes, expected %lld", (unsigned long long)produced_, Length());
+        return false;
+    }
+    return true;
+}
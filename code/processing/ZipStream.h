@@ -0,0 +1,76 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-17 16:40:12
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-17 16:40:12
+ * @Description: 只存储不压缩的 ZIP 打包流，边读文件边算 CRC 边发送，超过 4GB 或 65535 个文件时用 ZIP64
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ctime>
+#include "../http/bodystream.h"
+#include "../buffer/buffer.h"
+
+/*
+ * 格式按 PKWARE APPNOTE：
+ *   [本地文件头 + 文件内容 + 数据描述符] * N + 中央目录 + [ZIP64 目录结束记录 + 定位器] + 目录结束记录
+ * CRC 要等内容读完才知道，本地文件头里置 0 并设标志位 3，真实值写在内容后面的数据描述符和中央目录里。
+ * 不压缩，每一项的长度在 AddFile 时就确定了，整个归档的长度可以先算出来作为 Content-Length。
+ * 临时文件一个不落，内存只有一块发送缓冲区加上每个文件几十字节的目录信息。
+ */
+class ZipStream : public BodyStream {
+public:
+    explicit ZipStream(size_t chunkBytes);
+    ~ZipStream() override;
+
+    // 按 stat 的结果登记一个文件，不存在或不是普通文件返回 false；必须在第一次 Next 之前加完
+    bool AddFile(const std::string& name, const std::string& path);
+    size_t Count() const { return entries_.size(); }
+
+    long long Length() const override;
+    bool Next(const char*& data, size_t& len) override;
+
+private:
+    struct Entry {
+        std::string name;
+        std::string path;
+        uint64_t size;
+        uint64_t offset;     // 本地文件头在归档中的位置
+        uint16_t dosTime;
+        uint16_t dosDate;
+        uint32_t crc;
+        bool zip64Size;      // 内容 >= 4GB：本地头带 ZIP64 扩展，数据描述符用 8 字节长度
+    };
+
+    enum State { LOCAL, DATA, DESCRIPTOR, CENTRAL, END, DONE };
+
+    static uint64_t LocalSize_(const Entry& e);
+    static uint64_t CentralSize_(const Entry& e);
+    static uint64_t DescriptorSize_(const Entry& e);
+    bool NeedZip64End_() const;
+
+    bool Step_();
+    void PutLocal_(const Entry& e);
+    void PutDescriptor_(const Entry& e);
+    void PutCentral_(const Entry& e);
+    void PutEnd_();
+    bool ReadData_();
+
+    void Put16_(uint16_t v);
+    void Put32_(uint32_t v);
+    void Put64_(uint64_t v);
+
+    std::vector<Entry> entries_;
+    uint64_t localBytes_;    // 所有本地文件头 + 内容 + 描述符，即中央目录的起始位置
+    uint64_t centralBytes_;
+
+    size_t chunk_;
+    Buffer buf_;
+    State state_;
+    size_t index_;
+    int fd_;
+    uint64_t remaining_;     // 当前文件还没读的字节数
+    uint64_t produced_;
+};
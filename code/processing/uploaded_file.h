@@ -13,4 +13,17 @@ struct UploadedFile {
     std::string filename;
     std::string content;
     std::string contentType;
+};
+
+/* uploaded_files 表中的一行 */
+struct UploadedFileInfo {
+    int id;
+    std::string original_filename;
+    std::string stored_filename;
+    std::string file_path;
+    long long file_size;
+    std::string upload_time;
+    std::string file_type;
+    int uploader_id;
+    std::string content_hash;   // 内容的 SHA-256（十六进制），为空表示去重存储之前直接按文件名保存的旧文件
 };
\ No newline at end of file
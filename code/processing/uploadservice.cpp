@@ -8,148 +8,121 @@
 #include "uploadservice.h"
 #include <fstream>
 #include <filesystem>
-#include <mysql/mysql.h>
-#include "../pool/sqlconnpool.h"
+#include <cctype>
+#include <cstdint>
 #include "../processing/uploaded_file.h"
+#include "MetaStore.h"
+#include "BlobStore.h"
+#include "DiskWriter.h"
+#include "FileListCache.h"
+#include "FileReclaimer.h"
+#include "UserQuota.h"
+#include "FileSearchIndex.h"
 
 bool UploadService::SaveUploadedFile(const UploadedFile& file, int user_id) {
-    std::string filepath = "./resources/images/" + file.filename;
-
-    std::ofstream ofs(filepath, std::ios::binary);
-    if (!ofs.is_open()) return false;
-    ofs.write(file.content.data(), file.content.size());
-    ofs.close();
-
-    MYSQL* sql = nullptr;
-    SqlConnRAII(&sql, SqlConnPool::Instance());
-
-    char esc_name[256], esc_store[256], esc_path[256];
-    mysql_real_escape_string(sql, esc_name, file.filename.c_str(), file.filename.length());
-    mysql_real_escape_string(sql, esc_store, file.filename.c_str(), file.filename.length());
-    mysql_real_escape_string(sql, esc_path, filepath.c_str(), filepath.length());
-
-    std::string query = "INSERT INTO uploaded_files (original_filename, stored_filename, file_path, file_size, upload_time, file_type, uploader_id) VALUES ('" +
-                        std::string(esc_name) + "','" +
-                        std::string(esc_store) + "','" +
-                        std::string(esc_path) + "'," +
-                        std::to_string(file.content.size()) + ",NOW(),'" +
-                        file.contentType + "'," +
-                        std::to_string(user_id) + ");";
+    // 内容先写临时文件并同时计算摘要，按 Config::uploadFsync 落盘后放进 BlobStore；不同用户的同名文件互不覆盖
+    DiskWriteResult result;
+    DiskWriter::WriteNow(file, user_id, result);
+    return result.ok;
+}
 
-    bool ok = mysql_query(sql, query.c_str()) == 0;
-    SqlConnPool::Instance()->FreeConn(sql);
+UploadedFileInfo UploadService::MakeInfo(const std::string& filename, const std::string& contentType, int user_id) {
+    UploadedFileInfo info;
+    info.id = 0;
+    info.original_filename = filename;
+    info.stored_filename = filename;
+    info.file_size = 0;
+    info.file_type = contentType;
+    info.uploader_id = user_id;
+    return info;
+}
 
+bool UploadService::CommitBlob(BlobWriter& writer, const std::string& filename,
+                               const std::string& contentType, int user_id) {
+    UploadedFileInfo info = MakeInfo(filename, contentType, user_id);
+    bool ok = BlobStore::Instance()->Commit(writer, info);
+    FileListCache::Instance()->Invalidate(user_id); // 列表已变化，下次查看时重新生成
     return ok;
 }
 
 
 bool UploadService::DeleteFile(const std::string& filename, int user_id) {
-    std::string filepath = "./resources/images/" + filename;
-
-    // 删除文件
-    if (!std::filesystem::exists(filepath)) return false;
-    if (!std::filesystem::remove(filepath)) return false;
+    std::vector<std::string> deleted;
+    return DeleteFiles(std::vector<std::string>{filename}, user_id, deleted) && !deleted.empty();
+}
 
-    // 删除数据库记录
-    MYSQL* sql = nullptr;
-    SqlConnRAII(&sql, SqlConnPool::Instance());
-    std::string query = "DELETE FROM uploaded_files WHERE stored_filename='" +
-                        filename + "' AND uploader_id=" + std::to_string(user_id);
+bool UploadService::DeleteFiles(const std::vector<std::string>& filenames, int user_id,
+                                std::vector<std::string>& deleted) {
+    // 只删数据库记录并释放引用，文件由 BlobStore / FileReclaimer 在后台回收，请求不等磁盘
+    std::vector<UploadedFileInfo> removed;
+    bool ok = MetaStore::Instance()->DeleteFiles(filenames, user_id, removed);
+    FileListCache::Instance()->Invalidate(user_id);
+    if (!ok) return false;
+
+    bool garbage = false;
+    long long freed = 0;
+    for (const UploadedFileInfo& info : removed) {
+        freed += info.file_size;
+        if (deleted.empty() || deleted.back() != info.stored_filename) {
+            deleted.push_back(info.stored_filename);   // 同名的多条记录按文件名只报一次
+        }
+        if (info.content_hash.empty()) {
+            FileReclaimer::Instance()->Discard(info.file_path); // 去重存储之前的文件只属于这一条记录，回收线程去删
+        } else {
+            garbage = true;
+        }
+    }
+    UserQuota::Instance()->Add(user_id, -freed);
+    FileSearchIndex::Instance()->Remove(user_id, removed);
+    if (garbage) { BlobStore::Instance()->NotifyGarbage(); }
+    return true;
+}
 
-    bool ok = mysql_query(sql, query.c_str()) == 0;
-    SqlConnPool::Instance()->FreeConn(sql);
-    return ok;
+bool UploadService::GetFile(int userId, const std::string& filename, UploadedFileInfo& info) {
+    return MetaStore::Instance()->GetFile(userId, filename, info);
 }
 
 std::vector<UploadedFileInfo> UploadService::QueryAllFiles(int userId) {
     std::vector<UploadedFileInfo> result;
+    QueryAllFiles(userId, result);
+    return result;
+}
 
-    MYSQL* sql;
-    SqlConnRAII(&sql, SqlConnPool::Instance());
-
-    const char* query =
-        "SELECT original_filename, stored_filename, file_path, file_size, "
-        "upload_time, file_type, uploader_id FROM uploaded_files "
-        "WHERE uploader_id = ? ORDER BY upload_time DESC";
-
-    MYSQL_STMT* stmt = mysql_stmt_init(sql);
-    if (!stmt || mysql_stmt_prepare(stmt, query, strlen(query)) != 0) {
-        LOG_ERROR("MySQL 预处理失败: %s", mysql_error(sql));
-        return result;
-    }
-
-    MYSQL_BIND bind_param{};
-    memset(&bind_param, 0, sizeof(bind_param));
-    bind_param.buffer_type = MYSQL_TYPE_LONG;
-    bind_param.buffer = (char*)&userId;
+bool UploadService::QueryAllFiles(int userId, std::vector<UploadedFileInfo>& result) {
+    return ForEachFile(userId, 0, "", [&result](const UploadedFileInfo& info) {
+        result.push_back(info);
+    });
+}
 
-    if (mysql_stmt_bind_param(stmt, &bind_param) != 0) {
-        LOG_ERROR("MySQL 参数绑定失败: %s", mysql_stmt_error(stmt));
-        mysql_stmt_close(stmt);
-        return result;
-    }
+bool UploadService::ForEachFile(int userId, int limit, const std::string& after,
+                                const std::function<void(const UploadedFileInfo&)>& fn) {
+    std::string afterTime;
+    int afterId = 0;
+    if (!after.empty() && !ParseCursor(after, afterTime, afterId)) return false;
 
-    if (mysql_stmt_execute(stmt) != 0) {
-        LOG_ERROR("MySQL 执行失败: %s", mysql_stmt_error(stmt));
-        mysql_stmt_close(stmt);
-        return result;
-    }
+    return MetaStore::Instance()->ForEachFile(userId, limit, afterTime, afterId, fn);
+}
 
-    MYSQL_RES* prepare_meta_result = mysql_stmt_result_metadata(stmt);
-    if (!prepare_meta_result) {
-        LOG_ERROR("MySQL 获取结果元数据失败: %s", mysql_stmt_error(stmt));
-        mysql_stmt_close(stmt);
-        return result;
+std::string UploadService::MakeCursor(const UploadedFileInfo& info) {
+    // upload_time 形如 2025-07-02 10:12:40，只保留数字
+    std::string cursor;
+    for (char c : info.upload_time) {
+        if (isdigit((unsigned char)c)) cursor += c;
     }
+    return cursor + "_" + std::to_string(info.id);
+}
 
-    // 准备接收数据
-    char orig[256], stored[256], path[256], time[64], type[64];
-    int size = 0, uid = 0;
-
-    MYSQL_BIND bind_result[7]{};
-    memset(bind_result, 0, sizeof(bind_result));
-
-    bind_result[0].buffer_type = MYSQL_TYPE_STRING;
-    bind_result[0].buffer = orig;
-    bind_result[0].buffer_length = sizeof(orig);
-
-    bind_result[1].buffer_type = MYSQL_TYPE_STRING;
-    bind_result[1].buffer = stored;
-    bind_result[1].buffer_length = sizeof(stored);
-
-    bind_result[2].buffer_type = MYSQL_TYPE_STRING;
-    bind_result[2].buffer = path;
-    bind_result[2].buffer_length = sizeof(path);
-
-    bind_result[3].buffer_type = MYSQL_TYPE_LONG;
-    bind_result[3].buffer = (char*)&size;
-
-    bind_result[4].buffer_type = MYSQL_TYPE_STRING;
-    bind_result[4].buffer = time;
-    bind_result[4].buffer_length = sizeof(time);
-
-    bind_result[5].buffer_type = MYSQL_TYPE_STRING;
-    bind_result[5].buffer = type;
-    bind_result[5].buffer_length = sizeof(type);
-
-    bind_result[6].buffer_type = MYSQL_TYPE_LONG;
-    bind_result[6].buffer = (char*)&uid;
-
-    mysql_stmt_bind_result(stmt, bind_result);
-
-    while (mysql_stmt_fetch(stmt) == 0) {
-        UploadedFileInfo info;
-        info.original_filename = orig;
-        info.stored_filename = stored;
-        info.file_path = path;
-        info.file_size = size;
-        info.upload_time = time;
-        info.file_type = type;
-        info.uploader_id = uid;
-        result.push_back(info);
+bool UploadService::ParseCursor(const std::string& cursor, std::string& uploadTime, int& id) {
+    size_t pos = cursor.find('_');
+    if (pos != 14 || pos + 1 >= cursor.size() || cursor.size() - pos - 1 > 10) return false;
+    for (size_t i = 0; i < cursor.size(); i++) {
+        if (i != pos && !isdigit((unsigned char)cursor[i])) return false;
     }
-
-    mysql_free_result(prepare_meta_result);
-    mysql_stmt_close(stmt);
-    return result;
+    const std::string t = cursor.substr(0, 14);
+    uploadTime = t.substr(0, 4) + "-" + t.substr(4, 2) + "-" + t.substr(6, 2) + " "
+               + t.substr(8, 2) + ":" + t.substr(10, 2) + ":" + t.substr(12, 2);
+    long long v = std::stoll(cursor.substr(pos + 1));
+    if (v > INT32_MAX) return false;
+    id = static_cast<int>(v);
+    return true;
 }
@@ -7,23 +7,37 @@
  */
 #pragma once
 #include <string>
+#include <functional>
 #include "../http/httprequest.h"
+#include "uploaded_file.h"
+#include "BlobStore.h"
 #include <unistd.h>    // crypt
 #include <cstring>     // strcmp
 
-struct UploadedFileInfo {
-    std::string original_filename;
-    std::string stored_filename;
-    std::string file_path;
-    int file_size;
-    std::string upload_time;
-    std::string file_type;
-    int uploader_id;
-};
-
 class UploadService {
 public:
+    // 在调用线程上同步写盘入库；请求路径经 DiskWriter 在写盘线程上完成
     static bool SaveUploadedFile(const UploadedFile& file, int user_id);
-    static bool DeleteFile(const std::string& filename, int user_id); 
+    // 新上传记录中由调用方决定的部分，路径、大小、摘要在入库时填写
+    static UploadedFileInfo MakeInfo(const std::string& filename, const std::string& contentType, int user_id);
+    // 引用计数减一，内容由 BlobStore 后台回收
+    static bool DeleteFile(const std::string& filename, int user_id);
+    // 批量删除，deleted 输出确实删掉了的文件名；只有查询失败返回 false
+    static bool DeleteFiles(const std::vector<std::string>& filenames, int user_id,
+                            std::vector<std::string>& deleted);
+    // 已经写进 writer 的内容按摘要入库并插入上传记录
+    static bool CommitBlob(BlobWriter& writer, const std::string& filename,
+                           const std::string& contentType, int user_id);
+    static bool GetFile(int userId, const std::string& filename, UploadedFileInfo& info);
     static std::vector<UploadedFileInfo> QueryAllFiles(int userId);
+    // 查询失败返回 false，用于区分“没有文件”和“查不出来”
+    static bool QueryAllFiles(int userId, std::vector<UploadedFileInfo>& result);
+
+    // 按 (upload_time, id) 倒序逐行回调，最多 limit 行，不在内存里攒整张结果；
+    // after 为上一页最后一行的游标，空串表示第一页。游标非法或查询失败返回 false
+    static bool ForEachFile(int userId, int limit, const std::string& after,
+                            const std::function<void(const UploadedFileInfo&)>& fn);
+    // 游标格式 <yyyymmddhhmmss>_<id>
+    static std::string MakeCursor(const UploadedFileInfo& info);
+    static bool ParseCursor(const std::string& cursor, std::string& uploadTime, int& id);
 };
\ No newline at end of file
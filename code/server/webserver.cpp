@@ -21,9 +21,29 @@ WebServer::WebServer(
     strncat(srcDir_, "/resources", 16); // 设置http静态资源的目录
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
-    SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum); // 初始化单例模式的数据库连接池
+    if (Config::metaBackend == MetaBackend::MYSQL) {
+        SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum); // 初始化单例模式的数据库连接池
+        SqlRouter::Instance()->Init(sqlUser, sqlPwd, dbName, connPoolNum); // 配置了从库时读请求分到从库
+    }
+    MetaStore::Instance(); // 按配置创建元数据存储后端，SQLite 模式在这里建库建表
+    UserDirectory::Instance()->Load(); // 用户名装入布隆过滤器，不存在的用户名登录/查询不再查库
+    UserQuota::Instance()->Load(); // 按用户汇总已用存储，超额上传在请求头到齐时就拒绝
+    FileReclaimer::Instance()->Start(); // 删掉的文件在这里限速释放，接着删上次没删完的
+    BlobStore::Instance()->Start(); // 后台回收引用归零的上传内容
+    ResumableUpload::Instance()->Start(); // 恢复断点续传目录，清掉过期会话
+    DiskWriter::Instance()->Start(Config::diskWriterThreads, Config::diskWriterQueueMax); // 上传内容在写盘线程上落盘入库
+    if (Config::sessionBackend == SessionBackend::REDIS) {
+        RedisPool::Instance()->Init(Config::redisHost, Config::redisPort,
+                                    Config::redisPoolSize, Config::redisWaitTimeoutMs); // 所有连接共享的 Redis 连接池
+    }
+    SessionStore::Instance(); // 按配置创建会话存储后端
+    if (Config::sessionMode == SessionMode::SIGNED && !TokenSigner::Instance()->Ready()) {
+        isClose_ = true; // 没有签名密钥，发不出可信的 token，不启动
+    }
+    SessionRefresher::Instance()->Start(Config::sessionTTL, Config::sessionRefreshIntervalMs); // 会话滑动续期
     InitEventMode_(trigMode); // 初始化连接和监听的事件模式(LT/ET)
     if(!InitSocket_()) { isClose_ = true;} // 套接字初始化
+    InitDbExecutor_(); // 数据库查询交给 DB 线程，完成通知走 eventfd
 
     if(openLog) {
         // 初始化日志系统
@@ -37,7 +57,10 @@ WebServer::WebServer(
                             (connEvent_ & EPOLLET ? "ET": "LT"));
             LOG_INFO("LogSys level: %d", logLevel);
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
-            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            LOG_INFO("MetaStore: %s, SqlConnPool num: %d, ThreadPool num: %d",
+                     MetaStore::Instance()->Name(), connPoolNum, threadNum);
+            LOG_INFO("SessionStore: %s, RedisPool size: %d, waitTimeout: %dms",
+                     SessionStore::Instance()->Name(), Config::redisPoolSize, Config::redisWaitTimeoutMs);
         }
     }
 }
@@ -47,7 +70,55 @@ WebServer::~WebServer() {
     close(listenFd_); // 关闭监听socket
     isClose_ = true; // 连接标志位设为true，表示关闭连接
     free(srcDir_);
-    SqlConnPool::Instance()->ClosePool(); // 关闭数据库连接池
+    DiskWriter::Instance()->Stop(); // 已接收的上传写完，它的完成回调还要经过 DbExecutor
+    DbExecutor::Instance()->Stop(); // 先让在途查询跑完，再关连接池
+    DiskWriterStats dw = DiskWriter::Instance()->GetStats();
+    LOG_INFO("DiskWriter submitted:%llu completed:%llu failed:%llu rejected:%llu batches:%llu maxBatch:%zu peakQueued:%zu",
+             (unsigned long long)dw.submitted, (unsigned long long)dw.completed, (unsigned long long)dw.failed,
+             (unsigned long long)dw.rejected, (unsigned long long)dw.batches, dw.maxBatch, dw.peakQueued);
+    BlobStore::Instance()->Stop();
+    BlobStoreStats bs = BlobStore::Instance()->GetStats();
+    LOG_INFO("BlobStore stored:%llu dedupHits:%llu bytesSaved:%llu reclaimed:%llu reclaimFailures:%llu fileSyncs:%llu groupSyncs:%llu",
+             (unsigned long long)bs.stored, (unsigned long long)bs.dedupHits, (unsigned long long)bs.bytesSaved,
+             (unsigned long long)bs.reclaimed, (unsigned long long)bs.reclaimFailures,
+             (unsigned long long)bs.fileSyncs, (unsigned long long)bs.groupSyncs);
+    FileReclaimer::Instance()->Stop(); // 没删完的留在回收目录里，下次启动接着删
+    FileReclaimerStats rs = FileReclaimer::Instance()->GetStats();
+    LOG_INFO("FileReclaimer staged:%llu reclaimed:%llu bytes:%llu retries:%llu failures:%llu queued:%zu",
+             (unsigned long long)rs.staged, (unsigned long long)rs.reclaimed, (unsigned long long)rs.bytes,
+             (unsigned long long)rs.retries, (unsigned long long)rs.failures, rs.queued);
+    SessionRefresher::Instance()->Stop(); // 退出前把积攒的续期刷出去
+    RedisPool::Instance()->LogStats(); // 退出前输出 Redis 连接池统计
+    SessionCacheStats cs = SessionCache::Instance()->GetStats();
+    LOG_INFO("SessionCache hits:%llu negHits:%llu misses:%llu evictions:%llu",
+             (unsigned long long)cs.hits, (unsigned long long)cs.negHits,
+             (unsigned long long)cs.misses, (unsigned long long)cs.evictions);
+    FileListCacheStats fs = FileListCache::Instance()->GetStats();
+    LOG_INFO("FileListCache hits:%llu misses:%llu coalesced:%llu evictions:%llu invalidations:%llu staleRetries:%llu entries:%zu bytes:%zu",
+             (unsigned long long)fs.hits, (unsigned long long)fs.misses, (unsigned long long)fs.coalesced,
+             (unsigned long long)fs.evictions, (unsigned long long)fs.invalidations,
+             (unsigned long long)fs.staleRetries, fs.entries, fs.bytes);
+    DbExecutorStats ds = DbExecutor::Instance()->GetStats();
+    LOG_INFO("DbExecutor submitted:%llu completed:%llu rejected:%llu peakQueued:%zu",
+             (unsigned long long)ds.submitted, (unsigned long long)ds.completed,
+             (unsigned long long)ds.rejected, ds.peakQueued);
+    UserDirectoryStats us = UserDirectory::Instance()->GetStats();
+    LOG_INFO("UserDirectory loaded:%zu bloomRejects:%llu hits:%llu misses:%llu evictions:%llu",
+             us.loadedUsers, (unsigned long long)us.bloomRejects, (unsigned long long)us.hits,
+             (unsigned long long)us.misses, (unsigned long long)us.evictions);
+    UserQuotaStats qs = UserQuota::Instance()->GetStats();
+    LOG_INFO("UserQuota loaded:%d users:%zu rejects:%llu", qs.loaded ? 1 : 0, qs.users, (unsigned long long)qs.rejects);
+    FileSearchStats ss = FileSearchIndex::Instance()->GetStats();
+    LOG_INFO("FileSearchIndex queries:%llu builds:%llu evictions:%llu users:%zu files:%zu",
+             (unsigned long long)ss.queries, (unsigned long long)ss.builds,
+             (unsigned long long)ss.evictions, ss.users, ss.files);
+    MetaStore::Instance()->LogStats();
+    if (Config::metaBackend == MetaBackend::MYSQL) {
+        SqlRouter::Instance()->LogStats();
+        SqlRouter::Instance()->Close();
+        SqlConnPool::Instance()->LogStats();
+        SqlConnPool::Instance()->ClosePool(); // 关闭数据库连接池
+    }
 }
 
 // 初始化WebServer事件触发模式
@@ -91,6 +162,9 @@ void WebServer::Start() {
             if(fd == listenFd_) {
                 DealListen_();
             }
+            else if(fd == dbEventFd_) {
+                DealDbCompletions_();
+            }
             else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
                 CloseConn_(&users_[fd]);
             }
@@ -180,6 +254,27 @@ void WebServer::DealListen_() {
 }
 
 
+void WebServer::InitDbExecutor_() {
+    DbExecutor::Instance()->Start(Config::dbIoThreads, Config::dbQueueMax);
+    dbEventFd_ = DbExecutor::Instance()->EventFd();
+    if(dbEventFd_ < 0 || !epoller_->AddFd(dbEventFd_, EPOLLIN)) {
+        // 没有完成通知就不能异步，停掉执行器，请求退回同步执行
+        DbExecutor::Instance()->Stop();
+        dbEventFd_ = -1;
+        return;
+    }
+    HttpConn::asyncDone = [this](HttpConn* client) {
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT); // 响应已构造好，和同步路径一样等待可写
+    };
+}
+
+void WebServer::DealDbCompletions_() {
+    // 查询完成后的响应构造交给线程池，事件循环只负责分发
+    for(auto& done : DbExecutor::Instance()->TakeCompletions()) {
+        threadpool_->AddTask(std::move(done));
+    }
+}
+
 // 处理读事件
 void WebServer::DealRead_(HttpConn* client) {
     ExtentTime_(client);
@@ -208,7 +303,7 @@ void WebServer::OnRead_(HttpConn* client) {
     读取成功就进一步处理OnProcess
     */
     
-    int ret = -1;
+    ssize_t ret = -1;   // PUT 请求体一次 splice 进文件的字节数可能超过 2GB，不能截成 int
     int readErrno = 0;
     ret = client->read(&readErrno);
     cout<<"从客户端读取了"<<ret<<"字节"<<endl;
@@ -232,11 +327,13 @@ void WebServer::OnProcess(HttpConn* client) {
         case HttpConn::PROCESS_STATE::AGAIN:
             epoller_->ModFd(fd, connEvent_ | EPOLLIN); // 数据还不够，继续读
             break;
+        case HttpConn::PROCESS_STATE::PENDING:
+            break; // 等数据库回调调用 asyncDone 再注册写事件，期间 EPOLLONESHOT 保持未武装
     }
 }
 
 void WebServer::OnWrite_(HttpConn* client) {
-    int ret = -1;
+    ssize_t ret = -1;
     int writeErrno = 0;
     ret = client->write(&writeErrno);
     if(client->ToWriteBytes() == 0) {
@@ -246,12 +343,10 @@ void WebServer::OnWrite_(HttpConn* client) {
             return;
         }
     }
-    else if(ret < 0) {
-        if(writeErrno == EAGAIN) {
-            /* 继续传输 */
-            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
-            return;
-        }
+    else if(ret > 0 || (ret < 0 && writeErrno == EAGAIN)) {
+        /* 继续传输；LT 模式下剩余不到 10240 字节时 write 也会带着没发完的数据返回 */
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+        return;
     }
     CloseConn_(client);
 }
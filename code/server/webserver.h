@@ -22,6 +22,23 @@
 #include "../pool/sqlconnpool.h"
 #include "../pool/threadpool.h"
 #include "../pool/sqlconnRAII.h"
+#include "../pool/sqlrouter.h"
+#include "../pool/dbexecutor.h"
+#include "../pool/redispool.h"
+#include "../config/config.h"
+#include "../processing/SessionCache.h"
+#include "../processing/SessionStore.h"
+#include "../processing/SessionRefresher.h"
+#include "../processing/TokenSigner.h"
+#include "../processing/FileListCache.h"
+#include "../processing/MetaStore.h"
+#include "../processing/UserDirectory.h"
+#include "../processing/UserQuota.h"
+#include "../processing/FileSearchIndex.h"
+#include "../processing/BlobStore.h"
+#include "../processing/FileReclaimer.h"
+#include "../processing/ResumableUpload.h"
+#include "../processing/DiskWriter.h"
 #include "../http/httpconn.h"
 
 class WebServer {
@@ -43,6 +60,8 @@ private:
     void DealListen_();
     void DealWrite_(HttpConn* client);
     void DealRead_(HttpConn* client);
+    void InitDbExecutor_();
+    void DealDbCompletions_();
 
     void SendError_(int fd, const char*info);
     void ExtentTime_(HttpConn* client);
@@ -61,6 +80,7 @@ private:
     int timeoutMS_;  /* 毫秒MS */
     bool isClose_;
     int listenFd_;
+    int dbEventFd_ = -1;
     char* srcDir_;
     
     uint32_t listenEvent_;
@@ -0,0 +1,116 @@
+#!/bin/bash
+# @Author       : Wang
+# @Date         : 2025-07-22
+# @Description  : 大文件端到端检查：超过 4GB 的稀疏文件经 PUT /files/ 和 POST /upload 上传，
+#                 再单独下载和打包下载，核对长度、SHA-256 和 ZIP64 结构
+#
+# 用法：code/tests/large_file.sh [服务地址] [文件字节数]
+#   默认 http://127.0.0.1:1316，文件 4GB + 4097 字节。服务器要先启动，Config::maxUploadBytes 要大于文件大小；
+#   两次上传内容相同只存一份，服务器的 uploadRoot 所在磁盘至少留出两倍文件大小（表单上传先写临时文件再去重）。
+# 会注册一个随机用户名，结束时删掉上传的两个文件。
+set -euo pipefail
+
+HOST=${1:-http://127.0.0.1:1316}
+SIZE=${2:-$(( (4 << 30) + 4097 ))}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+SRC=$WORK/big.bin
+JAR=$WORK/cookies
+
+fail() { echo "FAIL: $*" >&2; exit 1; }
+
+# 稀疏文件不占磁盘；在 2GB、4GB 边界附近写上标记，下载时 sendfile 的偏移一旦算错摘要就对不上
+truncate -s "$SIZE" "$SRC"
+for off in 0 $(( (1 << 31) - 7 )) $(( (1 << 32) - 7 )) $(( SIZE - 16 )); do
+    [ "$off" -ge 0 ] && [ "$off" -lt "$SIZE" ] || continue
+    printf 'marker@%08x' $(( off & 0xffffffff )) | dd of="$SRC" bs=1 seek="$off" conv=notrunc status=none
+done
+WANT=$(sha256sum "$SRC" | cut -d' ' -f1)
+echo "source: $SIZE bytes, sha256 $WANT"
+
+USER_NAME="large_$$_$RANDOM"
+code=$(curl -sS -o /dev/null -w '%{http_code}' -c "$JAR" -d "username=$USER_NAME&password=large-file" "$HOST/register") \
+    || fail "register: server not reachable at $HOST"
+[ "$code" = 200 ] || fail "register returned $code"
+
+# 1. 两种上传方式，入库的 file_size 走 64 位绑定
+out=$(curl -sS -b "$JAR" -T "$SRC" "$HOST/files/big-put.bin") || fail "PUT /files/ interrupted"
+echo "$out" | grep -q '"success"' || fail "PUT /files/ replied $out"
+out=$(curl -sS -b "$JAR" -F "file=@$SRC;filename=big-form.bin" "$HOST/upload") || fail "POST /upload interrupted"
+echo "$out" | grep -q '"success"' || fail "POST /upload replied $out"
+
+list=$(curl -sS -b "$JAR" "$HOST/showlist")
+for name in big-put.bin big-form.bin; do
+    echo "$list" | grep -q "\"filename\":\"$name\"[^}]*\"size\":$SIZE" || fail "$name not listed with size $SIZE: $list"
+done
+
+# 2. 单独下载：响应头走 writev，内容从 sendfile 的偏移续发
+for name in big-put.bin big-form.bin; do
+    got=$(curl -sS -b "$JAR" "$HOST/download/$name" | tee >(wc -c > "$WORK/len") | sha256sum | cut -d' ' -f1)
+    sleep 0.2   # 等 wc 写完
+    len=$(cat "$WORK/len")
+    [ "$len" = "$SIZE" ] || fail "download $name: $len bytes, want $SIZE"
+    [ "$got" = "$WANT" ] || fail "download $name: sha256 $got, want $WANT"
+    echo "download $name ok"
+done
+
+# 3. 打包下载：两项都超过 4GB，第二项的本地头位置也超过 4GB，边读边校验 ZIP64 结构、CRC 和内容摘要
+curl -sS -b "$JAR" "$HOST/export?files=big-put.bin,big-form.bin" | python3 -c '
+import hashlib, struct, sys, zlib
+size, want, names = int(sys.argv[1]), sys.argv[2], sys.argv[3:]
+f = sys.stdin.buffer
+pos = 0
+def read(n):
+    global pos
+    data = f.read(n)
+    if len(data) != n:
+        sys.exit("FAIL: archive truncated at %d" % pos)
+    pos += n
+    return data
+offsets = []
+for name in names:
+    offsets.append(pos)
+    sig, ver, flag, method, _, _, crc, csize, usize, nlen, elen = struct.unpack("<IHHHHHIIIHH", read(30))
+    got = read(nlen).decode()
+    extra = read(elen)
+    assert sig == 0x04034b50 and got == name, (hex(sig), got)
+    assert ver == 45 and flag & 8 and method == 0, (ver, flag, method)
+    assert (csize, usize) == (0xFFFFFFFF, 0xFFFFFFFF) and extra[:4] == struct.pack("<HH", 1, 16), extra
+    h, c, left = hashlib.sha256(), 0, size
+    while left:
+        chunk = read(min(left, 1 << 20))
+        h.update(chunk)
+        c = zlib.crc32(chunk, c)
+        left -= len(chunk)
+    assert h.hexdigest() == want, (name, h.hexdigest())
+    dsig, dcrc, dc, du = struct.unpack("<IIQQ", read(24))
+    assert dsig == 0x08074b50 and dcrc == c and dc == du == size, (hex(dsig), dcrc, c, dc, du)
+    crcs = c
+cd_start = pos
+for name, off in zip(names, offsets):
+    sig, made, ver, flag, method, _, _, crc, csize, usize, nlen, elen, clen, _, _, _, loff = struct.unpack("<IHHHHHHIIIHHHHHII", read(46))
+    got = read(nlen).decode()
+    extra = read(elen)
+    assert sig == 0x02014b50 and got == name and ver == 45, (hex(sig), got, ver)
+    assert (csize, usize) == (0xFFFFFFFF, 0xFFFFFFFF), (csize, usize)
+    fields = extra[4:]
+    assert struct.unpack("<HH", extra[:4])[0] == 1
+    vals = struct.unpack("<%dQ" % (len(fields) // 8), fields)
+    assert vals[0] == vals[1] == size, vals
+    real_off = vals[2] if loff == 0xFFFFFFFF else loff
+    assert real_off == off and (off < 1 << 32) == (loff != 0xFFFFFFFF), (real_off, off, loff)
+cd_size = pos - cd_start
+sig, rest, _, _, _, _, n1, n2, zsize, zoff = struct.unpack("<IQHHIIQQQQ", read(56))
+assert sig == 0x06064b50 and rest == 44 and n1 == n2 == len(names), (hex(sig), rest, n1, n2)
+assert zsize == cd_size and zoff == cd_start, (zsize, cd_size, zoff, cd_start)
+sig, _, end64, _ = struct.unpack("<IIQI", read(20))
+assert sig == 0x07064b50 and end64 == cd_start + cd_size, (hex(sig), end64)
+sig, _, _, n1, n2, esize, eoff, _ = struct.unpack("<IHHHHIIH", read(22))
+assert sig == 0x06054b50 and n1 == n2 == len(names) and esize == cd_size and eoff == 0xFFFFFFFF
+assert f.read(1) == b"", "trailing bytes"
+print("export ok: %d bytes" % pos)
+' "$SIZE" "$WANT" big-put.bin big-form.bin || fail "export archive check"
+
+curl -s -o /dev/null -b "$JAR" -X POST -H 'Content-Type: application/json' \
+     -d '{"files": ["big-put.bin", "big-form.bin"]}' "$HOST/delete/batch"
+echo "PASS"
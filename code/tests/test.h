@@ -0,0 +1,41 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-22
+ * @Description  : 单元测试用的最小框架：TEST 注册用例，CHECK 失败时记下位置继续执行
+ */
+#ifndef TEST_H
+#define TEST_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <functional>
+
+struct TestCase {
+    const char* name;
+    std::function<void()> fn;
+};
+
+std::vector<TestCase>& TestCases();
+void TestFail(const char* file, int line, const char* expr);
+
+struct TestRegistrar {
+    TestRegistrar(const char* name, std::function<void()> fn) {
+        TestCases().push_back(TestCase{name, std::move(fn)});
+    }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static TestRegistrar name##_registrar(#name, name); \
+    static void name()
+
+#define CHECK(cond) \
+    do { if (!(cond)) { TestFail(__FILE__, __LINE__, #cond); } } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+// 测试用的临时目录，每次调用新建一个，进程退出时删除
+std::string TestTempDir();
+
+#endif //TEST_H
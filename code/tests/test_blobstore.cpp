@@ -0,0 +1,177 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-22
+ * @Description  : BlobWriter 摘要计算，BlobStore 去重和引用计数
+ */
+#include "test.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <filesystem>
+#include <openssl/evp.h>
+#include "../processing/BlobStore.h"
+#include "../processing/MetaStore.h"
+
+static std::string Sha256Hex(const std::string& data) {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    EVP_Digest(data.data(), data.size(), md, &len, EVP_sha256(), nullptr);
+    static const char HEX[] = "0123456789abcdef";
+    std::string hex;
+    for (unsigned int i = 0; i < len; i++) {
+        hex += HEX[md[i] >> 4];
+        hex += HEX[md[i] & 0xf];
+    }
+    return hex;
+}
+
+static std::string RandomBytes(size_t len, unsigned seed) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = static_cast<char>(seed >> 16);
+    }
+    return data;
+}
+
+static std::string ReadFile(const std::string& path) {
+    std::string data;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return data;
+    char buf[1 << 16];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) { data.append(buf, n); }
+    close(fd);
+    return data;
+}
+
+// 临时目录里正在写的那个文件（用例里同一时刻只有一个 BlobWriter）
+static std::string OpenTempFile() {
+    for (const auto& entry : std::filesystem::directory_iterator(BlobStore::Instance()->TempDir())) {
+        if (entry.path().filename().string().rfind("upload.", 0) == 0) return entry.path().string();
+    }
+    return "";
+}
+
+TEST(BlobWriterHashesSplicedBody) {
+    // 和 PUT /files/ 一样：请求体先进管道，再一段段 SpliceFrom 进文件
+    std::string body = RandomBytes((3 << 20) + 12345, 7);
+    int p[2];
+    CHECK(pipe(p) == 0);
+    fcntl(p[1], F_SETPIPE_SZ, 1 << 20);
+
+    BlobWriter writer;
+    CHECK(writer.Open());
+    std::string path = OpenTempFile();
+    CHECK(!path.empty());
+    size_t off = 0, step = 1000;
+    while (off < body.size()) {
+        size_t len = std::min(step, body.size() - off);
+        CHECK(write(p[1], body.data() + off, len) == static_cast<ssize_t>(len));
+        CHECK(writer.SpliceFrom(p[0], len));
+        off += len;
+        step = step * 3 % (1 << 20) + 1;   // 长短不一的段，有的超过 64K
+    }
+    close(p[0]);
+    close(p[1]);
+
+    CHECK_EQ(writer.Size(), static_cast<long long>(body.size()));
+    CHECK(ReadFile(path) == body);
+
+    // 摘要是边收边算的，Finish 不再读回文件：这时把文件改掉，摘要仍是收到的内容
+    int fd = open(path.c_str(), O_WRONLY);
+    CHECK(fd >= 0 && pwrite(fd, "xxxx", 4, 0) == 4);
+    if (fd >= 0) { close(fd); }
+    std::string hash;
+    CHECK(writer.Finish(hash));
+    CHECK_EQ(hash, Sha256Hex(body));
+}
+
+TEST(BlobWriterHashesMixedWriteAndSplice) {
+    std::string head = RandomBytes(5000, 1), tail = RandomBytes(200000, 2);
+    int p[2];
+    CHECK(pipe(p) == 0);
+    BlobWriter writer;
+    CHECK(writer.Open());
+    CHECK(writer.Write(head.data(), head.size()));   // 请求头后面已经读进缓冲区的那部分
+    size_t off = 0;
+    while (off < tail.size()) {
+        size_t len = std::min<size_t>(60000, tail.size() - off);
+        CHECK(write(p[1], tail.data() + off, len) == static_cast<ssize_t>(len));
+        CHECK(writer.SpliceFrom(p[0], len));
+        off += len;
+    }
+    close(p[0]);
+    close(p[1]);
+    std::string hash;
+    CHECK(writer.Finish(hash));
+    CHECK_EQ(hash, Sha256Hex(head + tail));
+}
+
+// 像上传一样写临时文件再入库
+static bool Upload(int userId, const std::string& name, const std::string& content, UploadedFileInfo& info) {
+    BlobWriter writer;
+    if (!writer.Open() || !writer.Write(content.data(), content.size())) return false;
+    info = UploadedFileInfo();
+    info.original_filename = name;
+    info.stored_filename = name;
+    info.file_type = "text/plain";
+    info.uploader_id = userId;
+    return BlobStore::Instance()->Commit(writer, info);
+}
+
+static bool Exists(const std::string& path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+TEST(BlobStoreDedupsAndReclaimsAtZeroRefs) {
+    std::string content = RandomBytes(100000, 41);
+    BlobStoreStats before = BlobStore::Instance()->GetStats();
+
+    UploadedFileInfo a, b;
+    CHECK(Upload(101, "a.bin", content, a));
+    CHECK(Upload(102, "b.bin", content, b));
+    CHECK_EQ(a.content_hash, Sha256Hex(content));
+    CHECK_EQ(a.file_path, b.file_path);   // 同样的内容只存一份
+    CHECK_EQ(a.file_path, BlobStore::Instance()->PathFor(a.content_hash));
+    CHECK_EQ(a.file_size, static_cast<long long>(content.size()));
+    CHECK(ReadFile(a.file_path) == content);
+    BlobStoreStats after = BlobStore::Instance()->GetStats();
+    CHECK_EQ(after.stored, before.stored + 1);
+    CHECK_EQ(after.dedupHits, before.dedupHits + 1);
+    CHECK_EQ(after.bytesSaved, before.bytesSaved + content.size());
+
+    // 还有一个引用时不回收
+    std::vector<UploadedFileInfo> removed;
+    CHECK(MetaStore::Instance()->DeleteFile("a.bin", 101, removed));
+    CHECK_EQ(removed.size(), static_cast<size_t>(1));
+    CHECK_EQ(BlobStore::Instance()->ReclaimOnce(), static_cast<size_t>(0));
+    CHECK(Exists(a.file_path));
+
+    // 最后一个引用删掉后回收，文件移出 blob 目录
+    removed.clear();
+    CHECK(MetaStore::Instance()->DeleteFiles({"b.bin", "missing.bin"}, 102, removed));
+    CHECK_EQ(removed.size(), static_cast<size_t>(1));
+    CHECK_EQ(BlobStore::Instance()->ReclaimOnce(), static_cast<size_t>(1));
+    CHECK(!Exists(a.file_path));
+    CHECK_EQ(BlobStore::Instance()->ReclaimOnce(), static_cast<size_t>(0));
+}
+
+TEST(BlobStoreKeepsBlobReferencedAgainBeforeReclaim) {
+    std::string content = RandomBytes(4096, 42);
+    UploadedFileInfo first, again;
+    CHECK(Upload(103, "c.bin", content, first));
+    std::vector<UploadedFileInfo> removed;
+    CHECK(MetaStore::Instance()->DeleteFile("c.bin", 103, removed));
+
+    // 引用归零但还没回收时又上传了同样的内容：重新引用后回收线程不能删它
+    CHECK(Upload(104, "d.bin", content, again));
+    CHECK_EQ(again.file_path, first.file_path);
+    CHECK_EQ(BlobStore::Instance()->ReclaimOnce(), static_cast<size_t>(0));
+    CHECK(ReadFile(again.file_path) == content);
+
+    removed.clear();
+    CHECK(MetaStore::Instance()->DeleteFile("d.bin", 104, removed));
+    CHECK_EQ(BlobStore::Instance()->ReclaimOnce(), static_cast<size_t>(1));
+    CHECK(!Exists(again.file_path));
+}
@@ -0,0 +1,171 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-22
+ * @Description  : DbExecutor 完成顺序、队列满退回同步、连接关闭后丢弃回调
+ */
+#include "test.h"
+#include <poll.h>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include "../pool/dbexecutor.h"
+#include "../pool/completiongate.h"
+
+// 像事件循环一样等 eventfd 可读再取回调，直到拿到 expect 个或超时
+static std::vector<std::function<void()>> WaitCompletions(size_t expect) {
+    std::vector<std::function<void()>> all;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (all.size() < expect && std::chrono::steady_clock::now() < deadline) {
+        struct pollfd pfd = {DbExecutor::Instance()->EventFd(), POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0) continue;
+        for (auto& done : DbExecutor::Instance()->TakeCompletions()) {
+            all.push_back(std::move(done));
+        }
+    }
+    return all;
+}
+
+/* 一次只放行一个任务的闸门，用来让 DB 线程停在 work 里 */
+struct Latch {
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool entered = false;
+    bool open = false;
+
+    void Enter() {
+        std::unique_lock<std::mutex> locker(mtx);
+        entered = true;
+        cond.notify_all();
+        cond.wait(locker, [this] { return open; });
+    }
+    void WaitEntered() {
+        std::unique_lock<std::mutex> locker(mtx);
+        cond.wait(locker, [this] { return entered; });
+    }
+    void Open() {
+        std::lock_guard<std::mutex> locker(mtx);
+        open = true;
+        cond.notify_all();
+    }
+};
+
+/* 代替 HttpConn：提交时记下代数，回调经闸门核对后才算构造了响应 */
+struct FakeConn {
+    CompletionGate gate;
+    int responses = 0;
+    bool closed = false;
+
+    bool Submit(std::function<void()> work) {
+        uint64_t ticket = gate.Ticket();
+        return DbExecutor::Instance()->Submit(std::move(work), [this, ticket]() {
+            gate.RunIf(ticket, [this]() { responses++; });
+        });
+    }
+    void Close() {
+        std::unique_lock<std::mutex> locker = gate.Advance();
+        closed = true;
+    }
+};
+
+TEST(DbExecutorCompletesInSubmitOrder) {
+    DbExecutor::Instance()->Start(1, 64);
+    std::vector<int> worked, finished;
+    const int n = 20;
+    for (int i = 0; i < n; i++) {
+        bool ok = DbExecutor::Instance()->Submit([&worked, i]() { worked.push_back(i); },
+                                                 [&finished, &worked, i]() {
+                                                     // 回调执行时 work 已经跑完
+                                                     CHECK(static_cast<int>(worked.size()) > i);
+                                                     finished.push_back(i);
+                                                 });
+        CHECK(ok);
+    }
+    auto completions = WaitCompletions(n);
+    CHECK_EQ(completions.size(), static_cast<size_t>(n));
+    for (auto& done : completions) { done(); }
+    CHECK_EQ(static_cast<int>(finished.size()), n);
+    for (int i = 0; i < static_cast<int>(finished.size()); i++) {
+        CHECK_EQ(finished[i], i);
+    }
+    DbExecutorStats stats = DbExecutor::Instance()->GetStats();
+    CHECK_EQ(stats.completed, static_cast<uint64_t>(n));
+    DbExecutor::Instance()->Stop();
+}
+
+TEST(DbExecutorRejectsWhenQueueFull) {
+    DbExecutor::Instance()->Start(1, 1);
+    uint64_t rejectedBefore = DbExecutor::Instance()->GetStats().rejected;
+    Latch latch;
+    std::atomic<int> ran(0);
+
+    // 第一个占住唯一的 DB 线程，第二个排队，第三个应当被拒绝
+    CHECK(DbExecutor::Instance()->Submit([&]() { latch.Enter(); ran++; }, []() {}));
+    latch.WaitEntered();
+    CHECK(DbExecutor::Instance()->Submit([&]() { ran++; }, []() {}));
+    bool accepted = DbExecutor::Instance()->Submit([&]() { ran++; }, []() {});
+    CHECK(!accepted);
+    CHECK_EQ(DbExecutor::Instance()->GetStats().rejected, rejectedBefore + 1);
+
+    // 和 HttpConn::AsyncDb_ 一样，被拒绝的由调用方同步执行
+    if (!accepted) { ran++; }
+    CHECK_EQ(ran.load(), 1);
+
+    latch.Open();
+    auto completions = WaitCompletions(2);
+    CHECK_EQ(completions.size(), static_cast<size_t>(2));
+    CHECK_EQ(ran.load(), 3);
+    DbExecutor::Instance()->Stop();
+
+    // 停止后一律拒绝
+    CHECK(!DbExecutor::Instance()->Submit([]() {}, []() {}));
+}
+
+TEST(DbExecutorDropsCompletionAfterClose) {
+    DbExecutor::Instance()->Start(2, 64);
+    FakeConn live, closed;
+    CHECK(live.Submit([]() {}));
+    CHECK(closed.Submit([]() {}));
+    auto completions = WaitCompletions(2);
+    CHECK_EQ(completions.size(), static_cast<size_t>(2));
+
+    // 回调交回事件循环之后、线程池执行之前连接超时关闭
+    closed.Close();
+    for (auto& done : completions) { done(); }
+    CHECK_EQ(live.responses, 1);
+    CHECK_EQ(closed.responses, 0);
+
+    // 关闭后同一个对象被新连接复用，旧连接的回调也不能落到新连接上
+    FakeConn reused;
+    CHECK(reused.Submit([]() {}));
+    completions = WaitCompletions(1);
+    reused.Close();
+    reused.gate.Advance();   // 相当于 init
+    for (auto& done : completions) { done(); }
+    CHECK_EQ(reused.responses, 0);
+    DbExecutor::Instance()->Stop();
+}
+
+TEST(CompletionGateBlocksCloseWhileResponding) {
+    CompletionGate gate;
+    uint64_t ticket = gate.Ticket();
+    std::atomic<bool> inside(false), sawInside(false);
+
+    std::thread completion([&]() {
+        gate.RunIf(ticket, [&]() {
+            inside = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            inside = false;
+        });
+    });
+    while (!inside) { std::this_thread::yield(); }
+    {
+        // 关闭要等正在构造的响应结束才能拿到锁
+        std::unique_lock<std::mutex> locker = gate.Advance();
+        sawInside = inside.load();
+    }
+    completion.join();
+    CHECK(!sawInside);
+    CHECK(!gate.RunIf(ticket, []() {}));
+}
@@ -0,0 +1,99 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-22
+ * @Description  : FileSearchIndex 三元组搜索：排序、大小写、短查询和增删同步
+ */
+#include "test.h"
+#include "../processing/MetaStore.h"
+#include "../processing/FileSearchIndex.h"
+
+static UploadedFileInfo MakeRecord(int userId, const std::string& name) {
+    UploadedFileInfo info = UploadedFileInfo();
+    info.original_filename = name;
+    info.stored_filename = name;
+    info.file_path = "/nonexistent/" + name;
+    info.file_type = "application/octet-stream";
+    info.file_size = static_cast<long long>(name.size());
+    info.uploader_id = userId;
+    return info;
+}
+
+static std::vector<std::string> Names(const std::vector<FileSearchHit>& hits) {
+    std::vector<std::string> names;
+    for (const FileSearchHit& hit : hits) { names.push_back(hit.filename); }
+    return names;
+}
+
+TEST(FileSearchIndexSearch) {
+    const int userId = 501;
+    // 按入库先后，越往后越新
+    for (const char* name : {"Report-2024.pdf", "annual report.txt", "photo.png", "REPORT_final.doc", "报告.pdf"}) {
+        CHECK(MetaStore::Instance()->InsertFile(MakeRecord(userId, name)));
+    }
+
+    std::vector<FileSearchHit> hits;
+    CHECK(!FileSearchIndex::Instance()->TrySearch(userId, "report", 10, hits));   // 还没建索引
+    uint64_t builds = FileSearchIndex::Instance()->GetStats().builds;
+    CHECK(FileSearchIndex::Instance()->Search(userId, "report", 10, hits));
+    CHECK_EQ(FileSearchIndex::Instance()->GetStats().builds, builds + 1);
+
+    // 前缀匹配在前，两类各自从新到旧；大小写不敏感
+    std::vector<std::string> want = {"REPORT_final.doc", "Report-2024.pdf", "annual report.txt"};
+    CHECK(Names(hits) == want);
+    CHECK_EQ(hits.size(), static_cast<size_t>(3));
+    if (hits.size() == 3) {
+        CHECK(hits[0].prefix && hits[1].prefix && !hits[2].prefix);
+        CHECK_EQ(hits[1].size, 15LL);   // MakeRecord 用名字长度当大小
+    }
+    CHECK(FileSearchIndex::Instance()->TrySearch(userId, "RePoRT", 10, hits));
+    CHECK(Names(hits) == want);
+    CHECK_EQ(FileSearchIndex::Instance()->GetStats().builds, builds + 1);
+
+    // limit 先给前缀匹配
+    CHECK(FileSearchIndex::Instance()->TrySearch(userId, "report", 2, hits));
+    CHECK(Names(hits) == std::vector<std::string>({"REPORT_final.doc", "Report-2024.pdf"}));
+
+    // 不足三个字节时扫描全部文件名
+    CHECK(FileSearchIndex::Instance()->TrySearch(userId, "A", 10, hits));
+    CHECK(Names(hits) == std::vector<std::string>({"annual report.txt", "REPORT_final.doc"}));
+    CHECK(FileSearchIndex::Instance()->TrySearch(userId, "", 10, hits));
+    CHECK_EQ(hits.size(), static_cast<size_t>(5));
+
+    // UTF-8 按字节取三元组，中文子串同样能搜到
+    CHECK(FileSearchIndex::Instance()->TrySearch(userId, "报告", 10, hits));
+    CHECK(Names(hits) == std::vector<std::string>({"报告.pdf"}));
+    CHECK(FileSearchIndex::Instance()->TrySearch(userId, "告.p", 10, hits));
+    CHECK(Names(hits) == std::vector<std::string>({"报告.pdf"}));
+    CHECK(FileSearchIndex::Instance()->TrySearch(userId, "xyz", 10, hits));
+    CHECK(hits.empty());
+}
+
+TEST(FileSearchIndexAddRemove) {
+    const int userId = 502;
+    CHECK(MetaStore::Instance()->InsertFile(MakeRecord(userId, "notes.txt")));
+    std::vector<FileSearchHit> hits;
+    CHECK(FileSearchIndex::Instance()->Search(userId, "note", 10, hits));
+    CHECK_EQ(hits.size(), static_cast<size_t>(1));
+
+    // 上传入库后同步进索引，不再查库
+    UploadedFileInfo added = MakeRecord(userId, "Notes-v2.txt");
+    CHECK(MetaStore::Instance()->InsertFile(added));
+    FileSearchIndex::Instance()->Add(added);
+    uint64_t builds = FileSearchIndex::Instance()->GetStats().builds;
+    CHECK(FileSearchIndex::Instance()->TrySearch(userId, "note", 10, hits));
+    CHECK(Names(hits) == std::vector<std::string>({"Notes-v2.txt", "notes.txt"}));
+
+    // 删除按 stored_filename 移除
+    std::vector<UploadedFileInfo> removed;
+    CHECK(MetaStore::Instance()->DeleteFile("notes.txt", userId, removed));
+    FileSearchIndex::Instance()->Remove(userId, removed);
+    CHECK(FileSearchIndex::Instance()->TrySearch(userId, "note", 10, hits));
+    CHECK(Names(hits) == std::vector<std::string>({"Notes-v2.txt"}));
+    CHECK(FileSearchIndex::Instance()->TrySearch(userId, "no", 10, hits));
+    CHECK(Names(hits) == std::vector<std::string>({"Notes-v2.txt"}));
+    CHECK_EQ(FileSearchIndex::Instance()->GetStats().builds, builds);
+
+    // 其他用户的索引互不影响
+    CHECK(FileSearchIndex::Instance()->Search(userId + 1, "note", 10, hits));
+    CHECK(hits.empty());
+}
@@ -0,0 +1,53 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-22
+ * @Description  : 超过 4GB 的文件大小在参数绑定和元数据存取里不被截断
+ */
+#include "test.h"
+#include "../pool/sqlstmtcache.h"
+#include "../processing/MetaStore.h"
+
+static const long long BIG_SIZE = (5LL << 30) + 123;
+
+TEST(SqlParamsInt64Bind) {
+    // MySQL 后端的 file_size 走 Int64，绑定成 LONGLONG 并指向调用方的变量
+    long long size = BIG_SIZE;
+    int userId = 7;
+    SqlParams params;
+    params.Int64(size).Int(userId);
+    MYSQL_BIND* binds = params.Binds();
+    CHECK(binds != nullptr);
+    if (!binds) return;
+    CHECK_EQ(binds[0].buffer_type, MYSQL_TYPE_LONGLONG);
+    CHECK_EQ(*static_cast<long long*>(binds[0].buffer), BIG_SIZE);
+    CHECK_EQ(binds[1].buffer_type, MYSQL_TYPE_LONG);
+    CHECK(SqlParams().Binds() == nullptr);
+}
+
+TEST(MetaStoreLargeFileSize) {
+    const int userId = 401;
+    UploadedFileInfo info = UploadedFileInfo();
+    info.original_filename = "big.bin";
+    info.stored_filename = "big.bin";
+    info.file_path = "/nonexistent/big.bin";
+    info.file_type = "application/octet-stream";
+    info.file_size = BIG_SIZE;
+    info.uploader_id = userId;
+    CHECK(MetaStore::Instance()->InsertFile(info));
+
+    UploadedFileInfo got;
+    CHECK(MetaStore::Instance()->GetFile(userId, "big.bin", got));
+    CHECK_EQ(got.file_size, BIG_SIZE);
+
+    std::vector<long long> sizes;
+    CHECK(MetaStore::Instance()->ForEachFile(userId, 0, "", 0, [&sizes](const UploadedFileInfo& f) {
+        sizes.push_back(f.file_size);
+    }));
+    CHECK_EQ(sizes.size(), static_cast<size_t>(1));
+    if (!sizes.empty()) { CHECK_EQ(sizes[0], BIG_SIZE); }
+
+    std::vector<UploadedFileInfo> removed;
+    CHECK(MetaStore::Instance()->DeleteFile("big.bin", userId, removed));
+    CHECK_EQ(removed.size(), static_cast<size_t>(1));
+    if (!removed.empty()) { CHECK_EQ(removed[0].file_size, BIG_SIZE); }
+}
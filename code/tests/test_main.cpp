@@ -0,0 +1,72 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-22
+ * @Description  : 单元测试入口，make test 编译后依次执行全部用例；可以带用例名只跑其中几个
+ */
+#include "test.h"
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "../config/config.h"
+
+static int g_failures = 0;
+static std::vector<std::string> g_tempDirs;
+
+std::vector<TestCase>& TestCases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+void TestFail(const char* file, int line, const char* expr) {
+    fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", file, line, expr);
+    g_failures++;
+}
+
+std::string TestTempDir() {
+    char path[] = "/tmp/webserver_test_XXXXXX";
+    if (!mkdtemp(path)) {
+        perror("mkdtemp");
+        exit(2);
+    }
+    g_tempDirs.push_back(path);
+    return path;
+}
+
+static bool Selected(const char* name, int argc, char** argv) {
+    if (argc <= 1) return true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    // 单例第一次使用时才读配置：所有用例共用一个临时存储目录，元数据用 SQLite，不依赖外部 MySQL
+    std::string root = TestTempDir();
+    Config::metaBackend = MetaBackend::SQLITE;
+    Config::sqlitePath = root + "/meta.db";
+    Config::uploadRoot = root + "/uploads";
+    Config::uploadStateDir = root + "/uploads/sessions";
+
+    int run = 0, failed = 0;
+    for (const TestCase& tc : TestCases()) {
+        if (!Selected(tc.name, argc, argv)) continue;
+        int before = g_failures;
+        printf("[ RUN  ] %s\n", tc.name);
+        fflush(stdout);
+        tc.fn();
+        run++;
+        if (g_failures != before) {
+            failed++;
+            printf("[ FAIL ] %s\n", tc.name);
+        } else {
+            printf("[  OK  ] %s\n", tc.name);
+        }
+    }
+    for (const std::string& dir : g_tempDirs) {
+        std::string cmd = "rm -rf '" + dir + "'";
+        if (system(cmd.c_str()) != 0) { fprintf(stderr, "cannot remove %s\n", dir.c_str()); }
+    }
+    printf("%d tests, %d failed\n", run, failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-22
+ * @Description  : MultipartReader 按任意分段喂入时的解析结果
+ */
+#include "test.h"
+#include "../http/multipartreader.h"
+
+static const char* CONTENT_TYPE = "multipart/form-data; boundary=----WebKitFormBoundaryX7";
+
+// 文件内容里故意带上分隔行的前半截，解析器不能把它当成分隔行
+static const std::string FILE_CONTENT =
+    std::string("line1\r\n------WebKitFormBoundaryX\r\n--\r\n") + std::string(3, '\0') + "tail\r\n";
+
+static std::string MakeBody() {
+    return "preamble ignored\r\n"
+           "------WebKitFormBoundaryX7\r\n"
+           "Content-Disposition: form-data; name=\"note\"\r\n\r\n"
+           "not a file\r\n"
+           "------WebKitFormBoundaryX7\r\n"
+           "Content-Disposition: form-data; name=\"file\"; filename=\"C:\\Users\\me\\报告.pdf\"\r\n"
+           "Content-Type:  application/pdf \r\n\r\n"
+           + FILE_CONTENT +
+           "\r\n------WebKitFormBoundaryX7\r\n"
+           "Content-Disposition: form-data; name=\"other\"; filename=\"second.txt\"\r\n\r\n"
+           "ignored\r\n"
+           "------WebKitFormBoundaryX7--\r\n"
+           "epilogue";
+}
+
+// 按 step 字节一段喂进去，模拟请求体分多次到达；返回最后一次 Feed 的结果
+static MultipartReader::Result FeedInSteps(MultipartReader& reader, const std::string& body, size_t step,
+                                           std::string& data) {
+    reader.onData = [&data](const char* p, size_t len) {
+        data.append(p, len);
+        return true;
+    };
+    Buffer buff;
+    MultipartReader::Result result = MultipartReader::NEED_MORE;
+    for (size_t off = 0; off < body.size() && result == MultipartReader::NEED_MORE; off += step) {
+        buff.Append(body.data() + off, std::min(step, body.size() - off));
+        result = reader.Feed(buff);
+    }
+    return result;
+}
+
+TEST(MultipartReaderAnySplit) {
+    std::string body = MakeBody();
+    for (size_t step : {size_t(1), size_t(2), size_t(7), size_t(29), size_t(64), body.size()}) {
+        MultipartReader reader(CONTENT_TYPE);
+        CHECK(reader.Valid());
+        std::string data;
+        CHECK_EQ(FeedInSteps(reader, body, step, data), MultipartReader::DONE);
+        CHECK(reader.HasFile());
+        CHECK_EQ(reader.Filename(), "报告.pdf");   // 去掉浏览器带的路径
+        CHECK_EQ(reader.ContentType(), "application/pdf");
+        CHECK(data == FILE_CONTENT);
+    }
+}
+
+TEST(MultipartReaderQuotedBoundaryAndNoFile) {
+    MultipartReader reader("multipart/form-data; boundary=\"abc\"; charset=utf-8");
+    CHECK(reader.Valid());
+    std::string data;
+    std::string body = "--abc\r\n"
+                       "Content-Disposition: form-data; name=\"file\"; filename=\"\"\r\n\r\n"
+                       "\r\n--abc--\r\n";
+    CHECK_EQ(FeedInSteps(reader, body, 3, data), MultipartReader::DONE);
+    CHECK(!reader.HasFile());   // 表单里没选文件
+    CHECK(data.empty());
+}
+
+TEST(MultipartReaderErrors) {
+    CHECK(!MultipartReader("multipart/form-data").Valid());
+
+    // 分隔行后面既不是 CRLF 也不是 "--"
+    MultipartReader bad(CONTENT_TYPE);
+    std::string data;
+    CHECK_EQ(FeedInSteps(bad, "------WebKitFormBoundaryX7xx\r\n", 5, data), MultipartReader::ERROR);
+
+    // 写文件失败时 onData 返回 false，解析中止
+    MultipartReader aborted(CONTENT_TYPE);
+    Buffer buff;
+    std::string body = MakeBody();
+    buff.Append(body.data(), body.size());
+    aborted.onData = [](const char*, size_t) { return false; };
+    CHECK_EQ(aborted.Feed(buff), MultipartReader::ERROR);
+}
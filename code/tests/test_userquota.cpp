@@ -0,0 +1,60 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-22
+ * @Description  : UserQuota 装入计数和上传准入
+ */
+#include "test.h"
+#include "../config/config.h"
+#include "../processing/MetaStore.h"
+#include "../processing/UserQuota.h"
+
+static bool InsertRecord(int userId, const std::string& name, long long size) {
+    UploadedFileInfo info = UploadedFileInfo();
+    info.original_filename = name;
+    info.stored_filename = name;
+    info.file_path = "/nonexistent/" + name;
+    info.file_type = "application/octet-stream";
+    info.file_size = size;
+    info.uploader_id = userId;
+    return MetaStore::Instance()->InsertFile(info);
+}
+
+TEST(UserQuotaAdmitsUpToLimit) {
+    long long savedLimit = Config::userQuotaBytes;
+    Config::userQuotaBytes = 5000;
+
+    // 装入之前不做检查，只按请求大小限制
+    CHECK(!UserQuota::Instance()->GetStats().loaded);
+    CHECK(UserQuota::Instance()->Allow(201, 1LL << 40));
+
+    // 大小超过 2GB 的记录也要按 64 位汇总
+    CHECK(InsertRecord(201, "q1.bin", 1000));
+    CHECK(InsertRecord(201, "q2.bin", 2000));
+    CHECK(InsertRecord(202, "q3.bin", 5LL << 30));
+    CHECK(UserQuota::Instance()->Load());
+    CHECK(UserQuota::Instance()->GetStats().loaded);
+    CHECK_EQ(UserQuota::Instance()->Used(201), 3000LL);
+    CHECK_EQ(UserQuota::Instance()->Used(202), 5LL << 30);
+    CHECK_EQ(UserQuota::Instance()->Used(203), 0LL);
+
+    uint64_t rejects = UserQuota::Instance()->GetStats().rejects;
+    CHECK(UserQuota::Instance()->Allow(201, 2000));     // 正好用满
+    CHECK(!UserQuota::Instance()->Allow(201, 2001));
+    CHECK(!UserQuota::Instance()->Allow(202, 1));
+    CHECK(UserQuota::Instance()->Allow(203, 5000));
+    CHECK_EQ(UserQuota::Instance()->GetStats().rejects, rejects + 2);
+
+    // 上传入库后加，删除后减；删光了不留条目
+    UserQuota::Instance()->Add(201, 2000);
+    CHECK(!UserQuota::Instance()->Allow(201, 1));
+    size_t users = UserQuota::Instance()->GetStats().users;
+    UserQuota::Instance()->Add(201, -5000);
+    CHECK_EQ(UserQuota::Instance()->Used(201), 0LL);
+    CHECK_EQ(UserQuota::Instance()->GetStats().users, users - 1);
+    CHECK(UserQuota::Instance()->Allow(201, 5000));
+
+    // 配额为 0 表示不限
+    Config::userQuotaBytes = 0;
+    CHECK(UserQuota::Instance()->Allow(202, 1LL << 40));
+    Config::userQuotaBytes = savedLimit;
+}
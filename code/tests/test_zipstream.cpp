@@ -0,0 +1,192 @@
+/*
+ * @Author       : Wang
+ * @Date         : 2025-07-22
+ * @Description  : ZipStream 归档结构，包括超过 4GB 时的 ZIP64 头
+ */
+#include "test.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdint>
+#include "../processing/ZipStream.h"
+
+static uint16_t Get16(const std::string& s, size_t pos) {
+    return static_cast<uint16_t>(static_cast<unsigned char>(s[pos]) | (static_cast<unsigned char>(s[pos + 1]) << 8));
+}
+
+static uint32_t Get32(const std::string& s, size_t pos) {
+    return Get16(s, pos) | (static_cast<uint32_t>(Get16(s, pos + 2)) << 16);
+}
+
+static uint64_t Get64(const std::string& s, size_t pos) {
+    return Get32(s, pos) | (static_cast<uint64_t>(Get32(s, pos + 4)) << 32);
+}
+
+static std::string WriteFile(const std::string& dir, const std::string& name, const std::string& content) {
+    std::string path = dir + "/" + name;
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        CHECK(write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+        close(fd);
+    }
+    return path;
+}
+
+/*
+ * 把整个流读完，只留下开头 headBytes 和结尾 tailBytes 两段，
+ * 中间的大文件内容不进内存。返回 false 表示流出错或总长和 Length() 不符
+ */
+static bool Drain(ZipStream& zip, size_t headBytes, size_t tailBytes, std::string& head, std::string& tail) {
+    uint64_t total = static_cast<uint64_t>(zip.Length());
+    uint64_t tailStart = total > tailBytes ? total - tailBytes : 0;
+    uint64_t pos = 0;
+    const char* data;
+    size_t len;
+    while (zip.Next(data, len)) {
+        if (len == 0) return pos == total;
+        for (size_t i = 0; i < len;) {
+            if (pos + i < headBytes) {
+                size_t n = std::min<uint64_t>(len - i, headBytes - (pos + i));
+                head.append(data + i, n);
+                i += n;
+            } else if (pos + i < tailStart) {
+                i += std::min<uint64_t>(len - i, tailStart - (pos + i));
+            } else {
+                tail.append(data + i, len - i);
+                i = len;
+            }
+        }
+        pos += len;
+    }
+    return false;
+}
+
+TEST(ZipStreamSmallArchive) {
+    std::string dir = TestTempDir();
+    ZipStream zip(4096);
+    CHECK(zip.AddFile("hello.txt", WriteFile(dir, "a", "hello")));
+    CHECK(zip.AddFile("报告.txt", WriteFile(dir, "b", "")));
+    CHECK(!zip.AddFile("missing", dir + "/missing"));
+    CHECK(!zip.AddFile("dir", dir));
+    CHECK_EQ(zip.Count(), static_cast<size_t>(2));
+
+    std::string all, unused;
+    CHECK(Drain(zip, static_cast<size_t>(zip.Length()), 0, all, unused));
+    CHECK_EQ(static_cast<long long>(all.size()), zip.Length());
+
+    // 第一项：本地头 + "hello" + 16 字节数据描述符
+    CHECK_EQ(Get32(all, 0), 0x04034b50u);
+    CHECK_EQ(Get16(all, 4), 20);
+    CHECK_EQ(Get16(all, 6), 0x0808);          // 数据描述符 + UTF-8
+    CHECK_EQ(Get16(all, 26), 9);
+    CHECK_EQ(Get16(all, 28), 0);              // 不到 4GB 没有扩展字段
+    CHECK_EQ(all.substr(30, 9), "hello.txt");
+    CHECK_EQ(all.substr(39, 5), "hello");
+    CHECK_EQ(Get32(all, 44), 0x08074b50u);
+    CHECK_EQ(Get32(all, 48), 0x3610a686u);    // crc32("hello")
+    CHECK_EQ(Get32(all, 52), 5u);
+    CHECK_EQ(Get32(all, 56), 5u);
+
+    // 目录结束记录：两项，不需要 ZIP64
+    size_t end = all.size() - 22;
+    CHECK_EQ(Get32(all, end), 0x06054b50u);
+    CHECK_EQ(Get16(all, end + 8), 2);
+    uint32_t cdSize = Get32(all, end + 12), cdOffset = Get32(all, end + 16);
+    CHECK_EQ(cdOffset + cdSize, end);
+    CHECK_EQ(Get32(all, cdOffset), 0x02014b50u);
+    CHECK_EQ(Get32(all, cdOffset + 16), 0x3610a686u);
+    CHECK_EQ(Get32(all, cdOffset + 20), 5u);
+    CHECK_EQ(Get32(all, cdOffset + 42), 0u);  // 第一项的本地头在 0
+    size_t second = cdOffset + 46 + 9;
+    CHECK_EQ(Get32(all, second), 0x02014b50u);
+    CHECK_EQ(Get32(all, second + 16), 0u);    // 空文件的 CRC
+    CHECK_EQ(Get32(all, second + 42), 60u);   // 30 + 9 + 5 + 16
+    CHECK_EQ(all.substr(second + 46, Get16(all, second + 28)), "报告.txt");
+}
+
+TEST(ZipStreamZip64ForLargeFile) {
+    // 稀疏文件，超过 4GB 但不占磁盘；后面再跟一个小文件，它的本地头位置也超过 4GB
+    std::string dir = TestTempDir();
+    const uint64_t bigSize = (4ULL << 30) + 1000;
+    std::string big = dir + "/big";
+    int fd = open(big.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0 && ftruncate(fd, static_cast<off_t>(bigSize)) == 0);
+    if (fd >= 0) { close(fd); }
+
+    ZipStream zip(1 << 20);
+    CHECK(zip.AddFile("a.txt", WriteFile(dir, "a", "hello")));
+    CHECK(zip.AddFile("big.bin", big));
+    CHECK(zip.AddFile("c.txt", WriteFile(dir, "c", "world")));
+
+    const uint64_t aLen = 30 + 5 + 5 + 16;
+    const uint64_t bigLocal = 30 + 7 + 20;             // 本地头带 20 字节 ZIP64 扩展
+    const uint64_t cOffset = aLen + bigLocal + bigSize + 24;   // 大文件的数据描述符是 24 字节
+    const uint64_t cLen = 30 + 5 + 5 + 16;
+    const uint64_t cdSize = (46 + 5) + (46 + 7 + 4 + 16) + (46 + 5 + 4 + 8);
+    CHECK_EQ(static_cast<uint64_t>(zip.Length()), cOffset + cLen + cdSize + 56 + 20 + 22);
+
+    std::string head, tail;
+    size_t tailBytes = 24 + cLen + cdSize + 56 + 20 + 22;   // 从大文件的数据描述符开始
+    CHECK(Drain(zip, 1024, tailBytes, head, tail));
+    CHECK_EQ(tail.size(), tailBytes);
+    if (tail.size() != tailBytes || head.size() < 1024) return;
+
+    // 大文件的本地头：版本 45，长度置 0xFFFFFFFF，扩展字段 0x0001
+    CHECK_EQ(Get32(head, aLen), 0x04034b50u);
+    CHECK_EQ(Get16(head, aLen + 4), 45);
+    CHECK_EQ(Get32(head, aLen + 18), 0xFFFFFFFFu);
+    CHECK_EQ(Get32(head, aLen + 22), 0xFFFFFFFFu);
+    CHECK_EQ(Get16(head, aLen + 28), 20);
+    CHECK_EQ(Get16(head, aLen + 37), 0x0001);
+    CHECK_EQ(Get16(head, aLen + 39), 16);
+
+    // 大文件的数据描述符用 8 字节长度
+    CHECK_EQ(Get32(tail, 0), 0x08074b50u);
+    CHECK_EQ(Get64(tail, 8), bigSize);
+    CHECK_EQ(Get64(tail, 16), bigSize);
+    CHECK_EQ(Get32(tail, 24), 0x04034b50u);
+    CHECK_EQ(tail.substr(24 + 30, 5), "c.txt");
+
+    // 结尾：ZIP64 目录结束记录 + 定位器 + 目录结束记录（超限字段置满）
+    size_t end = tail.size() - 22;
+    CHECK_EQ(Get32(tail, end), 0x06054b50u);
+    CHECK_EQ(Get16(tail, end + 8), 3);
+    CHECK_EQ(Get32(tail, end + 12), static_cast<uint32_t>(cdSize));
+    CHECK_EQ(Get32(tail, end + 16), 0xFFFFFFFFu);
+    size_t locator = end - 20;
+    CHECK_EQ(Get32(tail, locator), 0x07064b50u);
+    CHECK_EQ(Get64(tail, locator + 8), cOffset + cLen + cdSize);
+    size_t zip64End = locator - 56;
+    CHECK_EQ(Get32(tail, zip64End), 0x06064b50u);
+    CHECK_EQ(Get64(tail, zip64End + 4), 44u);
+    CHECK_EQ(Get64(tail, zip64End + 24), 3u);
+    CHECK_EQ(Get64(tail, zip64End + 32), 3u);
+    CHECK_EQ(Get64(tail, zip64End + 40), cdSize);
+    CHECK_EQ(Get64(tail, zip64End + 48), cOffset + cLen);
+
+    // 中央目录：大文件带 16 字节长度扩展，c.txt 带 8 字节位置扩展
+    size_t cd = 24 + cLen;
+    CHECK_EQ(Get32(tail, cd), 0x02014b50u);
+    CHECK_EQ(Get16(tail, cd + 30), 0);
+    CHECK_EQ(Get32(tail, cd + 42), 0u);
+    size_t bigCd = cd + 46 + 5;
+    CHECK_EQ(Get32(tail, bigCd), 0x02014b50u);
+    CHECK_EQ(Get16(tail, bigCd + 6), 45);
+    CHECK_EQ(Get32(tail, bigCd + 20), 0xFFFFFFFFu);
+    CHECK_EQ(Get32(tail, bigCd + 24), 0xFFFFFFFFu);
+    CHECK_EQ(Get16(tail, bigCd + 30), 20);
+    CHECK_EQ(Get32(tail, bigCd + 42), static_cast<uint32_t>(aLen));
+    CHECK_EQ(Get16(tail, bigCd + 46 + 7), 0x0001);
+    CHECK_EQ(Get16(tail, bigCd + 46 + 9), 16);
+    CHECK_EQ(Get64(tail, bigCd + 46 + 11), bigSize);
+    CHECK_EQ(Get64(tail, bigCd + 46 + 19), bigSize);
+    size_t cCd = bigCd + 46 + 7 + 20;
+    CHECK_EQ(Get32(tail, cCd), 0x02014b50u);
+    CHECK_EQ(Get16(tail, cCd + 6), 45);
+    CHECK_EQ(Get32(tail, cCd + 16), 0x3a771143u);  // crc32("world")
+    CHECK_EQ(Get32(tail, cCd + 20), 5u);
+    CHECK_EQ(Get32(tail, cCd + 42), 0xFFFFFFFFu);
+    CHECK_EQ(Get16(tail, cCd + 30), 12);
+    CHECK_EQ(Get16(tail, cCd + 46 + 5), 0x0001);
+    CHECK_EQ(Get16(tail, cCd + 46 + 7), 8);
+    CHECK_EQ(Get64(tail, cCd + 46 + 9), cOffset);
+}
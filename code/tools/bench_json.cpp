@@ -0,0 +1,118 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-22 16:40:10
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-22 16:40:10
+ * @Description: 文件列表 JSON 编码对比：原来的 nlohmann::json 逐行 dump 拼字符串 vs JsonWriter 直接写进 Buffer
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "../buffer/buffer.h"
+#include "../http/jsonwriter.h"
+#include "../processing/uploaded_file.h"
+
+/*
+ * 用法：bench_json [行数] [轮数]，默认 100 行（一页 /showlist）跑 20000 轮。
+ * 两条路径都从同一批 UploadedFileInfo 出发，最后都落到写缓冲区里：
+ *   nlohmann：每行建一个 json 对象 dump 后拼进 std::string，再整体复制成响应体，
+ *             MakeResponse 时再追加进 writeBuff_（改动之前 /showlist 的做法）；
+ *   JsonWriter：逐行直接编码进响应体 Buffer，发送时作为 iov_[1]，不再复制。
+ * 输出每轮耗时、每行耗时和响应体字节数，并核对两边解析出来的内容一致。
+ */
+
+static std::vector<UploadedFileInfo> MakeRows(int n) {
+    std::vector<UploadedFileInfo> rows(n);
+    for (int i = 0; i < n; i++) {
+        UploadedFileInfo& f = rows[i];
+        f.id = i + 1;
+        // 混入中文、空格、引号和反斜杠，转义路径也要算进去
+        f.original_filename = "报告 " + std::to_string(i) + (i % 7 == 0 ? " \"final\"\\v2.pdf" : "_scan.png");
+        f.upload_time = "2025-07-" + std::to_string(10 + i % 20) + " 12:34:56";
+        f.uploader_id = 42;
+        f.file_size = 1024LL * (i + 1) * 37;
+    }
+    return rows;
+}
+
+static void EncodeNlohmann(const std::vector<UploadedFileInfo>& rows, Buffer& writeBuff) {
+    std::string jsonStr = "[";
+    int count = 0;
+    for (const UploadedFileInfo& file : rows) {
+        nlohmann::json fileJson;
+        fileJson["filename"] = file.original_filename;
+        fileJson["upload_time"] = file.upload_time;
+        fileJson["user_id"] = file.uploader_id;
+        fileJson["size"] = file.file_size;
+        if (count++ > 0) jsonStr += ',';
+        jsonStr += fileJson.dump();
+    }
+    jsonStr += ']';
+    std::string body = jsonStr;                 // SetJsonResponse 保存一份
+    writeBuff.Append("Content-Length: " + std::to_string(body.size()) + "\r\n\r\n");
+    writeBuff.Append(body);                     // MakeResponse 再追加进写缓冲区
+}
+
+static void EncodeWriter(const std::vector<UploadedFileInfo>& rows, Buffer& body) {
+    JsonWriter writer(body);
+    writer.BeginArray();
+    for (const UploadedFileInfo& file : rows) {
+        writer.BeginObject()
+              .Key("filename").String(file.original_filename)
+              .Key("upload_time").String(file.upload_time)
+              .Key("user_id").Int(file.uploader_id)
+              .Key("size").Int(file.file_size)
+              .EndObject();
+    }
+    writer.EndArray();
+}
+
+template <typename Fn>
+static double TimeRounds(int rounds, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) { fn(); }
+    std::chrono::duration<double, std::micro> used = std::chrono::steady_clock::now() - start;
+    return used.count() / rounds;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 100;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20000;
+    if (n <= 0 || rounds <= 0) {
+        fprintf(stderr, "usage: %s [rows] [rounds]\n", argv[0]);
+        return 1;
+    }
+    std::vector<UploadedFileInfo> rows = MakeRows(n);
+
+    // 先核对输出：两边解析成 JSON 后应当相同
+    Buffer oldBuff, newBuff;
+    EncodeNlohmann(rows, oldBuff);
+    EncodeWriter(rows, newBuff);
+    std::string oldAll = oldBuff.RetrieveAllToStr();
+    std::string oldBody = oldAll.substr(oldAll.find("\r\n\r\n") + 4);
+    std::string newBody = newBuff.RetrieveAllToStr();
+    if (nlohmann::json::parse(oldBody) != nlohmann::json::parse(newBody)) {
+        fprintf(stderr, "outputs differ\n");
+        return 1;
+    }
+
+    // 缓冲区在轮次之间复用，和连接对象复用 writeBuff_ 一样
+    double oldUs = TimeRounds(rounds, [&]() {
+        EncodeNlohmann(rows, oldBuff);
+        oldBuff.RetrieveAll();
+    });
+    double newUs = TimeRounds(rounds, [&]() {
+        EncodeWriter(rows, newBuff);
+        newBuff.RetrieveAll();
+    });
+
+    printf("rows:%d rounds:%d body:%zu bytes\n", n, rounds, newBody.size());
+    printf("%-10s %10s %10s\n", "encoder", "us/round", "ns/row");
+    printf("%-10s %10.2f %10.1f\n", "nlohmann", oldUs, oldUs * 1000 / n);
+    printf("%-10s %10.2f %10.1f\n", "JsonWriter", newUs, newUs * 1000 / n);
+    printf("speedup: %.2fx\n", oldUs / newUs);
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * @Author: Wang
+ * @Date: 2025-07-16 21:03:18
+ * @LastEditors: Please set LastEditors
+ * @LastEditTime: 2025-07-16 21:03:18
+ * @Description: 一次性迁移：把平铺在 ./resources/images 下的旧上传文件按摘要搬进 uploadRoot/blobs 的两级目录
+ */
+#include <string>
+#include <vector>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <memory>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../config/config.h"
+#include "../log/log.h"
+#include "../pool/sqlconnpool.h"
+#include "../processing/MetaStore.h"
+#include "../processing/BlobStore.h"
+
+/*
+ * 用法（在服务的工作目录下运行，旧记录里的 file_path 是相对这个目录的）：
+ *   migrate_uploads [--dry-run] [--keep] [--batch N] [--upload-root DIR]
+ *                   [--sqlite PATH | --mysql HOST PORT USER PWD DB]
+ * 按 id 顺序分批读取没有 content_hash 的记录，文件算出摘要后放进 BlobStore，
+ * 再把记录的路径和摘要改过去。已经迁移的记录不会再被选中，中途失败可以直接重跑。
+ */
+
+struct MigrateStats {
+    size_t scanned = 0;
+    size_t migrated = 0;
+    size_t missing = 0;     // 记录还在，文件已经没了
+    size_t failed = 0;
+    long long bytes = 0;
+};
+
+static void Usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--dry-run] [--keep] [--batch N] [--upload-root DIR]\n"
+            "          [--sqlite PATH | --mysql HOST PORT USER PWD DB]\n", prog);
+}
+
+// 旧文件和上传目录不在同一个文件系统上时没法硬链接，只能复制一份
+static bool CopyInto(BlobWriter& writer, const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    if (!writer.Open()) {
+        close(fd);
+        return false;
+    }
+    std::vector<char> buf(1 << 16);
+    bool ok = true;
+    while (ok) {
+        ssize_t n = read(fd, buf.data(), buf.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        ok = writer.Write(buf.data(), n);
+    }
+    close(fd);
+    return ok;
+}
+
+static bool SameDevice(const std::string& a, const std::string& b) {
+    struct stat sa, sb;
+    return stat(a.c_str(), &sa) == 0 && stat(b.c_str(), &sb) == 0 && sa.st_dev == sb.st_dev;
+}
+
+// 入库一批，成功的旧路径记进 done，全部迁完后再删（旧布局下不同用户的同名文件共用一个路径）
+static void CommitRows(std::vector<UploadedFileInfo>& rows, const std::string& tmpDir,
+                       std::set<std::string>& done, MigrateStats& stats) {
+    std::vector<std::unique_ptr<BlobWriter>> writers(rows.size());
+    std::vector<BlobCommit> batch(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        writers[i] = std::make_unique<BlobWriter>();
+        // 能硬链接就不复制：旧文件和临时目录在同一个文件系统上时，搬过去的只是目录项
+        bool link = SameDevice(rows[i].file_path, tmpDir);
+        bool ok = link ? writers[i]->Adopt(rows[i].file_path) : CopyInto(*writers[i], rows[i].file_path);
+        batch[i].writer = ok ? writers[i].get() : nullptr;
+        batch[i].info = rows[i];
+        batch[i].attachId = rows[i].id;
+    }
+    BlobStore::Instance()->CommitBatch(batch, FsyncPolicy::GROUP);
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (batch[i].ok) {
+            stats.migrated++;
+            stats.bytes += batch[i].info.file_size;
+            done.insert(rows[i].file_path);
+        } else {
+            stats.failed++;
+            fprintf(stderr, "failed: id=%d %s\n", rows[i].id, rows[i].file_path.c_str());
+        }
+    }
+    rows.clear();
+}
+
+int main(int argc, char* argv[]) {
+    bool dryRun = false, keep = false;
+    int batchSize = 256;
+    std::string host = "localhost", user = "root", pwd = "123456", db = "webserver";
+    int port = 3306;   // 默认值和 main.cpp 中服务的配置一致
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--dry-run") {
+            dryRun = true;
+        } else if (arg == "--keep") {
+            keep = true;
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchSize = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--upload-root" && i + 1 < argc) {
+            Config::uploadRoot = argv[++i];
+        } else if (arg == "--sqlite" && i + 1 < argc) {
+            Config::metaBackend = MetaBackend::SQLITE;
+            Config::sqlitePath = argv[++i];
+        } else if (arg == "--mysql" && i + 5 < argc) {
+            Config::metaBackend = MetaBackend::MYSQL;
+            host = argv[++i];
+            port = atoi(argv[++i]);
+            user = argv[++i];
+            pwd = argv[++i];
+            db = argv[++i];
+        } else {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    Log::Instance()->init(1, "./log", ".migrate.log", 0);
+    if (Config::metaBackend == MetaBackend::MYSQL) {
+        SqlConnPool::Instance()->Init(host.c_str(), port, user.c_str(), pwd.c_str(), db.c_str(), 1);
+    }
+    MetaStore* store = MetaStore::Instance();
+    const std::string& tmpDir = BlobStore::Instance()->TempDir();
+
+    MigrateStats stats;
+    std::set<std::string> done;
+    std::vector<UploadedFileInfo> rows;
+    std::set<std::string> pending;   // 本批中的文件名，Adopt 的临时链接按文件名命名
+    int afterId = 0;
+    while (true) {
+        std::vector<UploadedFileInfo> page;
+        if (!store->ForEachLegacyFile(afterId, batchSize, [&page](const UploadedFileInfo& info) {
+                page.push_back(info);
+            })) {
+            fprintf(stderr, "query legacy files failed\n");
+            return 1;
+        }
+        if (page.empty()) break;
+        afterId = page.back().id;
+
+        for (const UploadedFileInfo& info : page) {
+            stats.scanned++;
+            struct stat st;
+            if (stat(info.file_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+                stats.missing++;
+                fprintf(stderr, "missing: id=%d %s\n", info.id, info.file_path.c_str());
+                continue;
+            }
+            if (dryRun) {
+                stats.migrated++;
+                stats.bytes += st.st_size;
+                continue;
+            }
+            std::string name = info.file_path.substr(info.file_path.find_last_of('/') + 1);
+            if (pending.count(name)) {
+                CommitRows(rows, tmpDir, done, stats);
+                pending.clear();
+            }
+            pending.insert(name);
+            rows.push_back(info);
+        }
+        if (!rows.empty()) {
+            CommitRows(rows, tmpDir, done, stats);
+            pending.clear();
+        }
+    }
+
+    if (!keep) {
+        for (const std::string& path : done) {
+            if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+                fprintf(stderr, "unlink %s failed: %s\n", path.c_str(), strerror(errno));
+            }
+        }
+    }
+    printf("%sscanned %zu, migrated %zu (%lld bytes), missing %zu, failed %zu\n",
+           dryRun ? "[dry-run] " : "", stats.scanned, stats.migrated, stats.bytes,
+           stats.missing, stats.failed);
+    store->LogStats();
+    return stats.failed ? 1 : 0;
+}